@@ -0,0 +1,59 @@
+#include <windows.h>
+#include <d2d1.h>
+
+#include <chrono>
+#include <stdio.h>
+
+#include "autosave.h"
+
+Autosaver::Autosaver(const std::filesystem::path& journal) : path(journal), stopping(false)
+{
+    // started last, once every member it uses exists
+    worker = std::thread(&Autosaver::WorkerMain, this);
+}
+
+Autosaver::~Autosaver()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+void Autosaver::Submit(LogSlice&& slice)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        pending.push_back(std::move(slice));
+    }
+    wake.notify_one();
+}
+
+void Autosaver::WorkerMain()
+{
+    for (;;)
+    {
+        LogSlice slice;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            wake.wait(guard, [this] { return stopping || !pending.empty(); });
+            if (pending.empty())
+            {
+                return; // stopping, and everything has been written
+            }
+            slice = std::move(pending.front());
+            pending.pop_front();
+        }
+
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        const bool written = AppendToJournal(path, slice);
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        wchar_t msg[128];
+        swprintf_s(msg, written ? L"autosave: wrote operations %zu to %zu in %.2f ms\n" : L"autosave: failed to write operations %zu to %zu (%.2f ms)\n",
+            slice.first, slice.last, ms);
+        OutputDebugString(msg);
+    }
+}
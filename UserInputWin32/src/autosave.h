@@ -0,0 +1,41 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+
+#include "document.h"
+
+/*
+ - writes the operations a document has not saved yet to a journal file, on a thread of its own
+ - the UI thread only hands over a 'LogSlice' (see 'Document::TakeUnsaved'), which references the log's chunks
+   instead of copying them, so an autosave costs the UI thread microseconds whatever the size of the document
+ - saves are incremental: each one appends a record with the operations changed since the previous one;
+   a slice starting at operation 0 rewrites the journal instead
+ - 'Document::Recover' rebuilds the drawing from the journal after a crash
+*/
+
+class Autosaver
+{
+    std::filesystem::path path;
+    std::mutex lock;
+    std::condition_variable wake;
+    std::deque<LogSlice> pending;
+    bool stopping;
+    std::thread worker;
+
+    void WorkerMain();
+
+public:
+    explicit Autosaver(const std::filesystem::path& journal);
+    ~Autosaver(); // writes what is still pending before the worker stops
+
+    Autosaver(const Autosaver&) = delete;
+    Autosaver& operator=(const Autosaver&) = delete;
+
+    void Submit(LogSlice&& slice);
+
+    const std::filesystem::path& Path() const { return path; }
+};
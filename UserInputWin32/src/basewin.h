@@ -1,12 +1,18 @@
 #pragma once
 
+#include "profiler.h"
+#include "startup.h"
+#include "windowcache.h"
+
 template <class DERIVED_TYPE>
 class BaseWindow // abstract base class 
 {
 public:
     static LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
     {
+        PROFILE_ZONE("WindowProc");
         DERIVED_TYPE* pThis = NULL;
+        WindowInstanceCache& cache = WindowInstanceCache::ForThread();
 
         if (uMsg == WM_NCCREATE)
         {
@@ -16,16 +22,32 @@ public:
             // store the StateInfo pointer in the instance data for the window
             // Once you do this, you can always get the pointer back from the window by calling 'GetWindowLongPtr'
             SetWindowLongPtr(hwnd, GWLP_USERDATA, (LONG_PTR)pThis);
+            cache.Insert(hwnd, pThis);
 
             pThis->m_hwnd = hwnd;
         }
         else
         {
-            pThis = (DERIVED_TYPE*)GetWindowLongPtr(hwnd, GWLP_USERDATA);
+            // the thread's cache answers without calling into user32; only a miss asks the window
+            pThis = (DERIVED_TYPE*)cache.Find(hwnd);
+            if (pThis == NULL)
+            {
+                pThis = (DERIVED_TYPE*)GetWindowLongPtr(hwnd, GWLP_USERDATA);
+                if (pThis)
+                {
+                    cache.Insert(hwnd, pThis);
+                }
+            }
         }
         if (pThis)
         {
-            return pThis->HandleMessage(uMsg, wParam, lParam);
+            const LRESULT result = pThis->HandleMessage(uMsg, wParam, lParam);
+            if (uMsg == WM_NCDESTROY)
+            {
+                // the last message of the window; dropped after it is handled, so nothing sent meanwhile caches it again
+                cache.Erase(hwnd);
+            }
+            return result;
         }
         else
         {
@@ -54,11 +76,13 @@ public:
         wc.lpszClassName = ClassName();
 
         RegisterClass(&wc);
+        StartupTimeline::Mark(L"window class registered");
 
         m_hwnd = CreateWindowEx(
             dwExStyle, ClassName(), lpWindowName, dwStyle, x, y,
             nWidth, nHeight, hWndParent, hMenu, GetModuleHandle(NULL), this
         );
+        StartupTimeline::Mark(L"window created");
 
         return (m_hwnd ? TRUE : FALSE);
     }
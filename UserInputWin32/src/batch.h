@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+/*
+ - ellipses to draw in order, as contiguous arrays: center x, center y, radius x, radius y (DIPs) and a 0xAARRGGBB color
+ - a structure of arrays, so a backend can transform 8 shapes per AVX2 instruction instead of one call per shape
+ - removed shapes (NaN center) and empty ones (zero radius) are skipped by every backend
+*/
+
+struct EllipseBatch
+{
+    const float* cx;
+    const float* cy;
+    const float* rx;
+    const float* ry;
+    const UINT32* colors;
+    size_t count;
+};
+
+
+// a batch with arrays of its own, e.g. the visible part of the scene gathered into the frame arena
+struct BatchArrays
+{
+    std::pmr::vector<float> cx, cy, rx, ry;
+    std::pmr::vector<UINT32> colors;
+    std::pmr::vector<uint32_t> ids; // the shape each entry was gathered from
+
+    explicit BatchArrays(std::pmr::memory_resource* memory)
+        : cx(memory), cy(memory), rx(memory), ry(memory), colors(memory), ids(memory) {}
+
+    void Push(uint32_t id, float x, float y, float radiusX, float radiusY, UINT32 color)
+    {
+        cx.push_back(x);
+        cy.push_back(y);
+        rx.push_back(radiusX);
+        ry.push_back(radiusY);
+        colors.push_back(color);
+        ids.push_back(id);
+    }
+
+    EllipseBatch Batch() const
+    {
+        EllipseBatch batch = { cx.data(), cy.data(), rx.data(), ry.data(), colors.data(), ids.size() };
+        return batch;
+    }
+};
+
+
+/*
+ - level of detail: a shape whose radii are both below 'SplatRadius' pixels covers at most about one pixel,
+   so rasterizing it as an ellipse (spans, anti-aliased edges) is wasted work
+ - such shapes are drawn as a splat instead: the single pixel containing the center gets the shape's color,
+   so a dense, zoomed-out scene still shows where its shapes are
+*/
+const float SplatRadius = 0.5f;
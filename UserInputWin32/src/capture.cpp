@@ -0,0 +1,221 @@
+#include <windows.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdio.h>
+
+#include "capture.h"
+#include "qoi.h"
+
+namespace
+{
+    const char Magic[4] = { 'E', 'L', 'P', 'C' };
+    const uint32_t Version = 1;
+
+    template <typename T>
+    void Put(std::ofstream& file, const T& value)
+    {
+        file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    template <typename T>
+    bool Get(std::ifstream& file, T& value)
+    {
+        file.read(reinterpret_cast<char*>(&value), sizeof(value));
+        return static_cast<bool>(file);
+    }
+
+    // true if the tile at (x0, y0), 'w' x 'h' pixels, is the same in both frames
+    bool TileEqual(const UINT32* a, const UINT32* b, UINT32 stride, UINT32 x0, UINT32 y0, UINT32 w, UINT32 h)
+    {
+        for (UINT32 y = y0; y < y0 + h; y++)
+        {
+            const size_t row = static_cast<size_t>(y) * stride + x0;
+            if (std::memcmp(a + row, b + row, w * sizeof(UINT32)) != 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+
+FrameRecorder::FrameRecorder(const std::filesystem::path& path)
+    : file(path, std::ios::binary | std::ios::trunc), start(std::chrono::steady_clock::now()), spare(Buffers),
+      stopping(false), stats(), previousWidth(0), previousHeight(0)
+{
+    file.write(Magic, sizeof(Magic));
+    Put(file, Version);
+    Put(file, TileSize);
+
+    // started last, once every member it uses exists
+    worker = std::thread(&FrameRecorder::WorkerMain, this);
+}
+
+FrameRecorder::~FrameRecorder()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+    file.flush();
+
+    wchar_t msg[256];
+    swprintf_s(msg, L"capture: %zu frames (%zu skipped), %zu of %zu tiles changed, %.1f MB, encode %.2f ms/frame, render thread %.1f us/frame\n",
+        stats.frames, stats.skipped, stats.changedTiles, stats.tiles, stats.bytes / (1024.0 * 1024.0),
+        stats.frames ? stats.encodeSeconds * 1000 / stats.frames : 0.0,
+        stats.frames + stats.skipped ? stats.submitSeconds * 1e6 / (stats.frames + stats.skipped) : 0.0);
+    OutputDebugString(msg);
+}
+
+void FrameRecorder::Submit(SoftwareRenderer& renderer)
+{
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (spare.empty())
+        {
+            stats.skipped++; // the worker is behind; this frame is not recorded and the renderer keeps its buffer
+        }
+        else
+        {
+            Frame frame;
+            frame.pixels.swap(spare.back());
+            spare.pop_back();
+            renderer.SwapPixels(frame.pixels);
+            frame.width = renderer.Width();
+            frame.height = renderer.Height();
+            frame.timeMs = static_cast<UINT32>(std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count());
+            pending.push_back(std::move(frame));
+        }
+        stats.submitSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - now).count();
+    }
+    wake.notify_one();
+}
+
+void FrameRecorder::WorkerMain()
+{
+    for (;;)
+    {
+        Frame frame;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            wake.wait(guard, [this] { return stopping || !pending.empty(); });
+            if (pending.empty())
+            {
+                return; // stopping, and everything has been written
+            }
+            frame = std::move(pending.front());
+            pending.pop_front();
+        }
+
+        const std::chrono::steady_clock::time_point before = std::chrono::steady_clock::now();
+        Write(frame);
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - before).count();
+
+        // the frame becomes the reference for the next one, and the old reference goes back to the renderer
+        previous.swap(frame.pixels);
+        previousWidth = frame.width;
+        previousHeight = frame.height;
+
+        std::lock_guard<std::mutex> guard(lock);
+        spare.push_back(std::move(frame.pixels));
+        stats.encodeSeconds += seconds;
+    }
+}
+
+void FrameRecorder::Write(const Frame& frame)
+{
+    const bool keyframe = frame.width != previousWidth || frame.height != previousHeight;
+    const UINT32 tilesX = (frame.width + TileSize - 1) / TileSize, tilesY = (frame.height + TileSize - 1) / TileSize;
+
+    // the tiles go to 'encoded' first, since the frame header holds their count
+    encoded.clear();
+    uint32_t changed = 0;
+    for (UINT32 ty = 0; ty < tilesY; ty++)
+    {
+        for (UINT32 tx = 0; tx < tilesX; tx++)
+        {
+            const UINT32 x0 = tx * TileSize, y0 = ty * TileSize;
+            const UINT32 w = std::min(TileSize, frame.width - x0), h = std::min(TileSize, frame.height - y0);
+            if (!keyframe && TileEqual(frame.pixels.data(), previous.data(), frame.width, x0, y0, w, h))
+            {
+                continue;
+            }
+
+            const uint16_t column = static_cast<uint16_t>(tx), row = static_cast<uint16_t>(ty);
+            const size_t header = encoded.size();
+            encoded.resize(header + 8);
+            EncodeQoi(frame.pixels.data() + static_cast<size_t>(y0) * frame.width + x0, w, h, frame.width * sizeof(UINT32), encoded);
+
+            const uint32_t bytes = static_cast<uint32_t>(encoded.size() - header - 8);
+            std::memcpy(&encoded[header], &column, sizeof(column));
+            std::memcpy(&encoded[header + 2], &row, sizeof(row));
+            std::memcpy(&encoded[header + 4], &bytes, sizeof(bytes));
+            changed++;
+        }
+    }
+
+    Put(file, static_cast<uint32_t>(frame.width));
+    Put(file, static_cast<uint32_t>(frame.height));
+    Put(file, static_cast<uint32_t>(frame.timeMs));
+    Put(file, changed);
+    file.write(reinterpret_cast<const char*>(encoded.data()), encoded.size());
+
+    stats.frames++;
+    stats.tiles += static_cast<size_t>(tilesX) * tilesY;
+    stats.changedTiles += changed;
+    stats.bytes += 16 + encoded.size();
+}
+
+
+bool CapturePlayer::Open(const std::filesystem::path& path)
+{
+    file.open(path, std::ios::binary);
+    char magic[4];
+    uint32_t version = 0;
+    file.read(magic, sizeof(magic));
+    return Get(file, version) && Get(file, tileSize) && std::memcmp(magic, Magic, sizeof(Magic)) == 0 &&
+        version == Version && tileSize > 0;
+}
+
+bool CapturePlayer::Next()
+{
+    uint32_t w = 0, h = 0, time = 0, tiles = 0;
+    if (!Get(file, w) || !Get(file, h) || !Get(file, time) || !Get(file, tiles) || w > 32768 || h > 32768)
+    {
+        return false;
+    }
+    if (w != width || h != height)
+    {
+        // a new size starts from scratch; the recorder wrote every tile of this frame
+        width = w;
+        height = h;
+        pixels.assign(static_cast<size_t>(w) * h, 0);
+    }
+    timeMs = time;
+
+    const UINT32 tilesX = (width + tileSize - 1) / tileSize, tilesY = (height + tileSize - 1) / tileSize;
+    for (uint32_t i = 0; i < tiles; i++)
+    {
+        uint16_t column = 0, row = 0;
+        uint32_t bytes = 0;
+        if (!Get(file, column) || !Get(file, row) || !Get(file, bytes) || column >= tilesX || row >= tilesY || bytes > (64u << 20))
+        {
+            return false;
+        }
+        data.resize(bytes);
+        file.read(reinterpret_cast<char*>(data.data()), bytes);
+
+        const UINT32 x0 = column * tileSize, y0 = row * tileSize;
+        const UINT32 tw = std::min(tileSize, width - x0), th = std::min(tileSize, height - y0);
+        if (!file || !DecodeQoi(data.data(), data.size(), tw, th, pixels.data() + static_cast<size_t>(y0) * width + x0, Stride()))
+        {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "softrender.h"
+
+/*
+ - records the frames the software renderer presents, for bug reports and performance investigations
+ - a frame is stored as the tiles that changed since the previous frame, each compressed as a QOI image (see 'EncodeQoi');
+   a frame of a new size stores every tile
+ - the render thread does not copy or compare pixels: 'Submit' swaps the renderer's finished buffer for a free one,
+   and a worker thread compares, encodes and writes it
+ - the number of buffers is fixed; when the worker falls behind, frames are skipped rather than making the renderer wait,
+   and the player just shows the previous frame for longer
+ - file: the 4-byte magic "ELPC", a format version and the tile size; then per frame its width, height, time since the
+   start of the capture (ms) and number of tiles, and per tile its column and row (16 bits each), byte count and QOI data
+*/
+
+// what the recording cost, logged when it stops
+struct CaptureStats
+{
+    size_t frames;
+    size_t skipped;        // no free buffer when the frame was submitted
+    size_t tiles;          // tiles of all recorded frames
+    size_t changedTiles;   // tiles actually written
+    size_t bytes;
+    double encodeSeconds;  // worker time
+    double submitSeconds;  // render thread time
+};
+
+
+class FrameRecorder
+{
+    struct Frame
+    {
+        std::vector<UINT32> pixels;
+        UINT32 width, height;
+        UINT32 timeMs;
+    };
+
+    static const int Buffers = 3;
+
+    std::ofstream file;
+    std::chrono::steady_clock::time_point start;
+
+    std::mutex lock;
+    std::condition_variable wake;
+    std::deque<Frame> pending;
+    std::vector<std::vector<UINT32>> spare; // buffers for the renderer to draw into
+    bool stopping;
+    CaptureStats stats;
+
+    // worker state
+    std::vector<UINT32> previous;
+    UINT32 previousWidth, previousHeight;
+    std::vector<uint8_t> encoded;
+
+    std::thread worker;
+
+    void WorkerMain();
+    void Write(const Frame& frame);
+
+public:
+    static constexpr UINT32 TileSize = 64;
+
+    explicit FrameRecorder(const std::filesystem::path& path);
+    ~FrameRecorder(); // writes the frames still pending, then logs the stats
+
+    FrameRecorder(const FrameRecorder&) = delete;
+    FrameRecorder& operator=(const FrameRecorder&) = delete;
+
+    bool IsOpen() const { return file.is_open(); }
+
+    // takes the frame 'renderer' just drew and gives it a spare buffer to draw the next one into
+    void Submit(SoftwareRenderer& renderer);
+};
+
+
+// reads a capture back one frame at a time
+class CapturePlayer
+{
+    std::ifstream file;
+    UINT32 tileSize;
+    std::vector<UINT32> pixels;
+    UINT32 width, height;
+    UINT32 timeMs;
+    std::vector<uint8_t> data;
+
+public:
+    CapturePlayer() : tileSize(0), width(0), height(0), timeMs(0) {}
+
+    bool Open(const std::filesystem::path& path);
+
+    // applies the next frame's tiles; false at the end of the capture or at a damaged frame
+    bool Next();
+
+    const UINT32* Pixels() const { return pixels.data(); }
+    UINT32 Width() const { return width; }
+    UINT32 Height() const { return height; }
+    UINT32 Stride() const { return width * sizeof(UINT32); }
+    UINT32 TimeMs() const { return timeMs; }
+};
@@ -0,0 +1,306 @@
+#include <windows.h>
+#include <d2d1.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#include "displaylist.h"
+#include "displayoptimizer.h"
+#include "scene.h"
+#include "softrender.h"
+
+namespace
+{
+    float WordToFloat(uint32_t w)
+    {
+        float f;
+        std::memcpy(&f, &w, sizeof(f));
+        return f;
+    }
+
+    D2D1_COLOR_F Color(UINT32 color)
+    {
+        return D2D1::ColorF(color & 0xFFFFFF, (color >> 24) / 255.0f);
+    }
+
+    /*
+     - the commands of the visible part of the scene, issued to 'sink': a 'DisplayList' records them,
+       a backend draws them right away (what painting did before display lists)
+    */
+    template <class Sink>
+    void EmitScene(const Scene& scene, const SceneDisplayList::Key& k, std::pmr::memory_resource* scratch, Sink& sink)
+    {
+        BatchArrays visible(scratch);
+        scene.Cull({ k.left, k.top, k.right, k.bottom }, visible);
+        const EllipseBatch batch = visible.Batch();
+
+        sink.Clear(k.background);
+
+        // the first shape always sets its color: the list may be replayed after anything else used the brush
+        bool haveColor = false;
+        UINT32 color = 0;
+        const float splatX = SplatRadius / k.pixelsX, splatY = SplatRadius / k.pixelsY;
+        for (size_t i = 0; i < batch.count; i++)
+        {
+            if (!haveColor || batch.colors[i] != color)
+            {
+                color = batch.colors[i];
+                haveColor = true;
+                sink.SetColor(color);
+            }
+            if (k.splat && batch.rx[i] < splatX && batch.ry[i] < splatY)
+            {
+                // the pixel under the center, snapped to the pixel grid so there is no edge to anti-alias
+                const float x = std::floor((batch.cx[i] - k.left) * k.pixelsX) / k.pixelsX + k.left;
+                const float y = std::floor((batch.cy[i] - k.top) * k.pixelsY) / k.pixelsY + k.top;
+                sink.FillRectangle(x, y, x + 1 / k.pixelsX, y + 1 / k.pixelsY);
+                continue;
+            }
+            sink.FillEllipse(batch.cx[i], batch.cy[i], batch.rx[i], batch.ry[i]);
+        }
+    }
+
+    // draws nothing: only counts, so the cost measured is the cost of getting the commands to a backend
+    class CountingBackend : public DisplayListBackend
+    {
+    public:
+        size_t commands = 0;
+
+        void Clear(UINT32) override { commands++; }
+        void SetColor(UINT32) override { commands++; }
+        void FillEllipse(float, float, float, float) override { commands++; }
+        void FillRectangle(float, float, float, float) override { commands++; }
+    };
+
+    // records what it is given, to compare the commands that reach a backend
+    class RecordingBackend : public DisplayListBackend
+    {
+        DisplayList& list;
+
+    public:
+        explicit RecordingBackend(DisplayList& out) : list(out) {}
+
+        void Clear(UINT32 color) override { list.Clear(color); }
+        void SetColor(UINT32 color) override { list.SetColor(color); }
+        void FillEllipse(float cx, float cy, float rx, float ry) override { list.FillEllipse(cx, cy, rx, ry); }
+        void FillRectangle(float left, float top, float right, float bottom) override { list.FillRectangle(left, top, right, bottom); }
+    };
+
+    // 'list' drawn by the software renderer the way 'OnPaint' does, through 'BatchDisplayBackend'
+    void RenderSoftware(const DisplayList& list, const SceneDisplayList::Key& k, std::pmr::memory_resource* scratch,
+        SoftwareRenderer& renderer)
+    {
+        BatchArrays shapes(scratch);
+        BatchDisplayBackend backend(shapes);
+        list.Replay(backend);
+        renderer.Resize(static_cast<UINT32>((k.right - k.left) * k.pixelsX), static_cast<UINT32>((k.bottom - k.top) * k.pixelsY));
+        renderer.Render(shapes.Batch(), k.pixelsX, k.pixelsY, -k.left * k.pixelsX, -k.top * k.pixelsY, backend.Background());
+    }
+}
+
+
+void DisplayList::PushFloat(float f)
+{
+    uint32_t w;
+    std::memcpy(&w, &f, sizeof(w));
+    words.push_back(w);
+}
+
+void DisplayList::FillEllipse(float cx, float cy, float rx, float ry)
+{
+    Push(DisplayOp::FillEllipse);
+    PushFloat(cx);
+    PushFloat(cy);
+    PushFloat(rx);
+    PushFloat(ry);
+    shapes++;
+}
+
+void DisplayList::FillRectangle(float left, float top, float right, float bottom)
+{
+    Push(DisplayOp::FillRectangle);
+    PushFloat(left);
+    PushFloat(top);
+    PushFloat(right);
+    PushFloat(bottom);
+    shapes++;
+}
+
+void DisplayList::Replay(DisplayListBackend& backend) const
+{
+    const uint32_t* w = words.data();
+    const uint32_t* const end = w + words.size();
+    while (w < end)
+    {
+        switch (static_cast<DisplayOp>(*w))
+        {
+        case DisplayOp::Clear:
+            backend.Clear(w[1]);
+            w += 2;
+            break;
+        case DisplayOp::SetColor:
+            backend.SetColor(w[1]);
+            w += 2;
+            break;
+        case DisplayOp::FillEllipse:
+            backend.FillEllipse(WordToFloat(w[1]), WordToFloat(w[2]), WordToFloat(w[3]), WordToFloat(w[4]));
+            w += 5;
+            break;
+        case DisplayOp::FillRectangle:
+            backend.FillRectangle(WordToFloat(w[1]), WordToFloat(w[2]), WordToFloat(w[3]), WordToFloat(w[4]));
+            w += 5;
+            break;
+        default:
+            return; // not written by 'DisplayList'; nothing after it can be trusted
+        }
+    }
+}
+
+
+void D2DDisplayBackend::Clear(UINT32 color)
+{
+    pRenderTarget->Clear(Color(color));
+}
+
+void D2DDisplayBackend::SetColor(UINT32 color)
+{
+    pBrush->SetColor(Color(color));
+}
+
+void D2DDisplayBackend::FillEllipse(float cx, float cy, float rx, float ry)
+{
+    pRenderTarget->FillEllipse(D2D1::Ellipse(D2D1::Point2F(cx, cy), rx, ry), pBrush);
+}
+
+void D2DDisplayBackend::FillRectangle(float left, float top, float right, float bottom)
+{
+    pRenderTarget->FillRectangle(D2D1::RectF(left, top, right, bottom), pBrush);
+}
+
+
+const DisplayList& SceneDisplayList::Get(const Scene& scene, const Key& k, std::pmr::memory_resource* scratch,
+    DisplayListOptimizer& optimizer)
+{
+    if (valid && key == k)
+    {
+        reused++;
+        if (optimize && !optimized)
+        {
+            // the optimized list draws the same pixels, so it can take over in any frame
+            if (submitted && optimizer.Take(recording, list))
+            {
+                optimized = true;
+            }
+            else if (!submitted)
+            {
+                submitted = optimizer.Submit(list, PixelGrid(k), recording);
+            }
+        }
+        return list;
+    }
+
+    Record(scene, k, scratch, list);
+    key = k;
+    valid = true;
+    submitted = false;
+    optimized = false;
+    recording++;
+    recorded++;
+    recordedCommands = list.Commands();
+    return list;
+}
+
+DisplayPixelGrid SceneDisplayList::PixelGrid(const Key& k)
+{
+    const DisplayPixelGrid grid = { k.left, k.top, 1 / k.pixelsX, 1 / k.pixelsY };
+    return grid;
+}
+
+void SceneDisplayList::Record(const Scene& scene, const Key& k, std::pmr::memory_resource* scratch, DisplayList& out)
+{
+    out.Reset();
+    EmitScene(scene, k, scratch, out);
+}
+
+
+void MeasureDisplayList(const Scene& scene, const SceneDisplayList::Key& k, int frames, DisplayListTimings& timings)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    // the scratch memory is reused from frame to frame, as the frame arena is in 'OnPaint'
+    std::pmr::unsynchronized_pool_resource scratch;
+    CountingBackend counter;
+    DisplayListBackend& backend = counter; // called through the interface, as painting does
+    DisplayList list;
+
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < frames; i++)
+    {
+        EmitScene(scene, k, &scratch, backend);
+    }
+    const double immediate = std::chrono::duration<double>(Clock::now() - start).count();
+
+    start = Clock::now();
+    for (int i = 0; i < frames; i++)
+    {
+        SceneDisplayList::Record(scene, k, &scratch, list);
+    }
+    const double record = std::chrono::duration<double>(Clock::now() - start).count();
+
+    start = Clock::now();
+    for (int i = 0; i < frames; i++)
+    {
+        list.Replay(backend);
+    }
+    const double replay = std::chrono::duration<double>(Clock::now() - start).count();
+
+    DisplayList optimized;
+    DisplayListStats stats;
+    start = Clock::now();
+    for (int i = 0; i < frames; i++)
+    {
+        OptimizeDisplayList(list, SceneDisplayList::PixelGrid(k), &scratch, optimized, &stats);
+    }
+    const double optimize = std::chrono::duration<double>(Clock::now() - start).count();
+
+    start = Clock::now();
+    for (int i = 0; i < frames; i++)
+    {
+        optimized.Replay(backend);
+    }
+    const double replayOptimized = std::chrono::duration<double>(Clock::now() - start).count();
+
+    timings.commands = list.Commands();
+    timings.bytes = list.Bytes();
+    timings.immediateMicroseconds = immediate * 1e6 / frames;
+    timings.recordMicroseconds = record * 1e6 / frames;
+    timings.replayMicroseconds = replay * 1e6 / frames;
+    timings.optimizedCommands = stats.commandsOut;
+    timings.colors = stats.colorsIn;
+    timings.optimizedColors = stats.colorsOut;
+    timings.optimizeMicroseconds = optimize * 1e6 / frames;
+    timings.replayOptimizedMicroseconds = replayOptimized * 1e6 / frames;
+
+    // immediate issue and replay must reach a backend as the same commands, argument for argument
+    DisplayList issued, replayed;
+    RecordingBackend issuedRecorder(issued), replayRecorder(replayed);
+    EmitScene(scene, k, &scratch, issuedRecorder);
+    list.Replay(replayRecorder);
+    timings.replaySame = issued == replayed && replayed == list;
+
+    // the optimizer must not change a pixel; the software renderer draws rectangles as ellipses, so it is compared on the
+    // list it takes, recorded without splats, where the optimizer drops and reorders shapes but merges nothing
+    SceneDisplayList::Key software = k;
+    software.splat = false;
+    SceneDisplayList::Record(scene, software, &scratch, list);
+    OptimizeDisplayList(list, SceneDisplayList::PixelGrid(software), &scratch, optimized);
+    SoftwareRenderer before, after;
+    RenderSoftware(list, software, &scratch, before);
+    RenderSoftware(optimized, software, &scratch, after);
+    timings.optimizedPixelsDiffering = 0;
+    for (size_t i = 0; i < static_cast<size_t>(before.Width()) * before.Height(); i++)
+    {
+        timings.optimizedPixelsDiffering += before.Pixels()[i] != after.Pixels()[i];
+    }
+}
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+#include "batch.h"
+
+class Scene;
+class DisplayListOptimizer;
+struct ID2D1RenderTarget;
+struct ID2D1SolidColorBrush;
+
+/*
+ - Direct2D draws immediately: without a record of the last frame, every paint culls the scene and issues every
+   command again, even when nothing changed but the hover outline
+ - a 'DisplayList' records the drawing commands once and replays them as often as needed, to any 'DisplayListBackend'
+   (Direct2D, or the batch the software renderer takes)
+ - commands are packed one after the other in a single array of 32-bit words: an opcode word, then the arguments
+   (colors as 0xAARRGGBB, coordinates as floats); an ellipse takes 20 bytes, and replay reads memory strictly in order
+ - recording reuses the array's capacity, so after the first few frames recording allocates nothing
+*/
+
+enum class DisplayOp : uint32_t
+{
+    Clear,          // color
+    SetColor,       // color; the fill color of the commands that follow
+    FillEllipse,    // center x, center y, radius x, radius y
+    FillRectangle,  // left, top, right, bottom
+};
+
+
+class DisplayListBackend
+{
+public:
+    virtual ~DisplayListBackend() {}
+
+    virtual void Clear(UINT32 color) = 0;
+    virtual void SetColor(UINT32 color) = 0;
+    virtual void FillEllipse(float cx, float cy, float rx, float ry) = 0;
+    virtual void FillRectangle(float left, float top, float right, float bottom) = 0;
+};
+
+
+class DisplayList
+{
+    std::vector<uint32_t> words;
+    size_t commands;
+    size_t shapes; // fill commands
+
+    void Push(DisplayOp op) { words.push_back(static_cast<uint32_t>(op)); commands++; }
+    void PushFloat(float f);
+
+public:
+    DisplayList() : commands(0), shapes(0) {}
+
+    // empties the list, keeping its memory
+    void Reset()
+    {
+        words.clear();
+        commands = shapes = 0;
+    }
+
+    void Clear(UINT32 color) { Push(DisplayOp::Clear); words.push_back(color); }
+    void SetColor(UINT32 color) { Push(DisplayOp::SetColor); words.push_back(color); }
+    void FillEllipse(float cx, float cy, float rx, float ry);
+    void FillRectangle(float left, float top, float right, float bottom);
+
+    void Replay(DisplayListBackend& backend) const;
+
+    // the same commands with the same arguments, bit for bit
+    bool operator==(const DisplayList& other) const { return words == other.words; }
+
+    size_t Commands() const { return commands; }
+    size_t Shapes() const { return shapes; }
+    size_t Bytes() const { return words.size() * sizeof(uint32_t); }
+};
+
+
+// where the device pixels fall in list coordinates: pixel (0, 0) starts at the origin, one pixel is 'sizeX' x 'sizeY'
+struct DisplayPixelGrid
+{
+    float originX, originY;
+    float sizeX, sizeY;
+};
+
+
+// issues the commands to a Direct2D render target, filling with one brush recolored by 'SetColor'
+class D2DDisplayBackend : public DisplayListBackend
+{
+    ID2D1RenderTarget* pRenderTarget;
+    ID2D1SolidColorBrush* pBrush;
+
+public:
+    D2DDisplayBackend(ID2D1RenderTarget* target, ID2D1SolidColorBrush* brush) : pRenderTarget(target), pBrush(brush) {}
+
+    void Clear(UINT32 color) override;
+    void SetColor(UINT32 color) override;
+    void FillEllipse(float cx, float cy, float rx, float ry) override;
+    void FillRectangle(float left, float top, float right, float bottom) override;
+};
+
+
+// gathers the commands into an 'EllipseBatch' for the software renderer; a rectangle becomes the ellipse inside it
+class BatchDisplayBackend : public DisplayListBackend
+{
+    BatchArrays& out;
+    UINT32 color;
+    UINT32 background;
+
+public:
+    explicit BatchDisplayBackend(BatchArrays& batch) : out(batch), color(0xFF000000), background(0xFFFFFFFF) {}
+
+    UINT32 Background() const { return background; }
+
+    void Clear(UINT32 c) override { background = c; out.cx.clear(); out.cy.clear(); out.rx.clear(); out.ry.clear(); out.colors.clear(); out.ids.clear(); }
+    void SetColor(UINT32 c) override { color = c; }
+    void FillEllipse(float cx, float cy, float rx, float ry) override { out.Push(static_cast<uint32_t>(out.ids.size()), cx, cy, rx, ry, color); }
+    void FillRectangle(float left, float top, float right, float bottom) override
+    {
+        FillEllipse((left + right) / 2, (top + bottom) / 2, (right - left) / 2, (bottom - top) / 2);
+    }
+};
+
+
+/*
+ - the display list of the visible part of the scene: the background, then every shape overlapping the view
+   in z-order, with a color change only where the color changes
+ - with 'splat', shapes smaller than 'SplatRadius' pixels are recorded as a one-pixel rectangle snapped to the pixel grid
+   (see 'SplatRadius'); the software renderer splats by itself, so it takes lists recorded without
+ - the list is kept until the scene changes ('Scene::Version') or is looked at differently (view, scale, splat),
+   so a frame that only moves the hover outline replays the list instead of culling and recording again
+ - a list asked for again unchanged is optimized once ('OptimizeDisplayList', on the optimizer's thread) and the
+   optimized one is kept instead as soon as it is back; a list that changes every frame (panning, dragging a shape)
+   is never optimized, so it does not pay for the pass
+*/
+class SceneDisplayList
+{
+public:
+    struct Key
+    {
+        uint64_t version;
+        float left, top, right, bottom; // view, world coordinates
+        float pixelsX, pixelsY;         // world to device pixels
+        bool splat;
+        UINT32 background;
+
+        bool operator==(const Key& other) const
+        {
+            return version == other.version && left == other.left && top == other.top && right == other.right &&
+                bottom == other.bottom && pixelsX == other.pixelsX && pixelsY == other.pixelsY && splat == other.splat &&
+                background == other.background;
+        }
+    };
+
+private:
+    DisplayList list;
+    Key key;
+    bool valid;
+    bool optimize;
+    bool submitted; // 'list' went to the optimizer
+    bool optimized; // 'list' is the optimized one
+    uint64_t recording; // counts the recordings, to tell the optimizer's results apart
+    size_t recorded, reused;
+    size_t recordedCommands; // of 'list' before it was optimized
+
+public:
+    SceneDisplayList() : key(), valid(false), optimize(true), submitted(false), optimized(false), recording(0), recorded(0), reused(0),
+        recordedCommands(0) {}
+
+    // records the list for 'k' unless it is already the one kept; 'scratch' holds the culled shapes while recording;
+    // a list kept unchanged goes to 'optimizer', and the optimized one replaces it once it is back
+    const DisplayList& Get(const Scene& scene, const Key& k, std::pmr::memory_resource* scratch, DisplayListOptimizer& optimizer);
+
+    static void Record(const Scene& scene, const Key& k, std::pmr::memory_resource* scratch, DisplayList& out);
+
+    // the device pixels of a list recorded for 'k', for the optimizer
+    static DisplayPixelGrid PixelGrid(const Key& k);
+
+    void Invalidate() { valid = false; }
+
+    // switching the optimizer off records the list again, unoptimized
+    void SetOptimize(bool on)
+    {
+        optimize = on;
+        valid = false;
+    }
+    bool Optimize() const { return optimize; }
+
+    size_t Recorded() const { return recorded; }
+    size_t Reused() const { return reused; }
+    size_t RecordedCommands() const { return recordedCommands; }
+    size_t Commands() const { return list.Commands(); }
+};
+
+
+struct DisplayListTimings
+{
+    size_t commands;
+    size_t bytes;
+    double immediateMicroseconds; // culling and issuing every command, as 'OnPaint' did without a list
+    double recordMicroseconds;    // culling and recording
+    double replayMicroseconds;    // replaying the recorded list
+
+    size_t optimizedCommands;
+    size_t colors, optimizedColors; // 'SetColor' commands
+    double optimizeMicroseconds;        // one pass of 'OptimizeDisplayList' over the recorded list
+    double replayOptimizedMicroseconds; // replaying the optimized list
+
+    bool replaySame;                 // replaying the list issued exactly what immediate issue did
+    size_t optimizedPixelsDiffering; // of the software renderer's list (no splats), optimized against recorded
+};
+
+// times each way of producing one frame of 'scene' seen through 'k', over 'frames' frames, with a backend that only
+// counts the commands, so what is measured is the cost of producing them rather than drawing them;
+// then checks that recording and optimizing change nothing drawn (see 'replaySame', 'optimizedPixelsDiffering')
+void MeasureDisplayList(const Scene& scene, const SceneDisplayList::Key& k, int frames, DisplayListTimings& timings);
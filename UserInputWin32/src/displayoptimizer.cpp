@@ -0,0 +1,424 @@
+#include <windows.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <stdio.h>
+
+#include "displayoptimizer.h"
+
+namespace
+{
+    const double Eps = 1e-3;                 // pixels; an edge this close to a pixel boundary is on it
+    const double MaxPixel = 1 << 30;         // pixel coordinates are clamped to this, far outside any view
+    const int64_t MaxCells = int64_t(1) << 21; // a 1920 x 1080 view still gets one cell per pixel
+
+    // one fill command, with the pixels it touches and the pixels it fully covers, as half-open ranges
+    struct Fill
+    {
+        bool rectangle;
+        bool aligned; // a rectangle whose edges are on pixel boundaries, so it touches exactly the pixels it covers
+        UINT32 color;
+        float a, b, c, d; // the arguments of the command
+        int x0, y0, x1, y1; // touched
+        int cx0, cy0, cx1, cy1; // covered, empty unless the color is opaque
+    };
+
+    int Clamp(double v)
+    {
+        return static_cast<int>(std::max(-MaxPixel, std::min(MaxPixel, v)));
+    }
+
+    // decodes a list into its fills; everything before the last 'Clear' is dropped, as it is cleared away
+    class GatherBackend : public DisplayListBackend
+    {
+        std::pmr::vector<Fill>& fills;
+        const DisplayPixelGrid& pixels;
+        UINT32 color;
+
+        void Add(bool rectangle, float left, float top, float right, float bottom, float a, float b, float c, float d)
+        {
+            // nothing is drawn for a transparent color, an empty shape or one that is not a number
+            if ((color >> 24) == 0 || !(right > left && bottom > top) || !std::isfinite(left + top + right + bottom))
+            {
+                dropped++;
+                return;
+            }
+
+            const double l = (left - pixels.originX) / pixels.sizeX, r = (right - pixels.originX) / pixels.sizeX;
+            const double t = (top - pixels.originY) / pixels.sizeY, btm = (bottom - pixels.originY) / pixels.sizeY;
+
+            Fill f = { rectangle, false, color, a, b, c, d, 0, 0, 0, 0, 0, 0, 0, 0 };
+            f.x0 = Clamp(std::floor(l + Eps));
+            f.y0 = Clamp(std::floor(t + Eps));
+            f.x1 = std::max(f.x0 + 1, Clamp(std::ceil(r - Eps)));
+            f.y1 = std::max(f.y0 + 1, Clamp(std::ceil(btm - Eps)));
+            f.aligned = rectangle && std::fabs(l - f.x0) < Eps && std::fabs(t - f.y0) < Eps &&
+                std::fabs(r - f.x1) < Eps && std::fabs(btm - f.y1) < Eps;
+
+            if ((color >> 24) == 0xFF)
+            {
+                // an ellipse fully covers the rectangle inscribed in it: half the radii times sqrt(2)
+                double cl = l, ct = t, cr = r, cb = btm;
+                if (!rectangle)
+                {
+                    const double hx = (r - l) / 2 * 0.70710678, hy = (btm - t) / 2 * 0.70710678;
+                    const double mx = (l + r) / 2, my = (t + btm) / 2;
+                    cl = mx - hx; cr = mx + hx; ct = my - hy; cb = my + hy;
+                }
+                f.cx0 = Clamp(std::ceil(cl - Eps));
+                f.cy0 = Clamp(std::ceil(ct - Eps));
+                f.cx1 = Clamp(std::floor(cr + Eps));
+                f.cy1 = Clamp(std::floor(cb + Eps));
+            }
+            fills.push_back(f);
+        }
+
+    public:
+        bool cleared;
+        UINT32 background;
+        size_t colors;
+        size_t dropped;
+
+        GatherBackend(std::pmr::vector<Fill>& out, const DisplayPixelGrid& grid)
+            : fills(out), pixels(grid), color(0xFF000000), cleared(false), background(0), colors(0), dropped(0) {}
+
+        void Clear(UINT32 c) override
+        {
+            dropped += fills.size();
+            fills.clear();
+            cleared = true;
+            background = c;
+        }
+
+        void SetColor(UINT32 c) override
+        {
+            color = c;
+            colors++;
+        }
+
+        void FillEllipse(float cx, float cy, float rx, float ry) override
+        {
+            rx = std::fabs(rx);
+            ry = std::fabs(ry);
+            Add(false, cx - rx, cy - ry, cx + rx, cy + ry, cx, cy, rx, ry);
+        }
+
+        void FillRectangle(float left, float top, float right, float bottom) override
+        {
+            Add(true, left, top, right, bottom, left, top, right, bottom);
+        }
+    };
+
+    // cells over the extent of the fills, 2^shift pixels on a side
+    struct CellGrid
+    {
+        int minX, minY;
+        int shift;
+        int64_t width, height;
+
+        CellGrid(const std::pmr::vector<Fill>& fills)
+        {
+            int maxX = 0, maxY = 0;
+            minX = minY = 0;
+            for (size_t i = 0; i < fills.size(); i++)
+            {
+                const Fill& f = fills[i];
+                minX = i == 0 ? f.x0 : std::min(minX, f.x0);
+                minY = i == 0 ? f.y0 : std::min(minY, f.y0);
+                maxX = i == 0 ? f.x1 : std::max(maxX, f.x1);
+                maxY = i == 0 ? f.y1 : std::max(maxY, f.y1);
+            }
+
+            shift = 0;
+            for (;;)
+            {
+                width = ((static_cast<int64_t>(maxX) - minX) >> shift) + 1;
+                height = ((static_cast<int64_t>(maxY) - minY) >> shift) + 1;
+                if (width * height <= MaxCells)
+                {
+                    break;
+                }
+                shift++;
+            }
+        }
+
+        int64_t Cells() const { return width * height; }
+
+        // the cells a half-open pixel range touches, as an inclusive cell range
+        int64_t TouchLo(int p, int min) const { return (static_cast<int64_t>(p) - min) >> shift; }
+        int64_t TouchHi(int p, int min) const { return (static_cast<int64_t>(p) - 1 - min) >> shift; }
+
+        // the cells lying entirely inside a half-open pixel range, as an inclusive cell range (empty when hi < lo)
+        int64_t InsideLo(int p, int min) const { return (static_cast<int64_t>(p) - min + (int64_t(1) << shift) - 1) >> shift; }
+        int64_t InsideHi(int p, int min) const { return ((static_cast<int64_t>(p) - min) >> shift) - 1; }
+    };
+}
+
+
+void OptimizeDisplayList(const DisplayList& in, const DisplayPixelGrid& pixels, std::pmr::memory_resource* scratch,
+    DisplayList& out, DisplayListStats* stats)
+{
+    std::pmr::vector<Fill> fills(scratch);
+    fills.reserve(in.Shapes());
+    GatherBackend gather(fills, pixels);
+    in.Replay(gather);
+
+    const CellGrid grid(fills);
+    const size_t n = fills.size();
+    size_t overdrawn = gather.dropped;
+
+    // back to front: a fill is hidden when every cell it touches is covered by the opaque fills drawn after it
+    std::pmr::vector<uint8_t> covered(static_cast<size_t>(grid.Cells()), 0, scratch);
+    std::pmr::vector<uint8_t> keep(n, 0, scratch);
+    for (size_t i = n; i-- > 0; )
+    {
+        const Fill& f = fills[i];
+        const int64_t x0 = grid.TouchLo(f.x0, grid.minX), x1 = grid.TouchHi(f.x1, grid.minX);
+        const int64_t y0 = grid.TouchLo(f.y0, grid.minY), y1 = grid.TouchHi(f.y1, grid.minY);
+
+        bool hidden = true;
+        for (int64_t y = y0; y <= y1 && hidden; y++)
+        {
+            for (int64_t x = x0; x <= x1; x++)
+            {
+                if (!covered[static_cast<size_t>(y * grid.width + x)])
+                {
+                    hidden = false;
+                    break;
+                }
+            }
+        }
+        if (hidden)
+        {
+            overdrawn++;
+            continue;
+        }
+        keep[i] = 1;
+
+        const int64_t cx0 = grid.InsideLo(f.cx0, grid.minX), cx1 = grid.InsideHi(f.cx1, grid.minX);
+        const int64_t cy0 = grid.InsideLo(f.cy0, grid.minY), cy1 = grid.InsideHi(f.cy1, grid.minY);
+        if (f.cx1 <= f.cx0 || f.cy1 <= f.cy0)
+        {
+            continue; // covers no whole pixel (or is not opaque)
+        }
+        for (int64_t y = cy0; y <= cy1; y++)
+        {
+            std::fill_n(covered.begin() + static_cast<ptrdiff_t>(y * grid.width + cx0), std::max<int64_t>(0, cx1 - cx0 + 1), uint8_t(1));
+        }
+    }
+
+    // front to back: a fill joins the last run of its color unless a later run already drew over one of its cells
+    std::pmr::vector<uint32_t> latest(static_cast<size_t>(grid.Cells()), 0, scratch); // run + 1 of the last fill per cell
+    std::pmr::vector<UINT32> runColors(scratch);
+    std::pmr::vector<uint32_t> runOf(n, 0, scratch);
+    std::pmr::vector<uint32_t> order(scratch);
+    for (size_t i = 0; i < n; i++)
+    {
+        if (!keep[i])
+        {
+            continue;
+        }
+        const Fill& f = fills[i];
+        const int64_t x0 = grid.TouchLo(f.x0, grid.minX), x1 = grid.TouchHi(f.x1, grid.minX);
+        const int64_t y0 = grid.TouchLo(f.y0, grid.minY), y1 = grid.TouchHi(f.y1, grid.minY);
+
+        uint32_t last = 0; // run + 1 of the latest run drawn under this fill
+        for (int64_t y = y0; y <= y1; y++)
+        {
+            for (int64_t x = x0; x <= x1; x++)
+            {
+                last = std::max(last, latest[static_cast<size_t>(y * grid.width + x)]);
+            }
+        }
+
+        // the runs of one color are few (a new one only starts when an older one is blocked), so searching back is short
+        uint32_t run = static_cast<uint32_t>(runColors.size());
+        for (uint32_t r = run; r-- > 0 && r + 1 >= last; )
+        {
+            if (runColors[r] == f.color)
+            {
+                run = r;
+                break;
+            }
+        }
+        if (run == runColors.size())
+        {
+            runColors.push_back(f.color);
+        }
+        runOf[i] = run;
+        order.push_back(static_cast<uint32_t>(i));
+
+        for (int64_t y = y0; y <= y1; y++)
+        {
+            for (int64_t x = x0; x <= x1; x++)
+            {
+                uint32_t& cell = latest[static_cast<size_t>(y * grid.width + x)];
+                cell = std::max(cell, run + 1);
+            }
+        }
+    }
+
+    // by run; within a run, rectangles by row and then left edge so neighbours end up next to each other
+    std::sort(order.begin(), order.end(), [&](uint32_t p, uint32_t q)
+    {
+        const Fill& a = fills[p];
+        const Fill& b = fills[q];
+        if (runOf[p] != runOf[q]) return runOf[p] < runOf[q];
+        if (a.aligned != b.aligned) return b.aligned;
+        if (a.aligned && (a.y0 != b.y0 || a.y1 != b.y1)) return a.y0 != b.y0 ? a.y0 < b.y0 : a.y1 < b.y1;
+        if (a.aligned && a.x0 != b.x0) return a.x0 < b.x0;
+        return p < q;
+    });
+
+    out.Reset();
+    if (gather.cleared)
+    {
+        out.Clear(gather.background);
+    }
+
+    size_t merged = 0;
+    bool haveColor = false;
+    UINT32 color = 0;
+    const Fill* pending = nullptr; // an aligned rectangle that the next one may extend
+    float pendingRight = 0;
+    auto flush = [&]()
+    {
+        if (pending)
+        {
+            out.FillRectangle(pending->a, pending->b, pendingRight, pending->d);
+            pending = nullptr;
+        }
+    };
+    for (size_t k = 0; k < order.size(); k++)
+    {
+        const Fill& f = fills[order[k]];
+        if (pending && f.aligned && runOf[order[k]] == runOf[order[k - 1]] && f.y0 == pending->y0 && f.y1 == pending->y1 &&
+            f.x0 == fills[order[k - 1]].x1)
+        {
+            pendingRight = f.c;
+            merged++;
+            continue;
+        }
+        flush();
+
+        if (!haveColor || f.color != color)
+        {
+            color = f.color;
+            haveColor = true;
+            out.SetColor(color);
+        }
+        if (f.aligned)
+        {
+            pending = &f;
+            pendingRight = f.c;
+        }
+        else if (f.rectangle)
+        {
+            out.FillRectangle(f.a, f.b, f.c, f.d);
+        }
+        else
+        {
+            out.FillEllipse(f.a, f.b, f.c, f.d);
+        }
+    }
+    flush();
+
+    if (stats)
+    {
+        stats->commandsIn = in.Commands();
+        stats->commandsOut = out.Commands();
+        stats->colorsIn = gather.colors;
+        stats->colorsOut = runColors.size();
+        stats->overdrawn = overdrawn;
+        stats->merged = merged;
+    }
+}
+
+
+DisplayListOptimizer::DisplayListOptimizer()
+    : stopping(false), queued(false), running(false), ready(false), ticket(0), pixels(), stats()
+{
+    // started last, once every member it uses exists
+    worker = std::thread(&DisplayListOptimizer::WorkerMain, this);
+}
+
+DisplayListOptimizer::~DisplayListOptimizer()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+bool DisplayListOptimizer::Submit(const DisplayList& list, const DisplayPixelGrid& grid, uint64_t submission)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (queued || running)
+        {
+            return false;
+        }
+        input = list; // reuses the capacity of the last copy
+        pixels = grid;
+        ticket = submission;
+        queued = true;
+        ready = false;
+    }
+    wake.notify_one();
+    return true;
+}
+
+bool DisplayListOptimizer::Take(uint64_t submission, DisplayList& out, DisplayListStats* passStats)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (!ready || ticket != submission)
+    {
+        return false;
+    }
+    std::swap(out, output);
+    if (passStats)
+    {
+        *passStats = stats;
+    }
+    ready = false;
+    return true;
+}
+
+void DisplayListOptimizer::WorkerMain()
+{
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            wake.wait(guard, [this] { return stopping || queued; });
+            if (stopping)
+            {
+                return;
+            }
+            queued = false;
+            running = true;
+        }
+
+        // 'input' and 'output' are only touched here while 'running' is set
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        DisplayListStats passStats;
+        {
+            std::pmr::monotonic_buffer_resource scratch; // released at the end of the pass
+            OptimizeDisplayList(input, pixels, &scratch, output, &passStats);
+        }
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        wchar_t msg[128];
+        swprintf_s(msg, L"display list: optimized %zu commands to %zu in %.1f ms\n", passStats.commandsIn, passStats.commandsOut, ms);
+        OutputDebugString(msg);
+
+        std::lock_guard<std::mutex> guard(lock);
+        stats = passStats;
+        running = false;
+        ready = true;
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <mutex>
+#include <thread>
+
+#include "displaylist.h"
+
+/*
+ - a recorded list is submitted as it was recorded: one color change wherever z-order alternates colors,
+   shapes that a later opaque shape hides completely, and one rectangle per splatted pixel
+ - 'OptimizeDisplayList' rewrites a list into one that draws the same pixels with fewer commands:
+    - overdraw: walking back to front, a shape is dropped when every pixel it touches is already fully covered by later
+      opaque shapes (a rectangle, or the rectangle inscribed in an ellipse); anything before the last 'Clear' goes too
+    - reordering: a shape moves back to the last run of its color when no shape drawn after that run overlaps it,
+      so each color is set once per run instead of once per alternation ("hoisting" the color changes)
+    - merging: within a run, pixel-aligned rectangles on the same rows that touch end to end become one rectangle
+ - overlap and coverage are decided in whole device pixels of 'DisplayPixelGrid', so anti-aliased edges count as touched
+   but never as covered; shapes of one color commute (drawing c over c in any order gives the same pixels), so
+   the order within a run does not matter
+ - both passes work on one grid of cells over the list's extent: a 'covered' flag and the latest run drawn per cell;
+   a cell is one pixel unless the extent is too large, then cells grow and the answers only get more conservative
+ - the cost of a shape is the number of cells it touches, so the pass runs when a list is kept, not on every recording,
+   and on a thread of its own ('DisplayListOptimizer'): a large scene takes tens of milliseconds, a visible hitch if
+   it ran in 'OnPaint'
+*/
+
+struct DisplayListStats
+{
+    size_t commandsIn, commandsOut;
+    size_t colorsIn, colorsOut;   // 'SetColor' commands
+    size_t overdrawn;             // shapes dropped as hidden (or drawing nothing at all)
+    size_t merged;                // rectangles folded into their neighbour
+};
+
+// 'out' is reset first and must not be 'in'; 'scratch' holds the decoded shapes while optimizing
+void OptimizeDisplayList(const DisplayList& in, const DisplayPixelGrid& pixels, std::pmr::memory_resource* scratch,
+    DisplayList& out, DisplayListStats* stats = nullptr);
+
+
+/*
+ - runs 'OptimizeDisplayList' on a thread of its own, one list at a time, like 'Autosaver'
+ - the UI thread submits a copy of the list it keeps drawing, and takes the optimized one once it is ready;
+   a ticket names each submission, so a result for a list that has been recorded again since is never taken
+ - the optimizer's scratch memory (the decoded shapes and the cell grid, megabytes for a large scene) belongs to the
+   worker and is given back after every pass, instead of growing the frame arena for good
+*/
+class DisplayListOptimizer
+{
+    std::mutex lock;
+    std::condition_variable wake;
+    bool stopping;
+    bool queued;   // 'input' waits for the worker
+    bool running;  // the worker is optimizing; 'input' and 'output' are its own
+    bool ready;    // 'output' is the optimized list of 'ticket'
+    uint64_t ticket;
+    DisplayList input, output;
+    DisplayPixelGrid pixels;
+    DisplayListStats stats;
+    std::thread worker;
+
+    void WorkerMain();
+
+public:
+    DisplayListOptimizer();
+    ~DisplayListOptimizer();
+
+    DisplayListOptimizer(const DisplayListOptimizer&) = delete;
+    DisplayListOptimizer& operator=(const DisplayListOptimizer&) = delete;
+
+    // starts optimizing a copy of 'list'; false, and nothing is copied, while an earlier submission is unfinished
+    bool Submit(const DisplayList& list, const DisplayPixelGrid& grid, uint64_t submission);
+
+    // swaps the optimized list of 'submission' into 'out' if it is ready; the list 'out' held is reused for the next one
+    bool Take(uint64_t submission, DisplayList& out, DisplayListStats* passStats = nullptr);
+};
@@ -0,0 +1,565 @@
+#include <windows.h>
+#include <d2d1.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <random>
+
+#include "document.h"
+
+namespace
+{
+    const char Magic[4] = { 'E', 'L', 'P', 'H' };
+    const char JournalMagic[4] = { 'E', 'L', 'P', 'J' };
+    const uint32_t Version = 1;
+
+    Operation MakeOperation(OpType type, size_t shape, const D2D1_ELLIPSE& e, UINT32 color)
+    {
+        Operation op = { type, static_cast<uint32_t>(shape), e.point.x, e.point.y, e.radiusX, e.radiusY, color };
+        return op;
+    }
+
+    void ApplyTo(Scene& scene, const Operation& op)
+    {
+        const D2D1_ELLIPSE e = D2D1::Ellipse(D2D1::Point2F(op.cx, op.cy), op.rx, op.ry);
+        switch (op.type)
+        {
+        case OpType::Create:  scene.Add(e, op.color); break;
+        case OpType::Resize:  scene.Set(op.shape, e); break;
+        case OpType::Delete:  scene.Remove(op.shape); break;
+        case OpType::Recolor: scene.SetColor(op.shape, op.color); break;
+        }
+    }
+
+    template <typename T>
+    void Write(std::ofstream& file, const T& value)
+    {
+        file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    template <typename T>
+    void Read(std::ifstream& file, T& value)
+    {
+        file.read(reinterpret_cast<char*>(&value), sizeof(value));
+    }
+
+    // bytes left after the read position; every count read from a file is checked against it before anything is
+    // allocated for it, so a damaged file fails to open instead of asking for gigabytes
+    uint64_t Remaining(std::ifstream& file)
+    {
+        const std::streampos here = file.tellg();
+        file.seekg(0, std::ios::end);
+        const std::streampos end = file.tellg();
+        file.seekg(here);
+        return here < 0 || end < here ? 0 : static_cast<uint64_t>(end - here);
+    }
+}
+
+
+bool SameDrawing(const Scene& a, const Scene& b)
+{
+    if (a.Count() != b.Count())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < a.Count(); i++)
+    {
+        if (a.Alive(i) != b.Alive(i) || a.Color(i) != b.Color(i))
+        {
+            return false;
+        }
+        const D2D1_ELLIPSE x = a.Get(i), y = b.Get(i);
+        if (a.Alive(i) && (x.point.x != y.point.x || x.point.y != y.point.y || x.radiusX != y.radiusX || x.radiusY != y.radiusY))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+Document::Document(Scene& scene) : scene(scene), count(0), position(0), written(0), unsavedFrom(0), unsaved(false)
+{
+    Clear();
+    unsaved = false; // nothing worth saving yet
+}
+
+void Document::Clear()
+{
+    chunks.clear();
+    handedOut.clear();
+    count = position = written = 0;
+    unsavedFrom = 0;
+    unsaved = true;
+    snapshots.clear();
+    scene.Clear();
+    TakeSnapshot();
+}
+
+size_t Document::CreateShape(const D2D1_ELLIPSE& e, UINT32 color)
+{
+    // the scene shows the state at 'position', which is also where 'Append' continues the log
+    const size_t shape = scene.Count();
+    Append(MakeOperation(OpType::Create, shape, e, color));
+    return shape;
+}
+
+void Document::Resize(size_t shape, const D2D1_ELLIPSE& e)
+{
+    Append(MakeOperation(OpType::Resize, shape, e, 0));
+}
+
+void Document::Delete(size_t shape)
+{
+    Append(MakeOperation(OpType::Delete, shape, D2D1::Ellipse(D2D1::Point2F(0, 0), 0, 0), 0));
+}
+
+void Document::Recolor(size_t shape, UINT32 color)
+{
+    Append(MakeOperation(OpType::Recolor, shape, D2D1::Ellipse(D2D1::Point2F(0, 0), 0, 0), color));
+}
+
+void Document::Append(const Operation& op)
+{
+    // drop the operations (and the snapshots) after the state being shown
+    if (position < count)
+    {
+        count = position;
+        while (snapshots.back().at > position)
+        {
+            snapshots.pop_back();
+        }
+        unsavedFrom = std::min(unsavedFrom, count);
+    }
+
+    const size_t chunk = count / ChunkSize;
+    if (chunk == chunks.size())
+    {
+        chunks.push_back(std::make_shared<Operation[]>(ChunkSize));
+        handedOut.push_back(false);
+    }
+    else if (count < written && handedOut[chunk])
+    {
+        // overwriting an operation an autosave may still be reading: copy on write
+        std::shared_ptr<Operation[]> copy = std::make_shared<Operation[]>(ChunkSize);
+        std::copy(chunks[chunk].get(), chunks[chunk].get() + ChunkSize, copy.get());
+        chunks[chunk] = std::move(copy);
+        handedOut[chunk] = false;
+    }
+    chunks[chunk][count % ChunkSize] = op;
+    count++;
+    written = std::max(written, count);
+    unsaved = true;
+
+    Apply(op);
+    position = count;
+
+    if (position - snapshots.back().at >= std::max(MinSnapshotInterval, scene.Count()))
+    {
+        TakeSnapshot();
+    }
+}
+
+void Document::Apply(const Operation& op)
+{
+    ApplyTo(scene, op);
+}
+
+void Document::TakeSnapshot()
+{
+    Snapshot snapshot;
+    snapshot.at = position;
+    snapshot.shapes.reserve(scene.Count() * 4);
+    snapshot.colors.reserve(scene.Count());
+    for (size_t i = 0; i < scene.Count(); i++)
+    {
+        const D2D1_ELLIPSE e = scene.Get(i);
+        snapshot.shapes.push_back(e.point.x);
+        snapshot.shapes.push_back(e.point.y);
+        snapshot.shapes.push_back(e.radiusX);
+        snapshot.shapes.push_back(e.radiusY);
+        snapshot.colors.push_back(scene.Color(i));
+    }
+    snapshots.push_back(std::move(snapshot));
+}
+
+void Document::Restore(const Snapshot& snapshot)
+{
+    scene.Clear();
+    for (size_t i = 0; i < snapshot.colors.size(); i++)
+    {
+        const float* s = &snapshot.shapes[i * 4];
+        if (std::isnan(s[0]))
+        {
+            // a removed shape still takes up its id
+            scene.Remove(scene.Add(D2D1::Ellipse(D2D1::Point2F(0, 0), 0, 0), snapshot.colors[i]));
+        }
+        else
+        {
+            scene.Add(D2D1::Ellipse(D2D1::Point2F(s[0], s[1]), s[2], s[3]), snapshot.colors[i]);
+        }
+    }
+    position = snapshot.at;
+}
+
+size_t Document::Seek(size_t target)
+{
+    target = std::min(target, count);
+
+    // the last snapshot at or before 'target'
+    const auto next = std::upper_bound(snapshots.begin(), snapshots.end(), target,
+        [](size_t at, const Snapshot& s) { return at < s.at; });
+    const Snapshot& snapshot = *(next - 1);
+
+    // moving forward within the same interval needs no restore
+    if (position > target || position < snapshot.at)
+    {
+        Restore(snapshot);
+    }
+
+    const size_t replayed = target - position;
+    for (; position < target; position++)
+    {
+        Apply(At(position));
+    }
+    return replayed;
+}
+
+void Document::Replay(size_t target, Scene& out) const
+{
+    out.Clear();
+    for (size_t i = 0; i < std::min(target, count); i++)
+    {
+        ApplyTo(out, At(i));
+    }
+}
+
+
+// the unsaved operations are handed over by reference: this only copies the pointers to the chunks they are in
+LogSlice Document::TakeUnsaved()
+{
+    LogSlice slice;
+    slice.first = unsavedFrom;
+    slice.last = count;
+    slice.firstChunk = unsavedFrom / ChunkSize;
+    for (size_t c = slice.firstChunk; c * ChunkSize < count; c++)
+    {
+        slice.chunks.push_back(chunks[c]);
+        handedOut[c] = true;
+    }
+
+    unsavedFrom = count;
+    unsaved = false;
+    return slice;
+}
+
+/*
+ - the journal is a sequence of records: the position of the first operation (64 bits), the operation count (64 bits),
+   then the operations; each record first drops the log after its position, then appends its operations
+ - a record cut short by a crash ends the recovery, everything before it is kept
+*/
+bool Document::Recover(const std::filesystem::path& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    char magic[4];
+    uint32_t version = 0;
+    file.read(magic, sizeof(magic));
+    Read(file, version);
+    if (!file || std::memcmp(magic, JournalMagic, sizeof(JournalMagic)) != 0 || version != Version)
+    {
+        return false;
+    }
+
+    Clear();
+    std::vector<Operation> ops;
+    for (bool valid = true; valid; )
+    {
+        uint64_t first = 0, n = 0;
+        Read(file, first);
+        Read(file, n);
+        if (!file || first > count || n > Remaining(file) / sizeof(Operation))
+        {
+            break;
+        }
+        ops.resize(static_cast<size_t>(n));
+        file.read(reinterpret_cast<char*>(ops.data()), ops.size() * sizeof(Operation));
+        if (!file)
+        {
+            break;
+        }
+
+        Seek(static_cast<size_t>(first));
+        for (const Operation& op : ops)
+        {
+            // the same checks as 'Open': never apply an operation to a shape that does not exist
+            if (op.type == OpType::Create ? op.shape != scene.Count() : (op.type > OpType::Recolor || op.shape >= scene.Count()))
+            {
+                valid = false;
+                break;
+            }
+            Append(op);
+        }
+    }
+
+    // the next autosave rewrites the journal from the start, without the records that were replaced or cut short
+    unsavedFrom = 0;
+    unsaved = count > 0;
+    return count > 0;
+}
+
+bool AppendToJournal(const std::filesystem::path& path, const LogSlice& slice)
+{
+    std::ofstream file(path, std::ios::binary | (slice.first == 0 ? std::ios::trunc : std::ios::app));
+    if (!file)
+    {
+        return false;
+    }
+
+    if (slice.first == 0)
+    {
+        file.write(JournalMagic, sizeof(JournalMagic));
+        file.write(reinterpret_cast<const char*>(&Version), sizeof(Version));
+    }
+
+    const uint64_t first = slice.first, n = slice.last - slice.first;
+    file.write(reinterpret_cast<const char*>(&first), sizeof(first));
+    file.write(reinterpret_cast<const char*>(&n), sizeof(n));
+
+    // one write per chunk
+    for (size_t i = slice.first; i < slice.last; )
+    {
+        const size_t end = std::min(slice.last, (i / LogSlice::ChunkSize + 1) * LogSlice::ChunkSize);
+        file.write(reinterpret_cast<const char*>(&slice.At(i)), (end - i) * sizeof(Operation));
+        i = end;
+    }
+    file.flush();
+    return static_cast<bool>(file);
+}
+
+/*
+ - the 4-byte magic "ELPH", a format version, the operation count (64 bits), then every 'Operation' as stored in memory
+ - then the snapshot count, and for each snapshot: its position (64 bits), its shape count, 4 floats per shape and the colors
+*/
+bool Document::Save(const std::filesystem::path& path) const
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        return false;
+    }
+
+    file.write(Magic, sizeof(Magic));
+    Write(file, Version);
+    Write(file, static_cast<uint64_t>(count));
+    for (size_t first = 0; first < count; first += ChunkSize)
+    {
+        const size_t n = std::min(ChunkSize, count - first);
+        file.write(reinterpret_cast<const char*>(chunks[first / ChunkSize].get()), n * sizeof(Operation));
+    }
+
+    Write(file, static_cast<uint32_t>(snapshots.size()));
+    for (const Snapshot& s : snapshots)
+    {
+        Write(file, static_cast<uint64_t>(s.at));
+        Write(file, static_cast<uint32_t>(s.colors.size()));
+        file.write(reinterpret_cast<const char*>(s.shapes.data()), s.shapes.size() * sizeof(float));
+        file.write(reinterpret_cast<const char*>(s.colors.data()), s.colors.size() * sizeof(UINT32));
+    }
+    return static_cast<bool>(file);
+}
+
+bool Document::Open(const std::filesystem::path& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+
+    char magic[4];
+    uint32_t version = 0;
+    uint64_t operations = 0;
+    file.read(magic, sizeof(magic));
+    Read(file, version);
+    Read(file, operations);
+    if (!file || std::memcmp(magic, Magic, sizeof(Magic)) != 0 || version != Version ||
+        operations > Remaining(file) / sizeof(Operation))
+    {
+        return false;
+    }
+
+    std::vector<std::shared_ptr<Operation[]>> loaded;
+    for (uint64_t first = 0; first < operations && file; first += ChunkSize)
+    {
+        loaded.push_back(std::make_shared<Operation[]>(ChunkSize));
+        const size_t n = static_cast<size_t>(std::min<uint64_t>(ChunkSize, operations - first));
+        file.read(reinterpret_cast<char*>(loaded.back().get()), n * sizeof(Operation));
+    }
+
+    // a snapshot takes at least its position and shape count
+    uint32_t snapshotCount = 0;
+    Read(file, snapshotCount);
+    if (!file || snapshotCount > Remaining(file) / (sizeof(uint64_t) + sizeof(uint32_t)))
+    {
+        return false;
+    }
+    std::vector<Snapshot> loadedSnapshots(snapshotCount);
+    for (Snapshot& s : loadedSnapshots)
+    {
+        uint64_t at = 0;
+        uint32_t shapes = 0;
+        Read(file, at);
+        Read(file, shapes);
+        if (!file || shapes > Remaining(file) / (4 * sizeof(float) + sizeof(UINT32)))
+        {
+            return false;
+        }
+        s.at = static_cast<size_t>(at);
+        s.shapes.resize(static_cast<size_t>(shapes) * 4);
+        s.colors.resize(shapes);
+        file.read(reinterpret_cast<char*>(s.shapes.data()), s.shapes.size() * sizeof(float));
+        file.read(reinterpret_cast<char*>(s.colors.data()), s.colors.size() * sizeof(UINT32));
+    }
+    if (!file || loadedSnapshots.empty() || loadedSnapshots[0].at != 0 || !loadedSnapshots[0].colors.empty())
+    {
+        return false;
+    }
+
+    /*
+     - replay only ever applies operations to a scene they are valid for, so check the whole log once here:
+       every operation refers to a shape that exists at that point, and every snapshot has the shape count of its position
+    */
+    size_t shapes = 0, next = 0;
+    for (size_t i = 0; i <= operations; i++)
+    {
+        for (; next < loadedSnapshots.size() && loadedSnapshots[next].at == i; next++)
+        {
+            if (loadedSnapshots[next].colors.size() != shapes)
+            {
+                return false;
+            }
+        }
+        if (i == operations)
+        {
+            break;
+        }
+
+        const Operation& op = loaded[i / ChunkSize][i % ChunkSize];
+        if (op.type == OpType::Create ? op.shape != shapes++ : (op.type > OpType::Recolor || op.shape >= shapes))
+        {
+            return false;
+        }
+    }
+    if (next != loadedSnapshots.size())
+    {
+        return false; // snapshots out of order or past the end of the log
+    }
+
+    chunks = std::move(loaded);
+    handedOut.assign(chunks.size(), false);
+    snapshots = std::move(loadedSnapshots);
+    count = written = static_cast<size_t>(operations);
+    unsavedFrom = 0;
+    unsaved = true;
+    Restore(snapshots[0]);
+    Seek(count);
+    return true;
+}
+
+
+bool MeasureHistory(const std::filesystem::path& path, size_t operations, HistoryTimings& timings)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    // drags: each one creates a shape and resizes it for a while; now and then a shape is recolored or deleted,
+    // or the history is stepped back before the next edit, which drops the operations (and snapshots) after it
+    {
+        Scene scene;
+        Document document(scene);
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> coordinate(0.0f, 2000.0f);
+
+        size_t shape = 0;
+        D2D1_POINT_2F start = D2D1::Point2F(0, 0);
+        for (size_t i = 0; i < operations; i++)
+        {
+            const unsigned roll = random() % 200;
+            if (i == 0 || roll == 0)
+            {
+                start = D2D1::Point2F(coordinate(random), coordinate(random));
+                shape = document.CreateShape(D2D1::Ellipse(start, 1.0f, 1.0f));
+            }
+            else if (roll == 1)
+            {
+                document.Recolor(random() % scene.Count(), random() | 0xFF000000);
+            }
+            else if (roll == 2 && shape > 0)
+            {
+                document.Delete(random() % shape);
+            }
+            else if (roll == 3 && random() % 100 == 0 && document.Position() > 1000)
+            {
+                document.Seek(document.Position() - 1 - random() % 1000);
+                shape = scene.Count() - 1; // the first operation is a create, so there is one
+            }
+            else
+            {
+                const float width = (coordinate(random) - start.x) / 8, height = (coordinate(random) - start.y) / 8;
+                document.Resize(shape, D2D1::Ellipse(D2D1::Point2F(start.x + width, start.y + height), width, height));
+            }
+        }
+        if (!document.Save(path))
+        {
+            return false;
+        }
+    }
+
+    Scene scene;
+    Document document(scene);
+
+    const Clock::time_point start = Clock::now();
+    if (!document.Open(path))
+    {
+        return false;
+    }
+    timings.openSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    timings.operations = document.OperationCount();
+    timings.snapshots = document.SnapshotCount();
+
+    // random positions, so nearly every seek restores a snapshot
+    const int seeks = 100;
+    std::mt19937 random(2);
+    double total = 0;
+    timings.seekMaxSeconds = 0;
+    timings.maxReplayed = 0;
+    for (int i = 0; i < seeks; i++)
+    {
+        const size_t target = random() % (document.OperationCount() + 1);
+        const Clock::time_point before = Clock::now();
+        const size_t replayed = document.Seek(target);
+        const double seconds = std::chrono::duration<double>(Clock::now() - before).count();
+
+        total += seconds;
+        timings.seekMaxSeconds = std::max(timings.seekMaxSeconds, seconds);
+        timings.maxReplayed = std::max(timings.maxReplayed, replayed);
+    }
+    timings.seekMeanSeconds = total / seeks;
+
+    // seeking must show what replaying the whole log shows; replaying is slow, so only a few positions are checked,
+    // reached the way the timed seeks were (forward and backward, across snapshots)
+    Scene replayed;
+    const int checks = 20;
+    timings.seeksChecked = 0;
+    timings.seekMismatches = 0;
+    for (int i = 0; i <= checks; i++)
+    {
+        const size_t target = i == checks ? document.OperationCount() : random() % (document.OperationCount() + 1);
+        document.Seek(target);
+        document.Replay(target, replayed);
+        timings.seeksChecked++;
+        timings.seekMismatches += !SameDrawing(scene, replayed);
+    }
+    return true;
+}
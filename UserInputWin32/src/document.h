@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+#include "scene.h"
+
+/*
+ - the drawing as an append-only log of operations; the scene is only the result of applying the log up to some position
+ - every change to a shape (created, resized or moved, deleted, recolored) is appended as one fixed-size operation,
+   then applied to the scene; shape ids are scene indices, and a deleted shape keeps its id (see 'Scene::Remove')
+ - the log is stored in fixed-size chunks, so appending never copies the operations already logged
+ - a compact snapshot of the whole scene is taken every 'max(MinSnapshotInterval, shape count)' operations,
+    - seeking to any position restores the nearest snapshot before it and replays at most one interval of operations
+    - tying the interval to the shape count keeps the snapshots' total size proportional to the log
+ - after seeking back, the next change drops the operations after the current position (like undo followed by a new edit)
+ - chunks are shared with autosave (see 'LogSlice'), which reads them on another thread; operations are only ever
+   appended past what autosave reads, except after seeking back, and a chunk handed to autosave since it was last copied
+   is copied again before it is written: whether autosave is done with it is not asked ('use_count' is no synchronization)
+*/
+
+enum class OpType : uint32_t { Create, Resize, Delete, Recolor };
+
+struct Operation
+{
+    OpType type;
+    uint32_t shape;
+    float cx, cy, rx, ry; // Create, Resize
+    UINT32 color;         // Create, Recolor
+};
+
+// operations [first, last) of the log, holding references to the chunks they are in so the log can go on changing
+struct LogSlice
+{
+    static const size_t ChunkSize = 65536;
+
+    size_t first;
+    size_t last;
+    size_t firstChunk; // index in the log of chunks[0]
+    std::vector<std::shared_ptr<const Operation[]>> chunks;
+
+    const Operation& At(size_t i) const { return chunks[i / ChunkSize - firstChunk][i % ChunkSize]; }
+};
+
+// timings of '/history', see 'MeasureHistory'
+struct HistoryTimings
+{
+    size_t operations;
+    size_t snapshots;
+    double openSeconds;
+    double seekMeanSeconds;
+    double seekMaxSeconds;
+    size_t maxReplayed; // most operations replayed by one seek
+    size_t seeksChecked;
+    size_t seekMismatches; // checked seeks whose scene differed from replaying the log from the start
+};
+
+class Document
+{
+public:
+    static const size_t ChunkSize = LogSlice::ChunkSize;
+    static const size_t MinSnapshotInterval = 4096;
+
+private:
+    struct Snapshot
+    {
+        size_t at;                  // number of operations applied
+        std::vector<float> shapes;  // center x, center y, radius x, radius y per shape; removed shapes have a NaN center
+        std::vector<UINT32> colors;
+    };
+
+    Scene& scene;
+    std::vector<std::shared_ptr<Operation[]>> chunks;
+    std::vector<bool> handedOut; // per chunk: in a slice taken since the chunk was last copied
+    size_t count;    // operations in the log
+    size_t position; // operations applied to the scene
+    size_t written;  // highest 'count' so far; slots below it may be read by an autosave
+    size_t unsavedFrom; // first operation changed since the last 'TakeUnsaved'
+    bool unsaved;
+    std::vector<Snapshot> snapshots; // ordered by 'at'; the first one is the empty scene
+
+    const Operation& At(size_t i) const { return chunks[i / ChunkSize][i % ChunkSize]; }
+
+    void Append(const Operation& op);
+    void Apply(const Operation& op);
+    void TakeSnapshot();
+    void Restore(const Snapshot& snapshot);
+
+public:
+    explicit Document(Scene& scene);
+
+    Document(const Document&) = delete;
+    Document& operator=(const Document&) = delete;
+
+    size_t CreateShape(const D2D1_ELLIPSE& e, UINT32 color = Scene::DefaultColor); // returns the id of the new shape
+    void Resize(size_t shape, const D2D1_ELLIPSE& e);
+    void Delete(size_t shape);
+    void Recolor(size_t shape, UINT32 color);
+
+    // shows the drawing as it was after the first 'target' operations; returns the number of operations replayed
+    size_t Seek(size_t target);
+
+    // the same drawing built the slow way, into 'out': every operation from the first, no snapshots; what 'Seek' must match
+    void Replay(size_t target, Scene& out) const;
+
+    // what changed since the last call: the caller writes it out, possibly on another thread
+    bool HasUnsaved() const { return unsaved; }
+    LogSlice TakeUnsaved();
+
+    // rebuilds the document from an autosave journal (see 'Autosaver'); returns false if there is nothing to recover
+    bool Recover(const std::filesystem::path& path);
+
+    size_t OperationCount() const { return count; }
+    size_t Position() const { return position; }
+    size_t SnapshotCount() const { return snapshots.size(); }
+
+    void Clear();
+
+    // the log and its snapshots; 'Open' shows the end of the history and returns false if the file is not a document
+    bool Save(const std::filesystem::path& path) const;
+    bool Open(const std::filesystem::path& path);
+};
+
+// same shapes, geometry and colors; a removed shape only has to be removed in both
+bool SameDrawing(const Scene& a, const Scene& b);
+
+// writes 'slice' as one journal record (see 'Document::Recover'); a slice starting at 0 starts a new journal
+bool AppendToJournal(const std::filesystem::path& path, const LogSlice& slice);
+
+// writes a synthetic document of 'operations' drag edits to 'path', then times opening it and seeking to random positions;
+// the first seeks are also checked against 'Replay'
+bool MeasureHistory(const std::filesystem::path& path, size_t operations, HistoryTimings& timings);
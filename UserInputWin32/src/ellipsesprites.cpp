@@ -0,0 +1,115 @@
+#include <windows.h>
+#include <d2d1_3.h>
+
+#include <cmath>
+#include <vector>
+
+#include "ellipsesprites.h"
+
+namespace
+{
+    template <class T> void Release(T** ppT)
+    {
+        if (*ppT)
+        {
+            (*ppT)->Release();
+            *ppT = NULL;
+        }
+    }
+}
+
+
+HRESULT EllipseSprites::Create(ID2D1RenderTarget* pRenderTarget)
+{
+    if (pSprites != NULL)
+    {
+        return S_OK;
+    }
+
+    HRESULT hr = pRenderTarget->QueryInterface(&pContext);
+    if (SUCCEEDED(hr))
+    {
+        // white circle filling the bitmap; coverage falls off over one pixel at the edge
+        const UINT32 size = CircleSize;
+        const float radius = size / 2.0f;
+        std::vector<UINT32> pixels(static_cast<size_t>(size) * size);
+        for (UINT32 y = 0; y < size; y++)
+        {
+            for (UINT32 x = 0; x < size; x++)
+            {
+                const float d = std::hypot(x + 0.5f - radius, y + 0.5f - radius);
+                const float coverage = radius - d < 0 ? 0 : (radius - d > 1 ? 1 : radius - d);
+                const UINT32 v = static_cast<UINT32>(coverage * 255 + 0.5f);
+                pixels[static_cast<size_t>(y) * size + x] = (v << 24) | (v << 16) | (v << 8) | v;
+            }
+        }
+
+        const D2D1_BITMAP_PROPERTIES props = D2D1::BitmapProperties(
+            D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED));
+        hr = pContext->CreateBitmap(D2D1::SizeU(size, size), pixels.data(), size * sizeof(UINT32), props, &pCircle);
+    }
+    if (SUCCEEDED(hr))
+    {
+        hr = pContext->CreateSpriteBatch(&pSprites);
+    }
+    if (FAILED(hr))
+    {
+        Discard();
+    }
+    return hr;
+}
+
+void EllipseSprites::Discard()
+{
+    Release(&pSprites);
+    Release(&pCircle);
+    Release(&pContext);
+}
+
+void EllipseSprites::Draw(const EllipseBatch& batch, float scaleX, float scaleY, bool lod, std::pmr::memory_resource* frame)
+{
+    std::pmr::vector<D2D1_RECT_F> rects(frame);
+    std::pmr::vector<D2D1_COLOR_F> colors(frame);
+    rects.reserve(batch.count);
+    colors.reserve(batch.count);
+
+    // half a pixel, in DIPs
+    const float halfX = 0.5f / scaleX, halfY = 0.5f / scaleY;
+    const float splatX = SplatRadius / scaleX, splatY = SplatRadius / scaleY;
+
+    for (size_t i = 0; i < batch.count; i++)
+    {
+        // also false for removed shapes, whose center is NaN
+        if (!(batch.rx[i] > 0 && batch.ry[i] > 0 && batch.cx[i] == batch.cx[i]))
+        {
+            continue;
+        }
+        if (lod && batch.rx[i] < splatX && batch.ry[i] < splatY)
+        {
+            // a one-pixel rectangle around the center covers exactly one pixel center
+            rects.push_back(D2D1::RectF(batch.cx[i] - halfX, batch.cy[i] - halfY, batch.cx[i] + halfX, batch.cy[i] + halfY));
+        }
+        else
+        {
+            rects.push_back(D2D1::RectF(batch.cx[i] - batch.rx[i], batch.cy[i] - batch.ry[i],
+                                        batch.cx[i] + batch.rx[i], batch.cy[i] + batch.ry[i]));
+        }
+
+        const UINT32 c = batch.colors[i];
+        colors.push_back(D2D1::ColorF(c & 0xFFFFFF, (c >> 24) / 255.0f));
+    }
+    if (rects.empty())
+    {
+        return;
+    }
+
+    pSprites->Clear();
+    pSprites->AddSprites(static_cast<UINT32>(rects.size()), rects.data(), NULL, colors.data(), NULL,
+        sizeof(D2D1_RECT_F), 0, sizeof(D2D1_COLOR_F), 0);
+
+    // sprite batches only draw with aliased primitives; the circle bitmap carries its own anti-aliasing
+    const D2D1_ANTIALIAS_MODE mode = pContext->GetAntialiasMode();
+    pContext->SetAntialiasMode(D2D1_ANTIALIAS_MODE_ALIASED);
+    pContext->DrawSpriteBatch(pSprites, pCircle, D2D1_BITMAP_INTERPOLATION_MODE_LINEAR, D2D1_SPRITE_OPTIONS_NONE);
+    pContext->SetAntialiasMode(mode);
+}
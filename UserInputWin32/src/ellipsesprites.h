@@ -0,0 +1,46 @@
+#pragma once
+
+#include <memory_resource>
+
+#include "batch.h"
+
+struct ID2D1RenderTarget;
+struct ID2D1DeviceContext3;
+struct ID2D1SpriteBatch;
+struct ID2D1Bitmap;
+
+/*
+ - draws a whole 'EllipseBatch' with one Direct2D call: every ellipse is a sprite of the same circle bitmap,
+   stretched to the ellipse's bounding box and tinted with its color
+    - the circle is white with anti-aliased edges and premultiplied alpha, so the tint gives it the shape's color
+    - z-order is the order of the sprites, so colors never need to be grouped or the batch reordered
+ - sprites are drawn aliased, so a splat (see 'SplatRadius') is simply a sprite one pixel wide
+ - sprite batches need 'ID2D1DeviceContext3' (Windows 10); 'Create' fails without it, and the caller falls back to 'FillEllipse'
+ - the bitmap and the sprite batch are device-dependent resources, discarded together with the render target
+*/
+
+class EllipseSprites
+{
+    ID2D1DeviceContext3* pContext;
+    ID2D1SpriteBatch* pSprites;
+    ID2D1Bitmap* pCircle;
+
+public:
+    static const UINT32 CircleSize = 256; // pixels; large enough that scaled-up edges stay smooth
+
+    EllipseSprites() : pContext(NULL), pSprites(NULL), pCircle(NULL) {}
+    ~EllipseSprites() { Discard(); }
+
+    EllipseSprites(const EllipseSprites&) = delete;
+    EllipseSprites& operator=(const EllipseSprites&) = delete;
+
+    HRESULT Create(ID2D1RenderTarget* pRenderTarget);
+    void Discard();
+    bool Ready() const { return pSprites != NULL; }
+
+    /*
+     - the sprite rectangles and colors are built in 'frame', so they go away with the frame
+     - 'scaleX' / 'scaleY' convert DIPs to pixels; with 'lod', sub-pixel shapes become one-pixel sprites
+    */
+    void Draw(const EllipseBatch& batch, float scaleX, float scaleY, bool lod, std::pmr::memory_resource* frame);
+};
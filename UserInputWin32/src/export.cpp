@@ -0,0 +1,91 @@
+#include <windows.h>
+#include <d2d1.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+
+#include "export.h"
+#include "qoi.h"
+#include "scene.h"
+#include "scenefile.h"
+#include "softrender.h"
+#include "threadpool.h"
+
+namespace
+{
+    bool ExportOne(const std::filesystem::path& file, unsigned width, unsigned height)
+    {
+        Scene scene;
+        if (!LoadScene(file, scene))
+        {
+            return false;
+        }
+
+        // bounding box of the drawing in DIPs; shapes drawn after panning left or up have negative coordinates, and
+        // a drag up or to the left leaves negative radii
+        float left = INFINITY, top = INFINITY, right = -INFINITY, bottom = -INFINITY;
+        for (size_t i = 0; i < scene.Count(); i++)
+        {
+            if (!scene.Alive(i))
+            {
+                continue;
+            }
+            const D2D1_ELLIPSE e = scene.Get(i);
+            const float rx = std::fabs(e.radiusX), ry = std::fabs(e.radiusY);
+            if (!std::isfinite(e.point.x + rx) || !std::isfinite(e.point.y + ry))
+            {
+                continue;
+            }
+            left = std::min(left, e.point.x - rx);
+            top = std::min(top, e.point.y - ry);
+            right = std::max(right, e.point.x + rx);
+            bottom = std::max(bottom, e.point.y + ry);
+        }
+        if (left > right)
+        {
+            left = top = 0; // nothing to draw
+            right = bottom = 1;
+        }
+        const float scale = std::min(width / std::max(right - left, 1.0f), height / std::max(bottom - top, 1.0f));
+
+        // no pool: the documents themselves are what runs in parallel
+        SoftwareRenderer renderer;
+        renderer.Resize(width, height);
+        renderer.Render(scene.Batch(), scale, scale, -left * scale, -top * scale, 0xFFFFEBCD);
+
+        std::vector<uint8_t> encoded;
+        EncodeQoi(renderer.Pixels(), renderer.Width(), renderer.Height(), renderer.Stride(), encoded);
+
+        std::filesystem::path out = file;
+        out.replace_extension(".qoi");
+        std::ofstream image(out, std::ios::binary | std::ios::trunc);
+        image.write(reinterpret_cast<const char*>(encoded.data()), encoded.size());
+        return static_cast<bool>(image);
+    }
+}
+
+
+ExportResult ExportDrawings(const std::vector<std::filesystem::path>& files, unsigned width, unsigned height, WorkStealingPool& pool)
+{
+    std::atomic<size_t> written(0), failed(0);
+
+    const auto start = std::chrono::steady_clock::now();
+    pool.ParallelFor(files.size(), [&](size_t i)
+    {
+        if (ExportOne(files[i], width, height))
+        {
+            written++;
+        }
+        else
+        {
+            failed++;
+        }
+    });
+    const auto stop = std::chrono::steady_clock::now();
+
+    ExportResult result = { written.load(), failed.load(), std::chrono::duration<double>(stop - start).count() };
+    return result;
+}
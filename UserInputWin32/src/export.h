@@ -0,0 +1,23 @@
+#pragma once
+
+#include <filesystem>
+#include <vector>
+
+class WorkStealingPool;
+
+/*
+ - headless export: renders saved drawings through the software renderer and writes each one as a .qoi image
+   next to its source file, without creating a window or touching Direct2D
+ - the drawing is scaled and moved so its bounding box (every live shape, wherever the viewport was panned to draw it,
+   negative coordinates included) fits 'width' x 'height' pixels, from the upper left corner
+ - documents are spread over the pool, one document per item; each one is rasterized on the thread that took it
+*/
+
+struct ExportResult
+{
+    size_t written;
+    size_t failed;
+    double seconds;
+};
+
+ExportResult ExportDrawings(const std::vector<std::filesystem::path>& files, unsigned width, unsigned height, WorkStealingPool& pool);
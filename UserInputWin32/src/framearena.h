@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+
+/*
+ - memory for data that only lives while one frame is drawn (visible-shape lists, text to lay out, hit-test metrics, ...)
+ - 'FrameArena' is a 'std::pmr::memory_resource', so frame-scoped containers are the std::pmr ones constructed with it
+ - allocating bumps a pointer through one preallocated block, freeing does nothing, and 'Reset' at the end of the frame
+   makes the whole block available again
+ - when a frame needs more than the block, the extra memory comes from the global heap; 'Reset' then grows the block
+   so the next frame fits, which means a steady-state frame makes no heap allocations at all
+ - every allocation is counted, and so is every trip to the heap, so the paint path can check it stays off the heap
+*/
+
+// forwards to another resource and counts what it hands out
+class CountingResource : public std::pmr::memory_resource
+{
+    std::pmr::memory_resource* upstream;
+    size_t allocations;
+    size_t bytes;
+
+    void* do_allocate(size_t size, size_t alignment) override
+    {
+        allocations++;
+        bytes += size;
+        return upstream->allocate(size, alignment);
+    }
+
+    void do_deallocate(void* p, size_t size, size_t alignment) override
+    {
+        upstream->deallocate(p, size, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+public:
+    explicit CountingResource(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+        : upstream(upstream), allocations(0), bytes(0) {}
+
+    size_t Allocations() const { return allocations; }
+    size_t Bytes() const { return bytes; }
+    void ResetCounts() { allocations = bytes = 0; }
+};
+
+
+struct FrameStats
+{
+    size_t allocations;     // requests served by the arena
+    size_t bytes;
+    size_t heapAllocations; // requests that did not fit in the block and went to the global heap
+};
+
+
+class FrameArena : public std::pmr::memory_resource
+{
+    CountingResource heap;
+    std::unique_ptr<std::byte[]> block;
+    size_t capacity;
+    std::optional<std::pmr::monotonic_buffer_resource> arena;
+    FrameStats current;
+    FrameStats last;
+
+    void* do_allocate(size_t size, size_t alignment) override
+    {
+        current.allocations++;
+        current.bytes += size;
+        return arena->allocate(size, alignment);
+    }
+
+    // memory is only given back by 'Reset'
+    void do_deallocate(void*, size_t, size_t) override {}
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    void Allocate(size_t size)
+    {
+        arena.reset();
+        capacity = size;
+        block = std::make_unique<std::byte[]>(capacity);
+        arena.emplace(block.get(), capacity, &heap);
+    }
+
+public:
+    explicit FrameArena(size_t initialCapacity = 64 * 1024) : capacity(0), current(), last()
+    {
+        Allocate(initialCapacity);
+    }
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    // call once at the end of every frame; nothing allocated from the arena may be used afterwards
+    void Reset()
+    {
+        current.heapAllocations = heap.Allocations();
+        last = current;
+        current = FrameStats();
+
+        if (heap.Allocations() > 0)
+        {
+            // this frame overflowed: make the block big enough to hold everything it allocated
+            const size_t needed = capacity + heap.Bytes();
+            Allocate(needed > capacity * 2 ? needed : capacity * 2);
+        }
+        else
+        {
+            arena->release();
+        }
+        heap.ResetCounts();
+    }
+
+    const FrameStats& LastFrame() const { return last; }
+    size_t Capacity() const { return capacity; }
+};
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <windows.h>
+#include <d2d1.h>
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <new>
+
+/*
+ - a gesture is written as a single coroutine that loops over 'co_await next_pointer_event()'
+   instead of being spread across OnLButtonDown, OnMouseMove and OnLButtonUp with shared member state
+ - the mouse handlers only forward events into the running gesture by calling 'Gesture::Send'
+ - coroutine frames are allocated from a fixed pool, so starting a gesture does not hit the heap
+*/
+
+enum class PointerEventType { Down, Move, Up };
+
+struct PointerEvent
+{
+    PointerEventType type;
+    D2D1_POINT_2F pt; // position in DIPs
+    DWORD flags;      // MK_* flags from wParam
+    DWORD time;       // GetMessageTime, in milliseconds
+
+    // a move can stand for several the system merged into it: their positions, oldest first, without this one;
+    // only valid while the event is being handled
+    const PointerEvent* coalesced = NULL;
+    UINT32 coalescedCount = 0;
+};
+
+
+template <size_t BlockSize, size_t BlockCount>
+class FramePool
+{
+    /*
+     - fixed-size free list of coroutine frames
+     - only used from the UI thread, so it is not synchronized
+     - frames larger than 'BlockSize', or requests made while the pool is exhausted, fall back to the heap; a frame's
+       size is only known to the compiler's coroutine lowering, not to a static_assert, so each fallback is counted
+       instead, for the window to log (see 'MainWindow::OnLButtonDown') and '/gesture' to check
+    */
+
+    struct Block { Block* next; };
+
+    alignas(std::max_align_t) unsigned char storage[BlockSize * BlockCount];
+    Block* freeList;
+    size_t heapFrames;   // allocations that fell back to the heap
+    size_t largestFrame; // bytes, of any frame requested
+
+public:
+    static const size_t BlockBytes = BlockSize;
+
+    static_assert(BlockSize >= sizeof(Block), "block must be able to hold the free-list link");
+    static_assert(BlockSize % alignof(std::max_align_t) == 0, "block size must keep frames aligned");
+
+    FramePool() : freeList(NULL), heapFrames(0), largestFrame(0)
+    {
+        for (size_t i = BlockCount; i-- > 0; )
+        {
+            Block* block = reinterpret_cast<Block*>(storage + i * BlockSize);
+            block->next = freeList;
+            freeList = block;
+        }
+    }
+
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    void* Allocate(size_t size)
+    {
+        largestFrame = size > largestFrame ? size : largestFrame;
+        if (size <= BlockSize && freeList)
+        {
+            Block* block = freeList;
+            freeList = block->next;
+            return block;
+        }
+
+        heapFrames++;
+        return ::operator new(size);
+    }
+
+    void Deallocate(void* p, size_t size)
+    {
+        unsigned char* bytes = static_cast<unsigned char*>(p);
+        if (bytes >= storage && bytes < storage + sizeof(storage))
+        {
+            Block* block = static_cast<Block*>(p);
+            block->next = freeList;
+            freeList = block;
+        }
+        else
+        {
+            ::operator delete(p, size);
+        }
+    }
+
+    size_t HeapFrames() const { return heapFrames; }
+    size_t LargestFrame() const { return largestFrame; }
+};
+
+// one gesture is active at a time, and its frame is destroyed before the next one starts; the spare blocks are headroom
+typedef FramePool<512, 4> GestureFramePool;
+
+inline GestureFramePool& GesturePool()
+{
+    static GestureFramePool pool;
+    return pool;
+}
+
+
+class Gesture
+{
+public:
+    struct promise_type
+    {
+        PointerEvent current;
+
+        Gesture get_return_object() { return Gesture(std::coroutine_handle<promise_type>::from_promise(*this)); }
+
+        // run the gesture body up to its first 'co_await' as soon as it is started
+        std::suspend_never initial_suspend() noexcept { return {}; }
+
+        // keep the frame alive after the body finishes; it is destroyed by the owning 'Gesture'
+        std::suspend_always final_suspend() noexcept { return {}; }
+
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+
+        static void* operator new(size_t size) { return GesturePool().Allocate(size); }
+        static void operator delete(void* p, size_t size) { GesturePool().Deallocate(p, size); }
+    };
+
+    Gesture() {}
+    Gesture(Gesture&& other) noexcept : handle(other.handle) { other.handle = nullptr; }
+    Gesture& operator=(Gesture&& other) noexcept
+    {
+        if (this != &other)
+        {
+            Reset();
+            handle = other.handle;
+            other.handle = nullptr;
+        }
+        return *this;
+    }
+    Gesture(const Gesture&) = delete;
+    Gesture& operator=(const Gesture&) = delete;
+    ~Gesture() { Reset(); }
+
+    bool Active() const { return handle && !handle.done(); }
+
+    // deliver the next event to the gesture and run it until it waits for another one
+    void Send(const PointerEvent& e)
+    {
+        if (Active())
+        {
+            handle.promise().current = e;
+            handle.resume();
+        }
+    }
+
+    void Reset()
+    {
+        if (handle)
+        {
+            handle.destroy();
+            handle = nullptr;
+        }
+    }
+
+private:
+    explicit Gesture(std::coroutine_handle<promise_type> h) : handle(h) {}
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+
+struct NextPointerEvent
+{
+    Gesture::promise_type* promise = NULL;
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<Gesture::promise_type> h) noexcept { promise = &h.promise(); }
+    PointerEvent await_resume() const noexcept { return promise->current; }
+};
+
+// suspends the gesture until the window forwards the next pointer event
+inline NextPointerEvent next_pointer_event() { return NextPointerEvent(); }
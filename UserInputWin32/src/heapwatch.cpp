@@ -0,0 +1,145 @@
+#include "heapwatch.h"
+
+#ifdef HEAPWATCH
+
+#include <malloc.h>
+#include <stdlib.h>
+
+#include <new>
+
+namespace
+{
+    // plain data, so the thread-local storage needs no constructor and is usable from the first allocation on
+    thread_local unsigned watching = 0; // open watches on this thread
+    thread_local size_t allocations = 0; // counted while 'watching'
+
+    // what the default 'operator new' does: retry through the new-handler, throw when there is none
+    void* Allocate(size_t size)
+    {
+        if (watching)
+        {
+            allocations++;
+        }
+        for (;;)
+        {
+            if (void* p = malloc(size ? size : 1))
+            {
+                return p;
+            }
+            std::new_handler handler = std::get_new_handler();
+            if (handler == nullptr)
+            {
+                throw std::bad_alloc();
+            }
+            handler();
+        }
+    }
+
+    // the aligned forms must be freed with '_aligned_free', so they get their own allocator and 'operator delete'
+    void* AllocateAligned(size_t size, std::align_val_t alignment)
+    {
+        if (watching)
+        {
+            allocations++;
+        }
+        for (;;)
+        {
+            if (void* p = _aligned_malloc(size ? size : 1, static_cast<size_t>(alignment)))
+            {
+                return p;
+            }
+            std::new_handler handler = std::get_new_handler();
+            if (handler == nullptr)
+            {
+                throw std::bad_alloc();
+            }
+            handler();
+        }
+    }
+}
+
+
+HeapWatch::HeapWatch() : start(allocations)
+{
+    watching++;
+}
+
+HeapWatch::~HeapWatch()
+{
+    watching--;
+}
+
+size_t HeapWatch::Allocations() const
+{
+    return allocations - start;
+}
+
+
+void* operator new(size_t size) { return Allocate(size); }
+void* operator new[](size_t size) { return Allocate(size); }
+void* operator new(size_t size, std::align_val_t alignment) { return AllocateAligned(size, alignment); }
+void* operator new[](size_t size, std::align_val_t alignment) { return AllocateAligned(size, alignment); }
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return Allocate(size);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return nullptr;
+    }
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return Allocate(size);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return nullptr;
+    }
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return AllocateAligned(size, alignment);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return nullptr;
+    }
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return AllocateAligned(size, alignment);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return nullptr;
+    }
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { free(p); }
+
+void operator delete(void* p, std::align_val_t) noexcept { _aligned_free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { _aligned_free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { _aligned_free(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { _aligned_free(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { _aligned_free(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { _aligned_free(p); }
+
+#endif
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+
+/*
+ - 'FrameArena' keeps the temporaries of a frame off the heap, but it only sees what goes through its 'std::pmr'
+   resource: a 'std::vector', a 'std::wstring' or a library call in 'OnPaint' still reaches the global 'operator new'
+ - heapwatch.cpp replaces the global 'operator new' and 'operator delete' (every form: arrays, nothrow, aligned, sized)
+   for the whole program; they call malloc / free as the default ones do, and count a call only while the calling
+   thread is being watched, which costs a thread-local test everywhere else
+ - compiled in only when HEAPWATCH is defined (the Debug configurations define it); otherwise the program keeps the
+   CRT's allocator, a 'HeapWatch' counts nothing, and '/paintheap' does not exist
+ - a 'HeapWatch' watches its thread from construction to destruction; 'OnPaint' is watched, so a steady-state frame
+   that allocates is logged, and '/paintheap' fails on one
+ - only calls from this module are counted; a DLL's allocations ('Direct2D', the driver) go to its own heap
+*/
+
+#ifdef HEAPWATCH
+
+class HeapWatch
+{
+    size_t start;
+
+public:
+    static const bool Counting = true;
+
+    HeapWatch();  // watches may nest; each counts from its own start
+    ~HeapWatch();
+
+    HeapWatch(const HeapWatch&) = delete;
+    HeapWatch& operator=(const HeapWatch&) = delete;
+
+    // global 'operator new' calls on this thread since the watch started
+    size_t Allocations() const;
+};
+
+#else
+
+class HeapWatch
+{
+public:
+    static const bool Counting = false;
+
+    size_t Allocations() const { return 0; }
+};
+
+#endif
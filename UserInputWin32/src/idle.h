@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ - checks that the window does nothing while the user does nothing: no frames, no timers, no polling
+ - every message the loop wakes up for is counted, and so is every frame, against the time of the last input
+ - right after an input the window still has work to finish (the repaint, the autosave a few seconds later), so
+   wakeups within 'settle' ms of the input are counted apart; after that an idle window should count none at all
+ - nothing runs while idle to report the counts: the report is made by the input that ends the idle period,
+   or by the '/idle' check when its time is up
+ - times are 'GetTickCount' / message times, in ms; they wrap after 49.7 days, so only differences are used,
+   and a message stamped before the last input (queued before it, or the tick read after it) counts as right after it
+ - plain 32-bit integers rather than 'DWORD', so tests/idle_test.cpp builds without windows.h
+*/
+
+struct IdleReport
+{
+    uint32_t idleMs;      // since the last input
+    uint32_t settleMs;
+    size_t settleWakeups; // within the settle time
+    size_t wakeups;       // after it
+    size_t frames;        // after it
+
+    // a count as a rate over the idle time after settling
+    double PerMinute(size_t n) const
+    {
+        return idleMs > settleMs ? n * 60000.0 / (idleMs - settleMs) : 0.0;
+    }
+};
+
+
+class IdleMonitor
+{
+    uint32_t settle;
+    uint32_t lastInput;
+    size_t settleWakeups;
+    size_t wakeups;
+    size_t frames;
+
+    // ms from the last input to 'now'; 0 for a time before it, which the unsigned difference would make about 49 days
+    uint32_t Since(uint32_t now) const
+    {
+        return static_cast<int32_t>(now - lastInput) < 0 ? 0 : now - lastInput;
+    }
+
+public:
+    static const uint32_t ReportedIdle = 60000; // idle periods shorter than this end without a report
+
+    explicit IdleMonitor(uint32_t settleMs) : settle(settleMs), lastInput(0), settleWakeups(0), wakeups(0), frames(0) {}
+
+    void OnWakeup(uint32_t now)
+    {
+        if (Since(now) < settle)
+        {
+            settleWakeups++;
+        }
+        else
+        {
+            wakeups++;
+        }
+    }
+
+    void OnFrame(uint32_t now)
+    {
+        if (Since(now) >= settle)
+        {
+            frames++;
+        }
+    }
+
+    // starts counting from 'now', as if an input had just arrived
+    void Reset(uint32_t now)
+    {
+        lastInput = now;
+        settleWakeups = wakeups = frames = 0;
+    }
+
+    IdleReport Report(uint32_t now) const
+    {
+        IdleReport r = { Since(now), settle, settleWakeups, wakeups, frames };
+        return r;
+    }
+
+    // starts a new idle period; returns true with the report of the one that ended, if it was long enough to report
+    bool OnInput(uint32_t now, IdleReport& ended)
+    {
+        ended = Report(now);
+        Reset(now);
+        return ended.idleMs >= ReportedIdle;
+    }
+};
@@ -0,0 +1,111 @@
+#include <windows.h>
+
+#include "inputexport.h"
+
+const wchar_t* const InputRingName = L"Local\\UserInputWin32.InputEvents";
+
+// held by the window that writes the ring; Windows releases it (as abandoned) when that process dies
+const wchar_t* const InputWriterName = L"Local\\UserInputWin32.InputEvents.Writer";
+
+namespace
+{
+    const size_t RingBytes = InputRingBytes(InputExport::Capacity);
+}
+
+
+InputExport::InputExport() : writer(NULL), mapping(NULL), view(NULL)
+{
+    // one writer at a time, or the sequence numbers break; readers never take the mutex
+    writer = CreateMutexW(NULL, FALSE, InputWriterName);
+    if (writer == NULL)
+    {
+        return;
+    }
+    const DWORD wait = WaitForSingleObject(writer, 0);
+    if (wait != WAIT_OBJECT_0 && wait != WAIT_ABANDONED)
+    {
+        OutputDebugString(L"input export: the ring is already published by another window\n");
+        CloseHandle(writer);
+        writer = NULL;
+        return;
+    }
+
+    // pagefile-backed, so the ring is just memory that other processes can map; if it already exists, taps kept it
+    // open after the last writer went away, and 'Attach' carries on where that writer stopped
+    mapping = CreateFileMappingW(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, static_cast<DWORD>(RingBytes), InputRingName);
+    if (mapping != NULL)
+    {
+        view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, RingBytes);
+    }
+    if (view == NULL)
+    {
+        // an existing mapping smaller than this build's ring cannot be mapped at all
+        OutputDebugString(L"input export: the ring could not be mapped\n");
+        if (mapping != NULL)
+        {
+            CloseHandle(mapping);
+            mapping = NULL;
+        }
+        ReleaseMutex(writer);
+        CloseHandle(writer);
+        writer = NULL;
+        return;
+    }
+    ring.Attach(view, Capacity);
+}
+
+InputExport::~InputExport()
+{
+    if (view != NULL)
+    {
+        UnmapViewOfFile(view);
+    }
+    if (mapping != NULL)
+    {
+        CloseHandle(mapping);
+    }
+    if (writer != NULL)
+    {
+        ReleaseMutex(writer);
+        CloseHandle(writer);
+    }
+}
+
+
+InputTap::InputTap() : mapping(NULL), view(NULL) {}
+
+InputTap::~InputTap()
+{
+    if (view != NULL)
+    {
+        UnmapViewOfFile(view);
+    }
+    if (mapping != NULL)
+    {
+        CloseHandle(mapping);
+    }
+}
+
+bool InputTap::Open()
+{
+    mapping = OpenFileMappingW(FILE_MAP_READ, FALSE, InputRingName);
+    if (mapping == NULL)
+    {
+        return false;
+    }
+
+    view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, RingBytes);
+    if (view == NULL)
+    {
+        return false;
+    }
+
+    // a ring written by a different build of the window is not read at all
+    if (!ring.Attach(view, InputExport::Capacity))
+    {
+        UnmapViewOfFile(view);
+        view = NULL;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+
+#include "inputring.h"
+
+/*
+ - publishes the input messages the window receives to other processes (analytics, test harnesses) through shared memory
+ - the ring itself is 'InputRingWriter' / 'InputRingReader' (inputring.h); here it lives in a named, pagefile-backed
+   file mapping in the session namespace
+ - readers map the ring read-only and read the events in place, no pipe or socket in between
+*/
+
+// the name of the mapping, in the session namespace
+extern const wchar_t* const InputRingName;
+
+
+// the writing side, owned by the window; create and destroy it on one thread, as that thread owns the writer mutex
+class InputExport
+{
+    HANDLE writer; // a named mutex, held while this window writes the ring
+    HANDLE mapping;
+    void* view;
+    InputRingWriter ring;
+
+public:
+    static const uint32_t Capacity = 16384;
+
+    InputExport();
+    ~InputExport();
+
+    InputExport(const InputExport&) = delete;
+    InputExport& operator=(const InputExport&) = delete;
+
+    // false when the mapping could not be created, or another window already publishes to it
+    bool IsOpen() const { return ring.IsAttached(); }
+
+    // wait-free: a few stores, whatever the readers are doing
+    void Publish(UINT message, WPARAM wParam, LPARAM lParam, DWORD time)
+    {
+        if (ring.IsAttached())
+        {
+            ring.Publish(InputEvent{ message, static_cast<uint32_t>(time), static_cast<uint64_t>(wParam), static_cast<int64_t>(lParam) });
+        }
+    }
+};
+
+
+// the reading side, for another process following the window's input
+class InputTap
+{
+    HANDLE mapping;
+    const void* view;
+    InputRingReader ring;
+
+public:
+    InputTap();
+    ~InputTap();
+
+    InputTap(const InputTap&) = delete;
+    InputTap& operator=(const InputTap&) = delete;
+
+    // opens the ring of a running window and starts at its next event; false if there is none
+    bool Open();
+
+    uint64_t Dropped() const { return ring.Dropped(); }
+
+    // the next event, or false when the reader has caught up with the writer; events overwritten before they were
+    // read are skipped and counted in 'Dropped'
+    bool Next(InputEvent& e) { return ring.Next(e); }
+};
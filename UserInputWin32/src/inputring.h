@@ -0,0 +1,198 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+/*
+ - the shared-memory ring behind 'InputExport' / 'InputTap', apart from how the memory is mapped (a named file mapping
+   on Windows, 'shm_open' + 'mmap' for the POSIX test), so the same code is what runs and what is tested
+ - the memory holds a header and a ring of fixed-size slots; one writer, any number of readers
+ - every event gets a sequence number; event 's' goes to slot 's % capacity', overwriting event 's - capacity'
+ - the writer never waits for anyone: a reader that falls more than 'capacity' events behind loses the oldest ones,
+   notices from the sequence numbers, and counts them as dropped
+ - each slot is a seqlock: its stamp is odd while the writer is filling it and '2 * s + 2' once event 's' is complete;
+   a reader copies the slot between two reads of the stamp and keeps the copy only if the stamp did not change
+ - a writer taking over memory an earlier writer left behind (readers kept it mapped, or the writer died) carries on
+   with that writer's sequence numbers, so readers still following the ring see no jump back; memory holding anything
+   else is reset
+*/
+
+// one window message, in a layout that is the same for 32- and 64-bit processes
+struct InputEvent
+{
+    uint32_t message;
+    uint32_t time; // 'GetMessageTime', ms
+    uint64_t wParam;
+    int64_t lParam;
+};
+
+struct InputRingHeader
+{
+    static const uint32_t Magic = 0x49505452;
+    static const uint32_t Version = 1;
+
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity; // slots, a power of two
+    uint32_t slotSize;
+    std::atomic<uint64_t> published; // events written so far, the sequence number of the next one
+};
+
+struct InputSlot
+{
+    std::atomic<uint64_t> stamp;
+    std::atomic<uint64_t> words[3]; // the 'InputEvent', as atomics so a torn read is well defined, just discarded
+};
+
+static_assert(sizeof(InputEvent) == sizeof(uint64_t) * 3, "an InputEvent fills the words of a slot");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "the ring is shared between processes");
+
+// bytes of memory a ring of 'capacity' slots needs
+constexpr size_t InputRingBytes(uint32_t capacity)
+{
+    return sizeof(InputRingHeader) + sizeof(InputSlot) * capacity;
+}
+
+
+// the writing side; only one may be attached to a ring at a time
+class InputRingWriter
+{
+    InputRingHeader* header;
+    InputSlot* slots;
+    uint64_t mask;
+    uint64_t next; // only the writer stores 'published', so it keeps its own copy
+
+public:
+    InputRingWriter() : header(nullptr), slots(nullptr), mask(0), next(0) {}
+
+    // takes over 'InputRingBytes(capacity)' bytes at 'memory', which must not be written by anyone else
+    void Attach(void* memory, uint32_t capacity)
+    {
+        InputRingHeader* h = static_cast<InputRingHeader*>(memory);
+        InputSlot* s = reinterpret_cast<InputSlot*>(h + 1);
+        const bool resume = h->magic == InputRingHeader::Magic && h->version == InputRingHeader::Version &&
+            h->capacity == capacity && h->slotSize == sizeof(InputSlot);
+        if (!resume)
+        {
+            // every stamp 0 matches no event; the header is written last, as readers check it on open
+            h->magic = 0;
+            for (uint32_t i = 0; i < capacity; i++)
+            {
+                new (&s[i]) InputSlot;
+                s[i].stamp.store(0, std::memory_order_relaxed);
+            }
+            new (h) InputRingHeader;
+            h->published.store(0, std::memory_order_relaxed);
+            h->version = InputRingHeader::Version;
+            h->capacity = capacity;
+            h->slotSize = sizeof(InputSlot);
+            std::atomic_thread_fence(std::memory_order_release);
+            h->magic = InputRingHeader::Magic;
+        }
+
+        // an event the last writer had not finished (its stamp is still odd) was never published, and is written over
+        header = h;
+        slots = s;
+        mask = capacity - 1;
+        next = h->published.load(std::memory_order_acquire);
+    }
+
+    bool IsAttached() const { return header != nullptr; }
+
+    // wait-free: a few stores, whatever the readers are doing
+    void Publish(const InputEvent& e)
+    {
+        uint64_t words[3];
+        memcpy(words, &e, sizeof(e));
+
+        InputSlot& slot = slots[next & mask];
+        slot.stamp.store(2 * next + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release); // the odd stamp is visible before any of the new words
+        for (int i = 0; i < 3; i++)
+        {
+            slot.words[i].store(words[i], std::memory_order_relaxed);
+        }
+        slot.stamp.store(2 * next + 2, std::memory_order_release);
+
+        next++;
+        header->published.store(next, std::memory_order_release);
+    }
+};
+
+
+// the reading side, for another process following the ring
+class InputRingReader
+{
+    const InputRingHeader* header;
+    const InputSlot* slots;
+    uint64_t capacity;
+    uint64_t cursor;  // sequence number of the next event to read
+    uint64_t dropped; // events overwritten before this reader got to them
+
+public:
+    InputRingReader() : header(nullptr), slots(nullptr), capacity(0), cursor(0), dropped(0) {}
+
+    // reads the ring at 'memory' from its next event on; false (and not attached) if it is not a ring of 'capacity' slots
+    bool Attach(const void* memory, uint32_t capacity)
+    {
+        const InputRingHeader* h = static_cast<const InputRingHeader*>(memory);
+        if (h->magic != InputRingHeader::Magic || h->version != InputRingHeader::Version ||
+            h->capacity != capacity || h->slotSize != sizeof(InputSlot))
+        {
+            return false;
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        header = h;
+        slots = reinterpret_cast<const InputSlot*>(h + 1);
+        this->capacity = capacity;
+        cursor = h->published.load(std::memory_order_acquire);
+        return true;
+    }
+
+    bool IsAttached() const { return header != nullptr; }
+    uint64_t Dropped() const { return dropped; }
+
+    // the next event, or false when the reader has caught up with the writer
+    bool Next(InputEvent& e)
+    {
+        for (;;)
+        {
+            const uint64_t published = header->published.load(std::memory_order_acquire);
+            if (cursor == published)
+            {
+                return false;
+            }
+            if (published - cursor > capacity)
+            {
+                // lapped: the events up to 'published - capacity' are gone
+                dropped += published - capacity - cursor;
+                cursor = published - capacity;
+            }
+
+            const InputSlot& slot = slots[cursor & (capacity - 1)];
+            const uint64_t before = slot.stamp.load(std::memory_order_acquire);
+            uint64_t words[3];
+            for (int i = 0; i < 3; i++)
+            {
+                words[i] = slot.words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire); // the words are read before the stamp is checked again
+            const uint64_t after = slot.stamp.load(std::memory_order_relaxed);
+
+            if (before == 2 * cursor + 2 && after == before)
+            {
+                memcpy(&e, words, sizeof(e));
+                cursor++;
+                return true;
+            }
+            // event 'cursor' was published, and its stamp was stored before 'published' was, so any other stamp means
+            // the writer is filling, or has filled, the slot with a later event: this one is lost, but the events after
+            // it are still there, so count it and go on rather than report that there is nothing to read
+            dropped++;
+            cursor++;
+        }
+    }
+};
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+
+/*
+ - the state of every virtual key, kept as a 256-bit table (four 64-bit words) updated from the key messages,
+   so handlers can ask which keys are held without calling 'GetKeyState'
+ - a chord is a 'KeyMask' with one bit per key; "is the chord held" is (state & mask) == mask on each word,
+   which costs the same no matter how many keys the chord has
+ - the generic modifier codes (VK_SHIFT, VK_CONTROL, VK_MENU) are tracked together with their left/right variants
+*/
+
+// fields packed into the lParam of WM_KEYDOWN / WM_KEYUP / WM_SYSKEYDOWN / WM_SYSKEYUP
+struct KeyMessage
+{
+    WORD repeatCount;  // bits 0-15: auto-repeat count for this message
+    BYTE scanCode;     // bits 16-23
+    bool extended;     // bit 24: right-hand ALT/CTRL, arrow keys on the extended block, ...
+    bool altDown;      // bit 29: context code, ALT held while the key was pressed
+    bool wasDown;      // bit 30: previous key state, set for auto-repeat
+    bool released;     // bit 31: transition state, set for key-up messages
+};
+
+inline KeyMessage DecodeKeyMessage(LPARAM lParam)
+{
+    const UINT32 bits = static_cast<UINT32>(lParam);
+    KeyMessage m;
+    m.repeatCount = static_cast<WORD>(bits & 0xFFFF);
+    m.scanCode = static_cast<BYTE>((bits >> 16) & 0xFF);
+    m.extended = (bits & (1u << 24)) != 0;
+    m.altDown = (bits & (1u << 29)) != 0;
+    m.wasDown = (bits & (1u << 30)) != 0;
+    m.released = (bits & (1u << 31)) != 0;
+    return m;
+}
+
+
+class KeyMask
+{
+    uint64_t words[4];
+
+    friend class KeyboardState;
+
+public:
+    constexpr KeyMask() : words{ 0, 0, 0, 0 } {}
+
+    constexpr KeyMask(std::initializer_list<BYTE> keys) : words{ 0, 0, 0, 0 }
+    {
+        for (BYTE vk : keys)
+        {
+            words[vk >> 6] |= uint64_t(1) << (vk & 63);
+        }
+    }
+};
+
+
+class KeyboardState
+{
+    uint64_t down[4];
+
+    void Set(BYTE vk, bool isDown)
+    {
+        const uint64_t bit = uint64_t(1) << (vk & 63);
+        down[vk >> 6] = isDown ? (down[vk >> 6] | bit) : (down[vk >> 6] & ~bit);
+    }
+
+    // the left/right variant of a generic modifier, from the scan code or the extended bit
+    static BYTE Sided(BYTE vk, const KeyMessage& m)
+    {
+        switch (vk)
+        {
+        case VK_SHIFT:   return m.scanCode == 0x36 ? VK_RSHIFT : VK_LSHIFT;
+        case VK_CONTROL: return m.extended ? VK_RCONTROL : VK_LCONTROL;
+        case VK_MENU:    return m.extended ? VK_RMENU : VK_LMENU;
+        default:         return 0;
+        }
+    }
+
+public:
+    KeyboardState() : down{ 0, 0, 0, 0 } {}
+
+    // call for every WM_KEYDOWN, WM_KEYUP, WM_SYSKEYDOWN and WM_SYSKEYUP; returns the decoded lParam
+    KeyMessage OnKeyMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
+    {
+        const KeyMessage m = DecodeKeyMessage(lParam);
+        const bool isDown = (uMsg == WM_KEYDOWN || uMsg == WM_SYSKEYDOWN);
+        const BYTE vk = static_cast<BYTE>(wParam);
+
+        Set(vk, isDown);
+
+        const BYTE sided = Sided(vk, m);
+        if (sided)
+        {
+            Set(sided, isDown);
+
+            // the generic code stays down while either side is still held; left variants are even, right ones odd
+            const BYTE left = static_cast<BYTE>(sided & ~1);
+            Set(vk, IsDown(left) || IsDown(static_cast<BYTE>(left + 1)));
+        }
+        return m;
+    }
+
+    // keys released while the window did not have focus never send WM_KEYUP, so forget everything on WM_KILLFOCUS
+    void Clear() { down[0] = down[1] = down[2] = down[3] = 0; }
+
+    bool IsDown(BYTE vk) const { return (down[vk >> 6] >> (vk & 63)) & 1; }
+
+    // every key of the chord is held (other keys may be held too)
+    bool IsChordHeld(const KeyMask& chord) const
+    {
+        return ((down[0] & chord.words[0]) == chord.words[0]) & ((down[1] & chord.words[1]) == chord.words[1]) &
+               ((down[2] & chord.words[2]) == chord.words[2]) & ((down[3] & chord.words[3]) == chord.words[3]);
+    }
+
+    // at least one key of the mask is held
+    bool IsAnyHeld(const KeyMask& keys) const
+    {
+        return ((down[0] & keys.words[0]) | (down[1] & keys.words[1]) | (down[2] & keys.words[2]) | (down[3] & keys.words[3])) != 0;
+    }
+};
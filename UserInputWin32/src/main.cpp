@@ -1,10 +1,45 @@
 #include <windows.h>
 #include <windowsX.h>
 #include <d2d1.h>
+#include <dwrite.h>
+#include <shellapi.h>
 #include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <random>
 #pragma comment(lib, "d2d1")
+#pragma comment(lib, "dwrite")
+#pragma comment(lib, "shell32")
 
 #include "basewin.h"
+#include "gesture.h"
+#include "recognizer.h"
+#include "predictor.h"
+#include "pointerhistory.h"
+#include "pointers.h"
+#include "scene.h"
+#include "selftest.h"
+#include "softrender.h"
+#include "scenefile.h"
+#include "textbuffer.h"
+#include "keystate.h"
+#include "document.h"
+#include "framearena.h"
+#include "heapwatch.h"
+#include "ellipsesprites.h"
+#include "displaylist.h"
+#include "displayoptimizer.h"
+#include "viewport.h"
+#include "autosave.h"
+#include "inputexport.h"
+#include "capture.h"
+#include "idle.h"
+#include "startup.h"
+#include "warmup.h"
+#include "profiler.h"
 
 /*
  - Direct2D is an immediate-mode API
@@ -68,40 +103,210 @@ public:
     {
         return D2D1::Point2F(static_cast<float>(x) / scaleX, static_cast<float>(y) / scaleY);
     }
+
+    static float ScaleX() { return scaleX; }
+    static float ScaleY() { return scaleY; }
 };
 
 float DPIScale::scaleX = 1.0f;
 float DPIScale::scaleY = 1.0f;
 
 
+// Ctrl+S, Ctrl+O
+const KeyMask SaveChord = { VK_CONTROL, 'S' };
+const KeyMask OpenChord = { VK_CONTROL, 'O' };
+
+#ifdef PROFILE_ZONES
+// Ctrl+P writes the profiling zones recorded since the last Ctrl+P to profile.json
+const KeyMask ProfileChord = { VK_CONTROL, 'P' };
+#endif
+
+
+// timer that lets the recognizer report a long-press while the pointer is held still
+const UINT_PTR IDT_LONGPRESS = 1;
+
+// one-shot timer that hands the unsaved part of the document to the autosave thread; armed by a change, so an idle
+// window has no timer running
+const UINT_PTR IDT_AUTOSAVE = 2;
+const UINT AutosaveInterval = 5000; // ms
+
+// '/idle <seconds>': ends the idle check
+const UINT_PTR IDT_IDLECHECK = 3;
+
+// '/paintheap <frames>': frames painted before counting starts, while the arena, the lists and the device settle
+const size_t PaintCheckWarmupFrames = 30;
+
+
+// the messages 'InputExport' publishes: mouse, pointer and keyboard input
+bool IsInputMessage(UINT uMsg)
+{
+    switch (uMsg)
+    {
+    case WM_LBUTTONDOWN:
+    case WM_LBUTTONUP:
+    case WM_LBUTTONDBLCLK:
+    case WM_MBUTTONDOWN:
+    case WM_MBUTTONUP:
+    case WM_RBUTTONDOWN:
+    case WM_RBUTTONUP:
+    case WM_MOUSEMOVE:
+    case WM_MOUSEWHEEL:
+    case WM_POINTERDOWN:
+    case WM_POINTERUPDATE:
+    case WM_POINTERUP:
+    case WM_POINTERCAPTURECHANGED:
+    case WM_KEYDOWN:
+    case WM_KEYUP:
+    case WM_SYSKEYDOWN:
+    case WM_SYSKEYUP:
+    case WM_CHAR:
+    case WM_SYSCHAR:
+        return true;
+    default:
+        return false;
+    }
+}
+
+
+// what a left-button drag does: F1 draws new ellipses, F2 selects and moves existing ones
+enum class Tool { Draw, Select };
+
+
 class MainWindow : public BaseWindow<MainWindow>
 {
     // 'pFactory' is a factory object to create other objects; render targets and device-independent resources, such as stroke styles and geometries
     ID2D1Factory* pFactory;
 
+    // DirectWrite factory and the text format of the editor; device-independent, so they live as long as the window
+    IDWriteFactory* pWriteFactory;
+    IDWriteTextFormat* pTextFormat;
+
+    // the three objects above are created on this thread while the window is being created (see 'GraphicsWarmup')
+    GraphicsWarmup warmup;
+    bool warmupStarted;
+    bool firstFrameShown; // the startup timeline is logged at the first frame
+
     // Device - dependent resources, such as brushesand bitmaps, are created by the render target object
     ID2D1HwndRenderTarget* pRenderTarget; // render target pointer
     ID2D1SolidColorBrush* pBrush; // brush pointer
-    D2D1_ELLIPSE ellipse;
-    D2D1_POINT_2F ptMouse; // stores the mouse-down position while the user is dragging the mouse
+    ID2D1SolidColorBrush* pOutlineBrush; // outlines the shape under the mouse, also draws the text and the caret
+    ID2D1SolidColorBrush* pSelectionBrush; // background of selected text
+    EllipseSprites sprites; // draws the whole scene in one call where sprite batches are available
+    bool batchDrawing; // F7 switches between the sprite batch and one 'FillEllipse' per shape
+    SceneDisplayList sceneList; // the visible shapes as drawing commands, replayed while neither the scene nor the view changes; Shift+F7 switches its optimizer
+    DisplayListOptimizer listOptimizer; // optimizes the kept 'sceneList' off the UI thread
+    bool levelOfDetail; // F8: sub-pixel shapes are drawn as one-pixel splats
+    double frameMs; // paint time accumulated over 'frames' frames, logged every 60 frames
+    int frames;
+    Scene scene; // every ellipse drawn so far, in z-order, in world coordinates
+    Viewport viewport; // the part of the drawing in view: the middle button pans, the wheel zooms
+    bool panning;
+    D2D1_POINT_2F panFrom; // screen DIPs of the last middle-button move
+    size_t visibleShapes; // shapes submitted by the last frame
+    Document document; // the operation log that 'scene' is the result of; every change goes through it
+    Autosaver autosaver; // journals the document on a worker thread; recovered at startup
+    InputExport inputExport; // every input message, published to other processes through shared memory
+    bool autosaveArmed; // IDT_AUTOSAVE is running
+    IdleMonitor idle; // wakeups and frames since the last input; an idle window should have neither
+    DWORD idleCheckMs; // '/idle': how long to run without input before checking the counts, or 0
+    bool idleCheckFailed;
+    size_t paintCheckFrames; // '/paintheap': frames to count global heap allocations in after the warm-up, or 0
+    size_t paintCheckPainted; // frames painted so far, warm-up included
+    size_t paintCheckAllocations; // global 'operator new' calls in the counted frames
+    size_t paintCheckDirty; // counted frames that made any
+    std::filesystem::path firstFrameResult; // '/firstframe': where the time to first frame goes before closing, or empty
+    ptrdiff_t hovered; // index of the shape under the mouse, or -1
+    ptrdiff_t selected; // index of the shape picked with the select tool, or -1
+    Tool tool;
+
+    // CPU rasterizer, used instead of 'FillEllipse' when F3 switches to it
+    WorkStealingPool pool;
+    SoftwareRenderer softRenderer;
+    bool softwareRendering;
+    ID2D1Bitmap* pSoftwareBitmap; // receives the CPU-rendered frame; device-dependent like the brushes
+    std::unique_ptr<FrameRecorder> recorder; // F11 records the software-rendered frames to session.capture
+
+    FrameArena frameArena; // temporaries of the frame being drawn; reset at the end of 'OnPaint'
+
+    TextBuffer text; // typed text, edited through WM_CHAR and the caret keys
+    KeyboardState keys; // which virtual keys are held, tracked from the key messages
+
+    Gesture gesture; // the drag currently in progress, resumed by the mouse handlers
+    GestureRecognizer recognizer; // click, double-click, drag, flick and long-press detection
+    PointerPredictor predictor; // extrapolates the drag to the time the frame is presented
+    std::unique_ptr<PointerHistory> pointerHistory; // the moves coalesced away between two WM_MOUSEMOVEs of a drag
+    std::vector<HistorySample> historySamples; // the last batch, reused
+    std::vector<PointerEvent> coalescedEvents; // ... as the events attached to the move
+    bool predictDrag; // toggled with F9
+    DWORD frameInterval; // ms between two presented frames
+    PointerContacts contacts; // pen and touch contacts currently down, each drawing its own ellipse
 
 
     void CalculateLayout();
     HRESULT CreateGraphicsResources();
     void DiscardGraphicsResources();
     void OnPaint();
+    void DrawSoftware(const EllipseBatch& batch, UINT32 background);
+    void DrawTextBuffer();
+    void OnChar(wchar_t c);
+    bool OnEditKey(WPARAM key);
+    void CopySelection();
+    void Paste();
     void Resize();
     void OnLButtonDown(int pixelX, int pixelY, DWORD flags);
-    void OnLButtonUp();
+    void OnLButtonUp(int pixelX, int pixelY, DWORD flags);
     void OnMouseMove(int pixelX, int pixelY, DWORD flags);
+    void OnMouseWheel(int pixelX, int pixelY, short delta);
+    Gesture DragEllipse(PointerEvent down);
+    Gesture MoveShape(PointerEvent down, size_t shape);
+    void RecognizeGestures(const PointerEvent& e);
+    void OnGestureRecognized(const RecognizedGesture& g);
+    void OnTimer(UINT_PTR id);
+    void CheckPaint(size_t allocations);
+    void Autosave();
+    void LogIdle(const wchar_t* when, const IdleReport& r);
+    bool OnPointer(UINT uMsg, WPARAM wParam, LPARAM lParam);
+    void Recolor();
+    void SeekHistory(ptrdiff_t step);
+    void OpenDocument();
+    void CancelGesture();
+    void OnSceneReplaced();
+    void AddStressShapes(size_t count, float minRadius, float maxRadius, float spread);
 
 public:
 
-    MainWindow() : pFactory(NULL), pRenderTarget(NULL), pBrush(NULL), 
-        ellipse(D2D1::Ellipse(D2D1::Point2F(), 0, 0)), ptMouse(D2D1::Point2F()) {}
+    MainWindow() : pFactory(NULL), pWriteFactory(NULL), pTextFormat(NULL), warmupStarted(false), firstFrameShown(false), pRenderTarget(NULL), pBrush(NULL),
+        pOutlineBrush(NULL), pSelectionBrush(NULL), batchDrawing(true), levelOfDetail(true), frameMs(0), frames(0), panning(false),
+        panFrom(D2D1::Point2F(0, 0)), visibleShapes(0), document(scene),
+        autosaver(L"drawing.autosave"), autosaveArmed(false), idle(AutosaveInterval + 1000), idleCheckMs(0),
+        idleCheckFailed(false), paintCheckFrames(0), paintCheckPainted(0), paintCheckAllocations(0), paintCheckDirty(0), hovered(-1), selected(-1), tool(Tool::Draw),
+        softRenderer(&pool), softwareRendering(false), pSoftwareBitmap(NULL),
+        recognizer({ 4.0f, 500, 800, 1000.0f, 100 }), predictDrag(true), frameInterval(16) {}
 
     PCWSTR  ClassName() const { return L"Circle Window Class"; }
     LRESULT HandleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam);
+
+    // starts creating the graphics factories in the background; call before 'Create' so window creation overlaps it
+    void StartWarmup()
+    {
+        warmup.Start();
+        warmupStarted = true;
+    }
+
+    // called by the message loop for every message it wakes up for
+    void OnWakeup(const MSG& msg);
+
+    // runs the window for 'ms' without input, then closes it; 'IdleCheckFailed' tells whether it did any work meanwhile
+    void SetIdleCheck(DWORD ms) { idleCheckMs = ms; }
+    bool IdleCheckFailed() const { return idleCheckFailed; }
+
+    // paints 'frames' frames of a stress scene after a warm-up, then closes the window; 'PaintCheckFailed' tells whether
+    // any of them called the global 'operator new'
+    void SetPaintCheck(size_t frames) { paintCheckFrames = frames; }
+    bool PaintCheckFailed() const { return paintCheckDirty > 0; }
+
+    // writes the time to first frame to 'path' once it is presented, then closes the window (see '/startup')
+    void SetFirstFrameResult(const std::filesystem::path& path) { firstFrameResult = path; }
 };
 
 
@@ -111,7 +316,19 @@ void MainWindow::CalculateLayout(){}
 // create the two resources, i.e. render target and brush
 HRESULT MainWindow::CreateGraphicsResources()
 {
+    PROFILE_ZONE("CreateGraphicsResources");
     HRESULT hr = S_OK;
+    if (pFactory == NULL)
+    {
+        // the factories have been warming up since before the window was created; this only waits for what is left
+        hr = warmup.Take(&pFactory, &pWriteFactory, &pTextFormat);
+        StartupTimeline::Mark(L"graphics factories taken");
+        if (FAILED(hr))
+        {
+            DestroyWindow(m_hwnd);
+            return hr;
+        }
+    }
     if (pRenderTarget == NULL)
     {
         RECT rc;
@@ -139,7 +356,20 @@ HRESULT MainWindow::CreateGraphicsResources()
 
             if (SUCCEEDED(hr))
             {
+                hr = pRenderTarget->CreateSolidColorBrush(D2D1::ColorF(D2D1::ColorF::Black), &pOutlineBrush);
+            }
+
+            if (SUCCEEDED(hr))
+            {
+                hr = pRenderTarget->CreateSolidColorBrush(D2D1::ColorF(D2D1::ColorF::SteelBlue, 0.4f), &pSelectionBrush);
+            }
+
+            if (SUCCEEDED(hr))
+            {
+                // optional: without sprite batches the shapes are drawn one by one
+                sprites.Create(pRenderTarget);
                 CalculateLayout();
+                StartupTimeline::Mark(L"render target and brushes created");
             }
         }
     }
@@ -150,10 +380,16 @@ void MainWindow::DiscardGraphicsResources()
 {
     SafeRelease(&pRenderTarget);
     SafeRelease(&pBrush);
+    SafeRelease(&pOutlineBrush);
+    SafeRelease(&pSelectionBrush);
+    SafeRelease(&pSoftwareBitmap);
+    sprites.Discard();
 }
 
 void MainWindow::OnPaint()
 {
+    PROFILE_ZONE("OnPaint");
+    HeapWatch heapWatch; // with the frame arena in place, a steady-state frame should not call 'operator new' at all
     HRESULT hr = CreateGraphicsResources();
     if (SUCCEEDED(hr))
     {
@@ -162,13 +398,123 @@ void MainWindow::OnPaint()
         PAINTSTRUCT ps;
         BeginPaint(m_hwnd, &ps);
 
+        const std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
         pRenderTarget->BeginDraw(); // signals the start of drawing 
 
-        pRenderTarget->Clear(D2D1::ColorF(D2D1::ColorF::BlanchedAlmond)); // fill the render target with a solid color 
-        pRenderTarget->FillEllipse(ellipse, pBrush); // draws a filled ellipse, using the specified brush for the fill
+        // only the shapes overlapping the visible part of the world are submitted
+        const D2D1_RECT_F view = viewport.VisibleRect(pRenderTarget->GetSize());
+
+        // world coordinates to device pixels, for the level-of-detail threshold and the software renderer
+        const float pixelsX = DPIScale::ScaleX() * viewport.Zoom(), pixelsY = DPIScale::ScaleY() * viewport.Zoom();
+
+        if (!softwareRendering && batchDrawing && sprites.Ready())
+        {
+            // the visible shapes, gathered into the frame arena, are all drawn in one call
+            BatchArrays visible(&frameArena);
+            scene.Cull({ view.left, view.top, view.right, view.bottom }, visible);
+            const EllipseBatch batch = visible.Batch();
+            visibleShapes = batch.count;
+
+            pRenderTarget->SetTransform(viewport.Transform());
+            pRenderTarget->Clear(D2D1::ColorF(D2D1::ColorF::BlanchedAlmond)); // fill the render target with a solid color 
+            sprites.Draw(batch, pixelsX, pixelsY, levelOfDetail, &frameArena);
+        }
+        else
+        {
+            // the commands are only recorded again when the scene or the view has changed since the last frame;
+            // the software renderer splats sub-pixel shapes by itself, so its list keeps them as ellipses
+            const SceneDisplayList::Key key = { scene.Version(), view.left, view.top, view.right, view.bottom, pixelsX, pixelsY,
+                levelOfDetail && !softwareRendering, 0xFFFFEBCD }; // BlanchedAlmond
+            const DisplayList& list = sceneList.Get(scene, key, &frameArena, listOptimizer);
+            visibleShapes = list.Shapes();
+
+            if (softwareRendering)
+            {
+                // the software renderer takes the shapes as a batch, applies the view itself and draws a bitmap in device pixels
+                BatchArrays shapes(&frameArena);
+                BatchDisplayBackend backend(shapes);
+                list.Replay(backend);
+                DrawSoftware(shapes.Batch(), backend.Background());
+                pRenderTarget->SetTransform(viewport.Transform());
+            }
+            else
+            {
+                // one brush for every shape, recolored only where the list changes the color
+                pRenderTarget->SetTransform(viewport.Transform());
+                D2DDisplayBackend backend(pRenderTarget, pBrush);
+                list.Replay(backend);
+                pBrush->SetColor(D2D1::ColorF(Scene::DefaultColor & 0xFFFFFF)); // the contacts below are drawn with it
+            }
+        }
+
+        // outlines keep their width on screen at any zoom
+        if (hovered >= 0)
+        {
+            pRenderTarget->DrawEllipse(scene.Get(hovered), pOutlineBrush, 1.0f / viewport.Zoom());
+        }
+        if (selected >= 0)
+        {
+            pRenderTarget->DrawEllipse(scene.Get(selected), pOutlineBrush, 3.0f / viewport.Zoom());
+        }
+
+        // one ellipse per active pen/touch contact, computed for all contacts in one pass over the SoA state
+        float cx[PointerContacts::MaxContacts], cy[PointerContacts::MaxContacts];
+        float rx[PointerContacts::MaxContacts], ry[PointerContacts::MaxContacts];
+        contacts.Ellipses(cx, cy, rx, ry);
+        for (size_t i = 0; i < contacts.Count(); i++)
+        {
+            pRenderTarget->FillEllipse(D2D1::Ellipse(D2D1::Point2F(cx[i], cy[i]), rx[i], ry[i]), pBrush);
+        }
+
+        // the text is not part of the drawing, it stays in the upper left corner
+        pRenderTarget->SetTransform(D2D1::Matrix3x2F::Identity());
+        DrawTextBuffer();
 
         hr = pRenderTarget->EndDraw(); //  signals the completion of drawing for this frame
 
+        // Direct2D only submits its work in 'EndDraw', so the whole frame is timed rather than the drawing calls
+        frameMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+        if (++frames == 60)
+        {
+            const wchar_t* mode = softwareRendering ? L"software" : (batchDrawing && sprites.Ready() ? L"sprite batch" : L"FillEllipse");
+            wchar_t msg[256];
+            swprintf_s(msg, L"paint: %.2f ms per frame, %zu of %zu shapes visible at zoom %.3f, %s, LOD %s, display list recorded %zu reused %zu times, %zu commands (%zu recorded)\n",
+                frameMs / frames, visibleShapes, scene.Count(), viewport.Zoom(), mode, levelOfDetail ? L"on" : L"off",
+                sceneList.Recorded(), sceneList.Reused(), sceneList.Commands(), sceneList.RecordedCommands());
+            OutputDebugString(msg);
+            frameMs = 0;
+            frames = 0;
+        }
+
+        idle.OnFrame(GetTickCount());
+        if (!firstFrameShown)
+        {
+            firstFrameShown = true;
+            StartupTimeline::Finish(L"first frame presented");
+            if (!firstFrameResult.empty())
+            {
+                std::ofstream(firstFrameResult) << StartupTimeline::FirstFrameMs();
+                PostMessage(m_hwnd, WM_CLOSE, 0, 0);
+            }
+        }
+
+        // every change to the document repaints, so this is where the autosave after a change gets scheduled
+        if (document.HasUnsaved() && !autosaveArmed)
+        {
+            SetTimer(m_hwnd, IDT_AUTOSAVE, AutosaveInterval, NULL);
+            autosaveArmed = true;
+        }
+
+        // a frame that still needed the heap grew the arena; after the first few frames this should not happen any more
+        frameArena.Reset();
+        if (frameArena.LastFrame().heapAllocations > 0)
+        {
+            wchar_t msg[128];
+            swprintf_s(msg, L"frame arena: %zu heap allocations, grown to %zu bytes\n",
+                frameArena.LastFrame().heapAllocations, frameArena.Capacity());
+            OutputDebugString(msg);
+        }
+
         /*
          - BeginDraw, Clear, and FillEllipse methods all have a void return type
          - if an error occurs during the execution of any of these methods, the error is signaled through the return
@@ -182,11 +528,122 @@ void MainWindow::OnPaint()
             DiscardGraphicsResources();
         }
         EndPaint(m_hwnd, &ps);
+
+        if (paintCheckFrames > 0)
+        {
+            CheckPaint(heapWatch.Allocations());
+        }
+        else if (heapWatch.Allocations() > 0)
+        {
+            wchar_t msg[96];
+            swprintf_s(msg, L"paint: %zu global operator new calls\n", heapWatch.Allocations());
+            OutputDebugString(msg);
+        }
     }
 }
 
+// rasterize the visible shapes on the CPU across all cores, then draw the result as one bitmap covering the client area
+void MainWindow::DrawSoftware(const EllipseBatch& batch, UINT32 background)
+{
+    const D2D1_SIZE_U size = pRenderTarget->GetPixelSize();
+    if (softRenderer.Width() != size.width || softRenderer.Height() != size.height)
+    {
+        softRenderer.Resize(size.width, size.height);
+        SafeRelease(&pSoftwareBitmap);
+    }
+
+    softRenderer.SetLevelOfDetail(levelOfDetail);
+    const float scaleX = DPIScale::ScaleX() * viewport.Zoom(), scaleY = DPIScale::ScaleY() * viewport.Zoom();
+    softRenderer.Render(batch, scaleX, scaleY, -viewport.Origin().x * scaleX, -viewport.Origin().y * scaleY, background);
+
+    if (pSoftwareBitmap == NULL)
+    {
+        // the bitmap DPI matches the window, so it covers the render target exactly when drawn at its natural size
+        const D2D1_BITMAP_PROPERTIES props = D2D1::BitmapProperties(
+            D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_IGNORE),
+            96.0f * DPIScale::ScaleX(), 96.0f * DPIScale::ScaleY());
+        if (FAILED(pRenderTarget->CreateBitmap(size, NULL, 0, props, &pSoftwareBitmap)))
+        {
+            return;
+        }
+    }
+
+    pSoftwareBitmap->CopyFromMemory(NULL, softRenderer.Pixels(), softRenderer.Stride());
+    pRenderTarget->DrawBitmap(pSoftwareBitmap);
+
+    if (recorder)
+    {
+        // the recorder keeps the frame and the renderer draws the next one into a spare buffer: no copy here
+        recorder->Submit(softRenderer);
+    }
+}
+
+/*
+ - draws the typed text in the upper left corner, with the selection highlighted and a caret
+ - only the text around the caret is laid out, so a multi-megabyte document costs no more to draw than a short one
+*/
+void MainWindow::DrawTextBuffer()
+{
+    const size_t length = text.Length();
+    if (pTextFormat == NULL || (length == 0 && GetFocus() != m_hwnd))
+    {
+        return;
+    }
+
+    const size_t window = 2048; // code units laid out on each side of the caret
+    const size_t caret = text.Caret();
+    const size_t first = text.SnapToCodePoint(caret > window ? caret - window : 0);
+    const size_t last = text.SnapToCodePoint(caret + window < length ? caret + window : length);
+
+    std::pmr::wstring visible(&frameArena);
+    text.CopyRange(first, last, visible);
+
+    const D2D1_SIZE_F size = pRenderTarget->GetSize();
+    IDWriteTextLayout* pLayout = NULL;
+    if (FAILED(pWriteFactory->CreateTextLayout(visible.c_str(), static_cast<UINT32>(visible.size()), pTextFormat,
+        size.width, size.height, &pLayout)))
+    {
+        return;
+    }
+
+    const D2D1_POINT_2F origin = D2D1::Point2F(8.0f, 8.0f);
+
+    // selection: one rectangle per line it covers
+    const size_t selFirst = text.SelectionStart() > first ? text.SelectionStart() : first;
+    const size_t selLast = text.SelectionEnd() < last ? text.SelectionEnd() : last;
+    if (selFirst < selLast)
+    {
+        UINT32 count = 0;
+        pLayout->HitTestTextRange(static_cast<UINT32>(selFirst - first), static_cast<UINT32>(selLast - selFirst),
+            origin.x, origin.y, NULL, 0, &count);
+
+        std::pmr::vector<DWRITE_HIT_TEST_METRICS> metrics(count, &frameArena);
+        if (count > 0 && SUCCEEDED(pLayout->HitTestTextRange(static_cast<UINT32>(selFirst - first),
+            static_cast<UINT32>(selLast - selFirst), origin.x, origin.y, metrics.data(), count, &count)))
+        {
+            for (const DWRITE_HIT_TEST_METRICS& m : metrics)
+            {
+                pRenderTarget->FillRectangle(D2D1::RectF(m.left, m.top, m.left + m.width, m.top + m.height), pSelectionBrush);
+            }
+        }
+    }
+
+    pRenderTarget->DrawTextLayout(origin, pLayout, pOutlineBrush);
+
+    FLOAT caretX, caretY;
+    DWRITE_HIT_TEST_METRICS caretMetrics;
+    if (SUCCEEDED(pLayout->HitTestTextPosition(static_cast<UINT32>(caret - first), FALSE, &caretX, &caretY, &caretMetrics)))
+    {
+        pRenderTarget->FillRectangle(D2D1::RectF(origin.x + caretX, origin.y + caretY,
+            origin.x + caretX + 1.5f, origin.y + caretY + caretMetrics.height), pOutlineBrush);
+    }
+
+    SafeRelease(&pLayout);
+}
+
 void MainWindow::Resize()
 {
+    PROFILE_ZONE("Resize");
     if (pRenderTarget != NULL)
     {
         RECT rc;
@@ -201,51 +658,705 @@ void MainWindow::Resize()
 }
 
 
-void MainWindow::OnLButtonDown(int pixelX, int pixelY, DWORD flags)
+// the whole drag interaction, from button down to button up
+Gesture MainWindow::DragEllipse(PointerEvent down)
 {
     // begin capturing the mouse
-    SetCapture(m_hwnd);  
+    SetCapture(m_hwnd);
 
-    // store the position of the mouse in the ptMouse variable, position defines the upper left corner of the bounding box for the ellipse
-    ellipse.point = ptMouse = DPIScale::PixelsToDips(pixelX, pixelY); 
-    
-    // reset the ellipse structure 
-    ellipse.radiusX = ellipse.radiusY = 1.0f;
+    // the mouse-down position defines the upper left corner of the bounding box for the ellipse
+    const D2D1_POINT_2F ptMouse = viewport.ScreenToWorld(down.pt);
 
-    // force the window to be repainted 
-    InvalidateRect(m_hwnd, NULL, FALSE);
+    // the new shape goes on top of the scene once the mouse has moved; a click without a drag creates nothing
+    ptrdiff_t shape = -1;
+
+    predictor.Reset(down.pt, down.time);
+    predictor.ResetStats();
+
+    // stretch the ellipse so its bounding box spans from the mouse-down position to 'screen'; returns false if it has no area
+    auto stretch = [this, ptMouse, &shape](D2D1_POINT_2F screen)
+    {
+        // pointer positions and predictions are in screen DIPs, the shape is in world coordinates
+        const D2D1_POINT_2F pt = viewport.ScreenToWorld(screen);
+        const float width = (pt.x - ptMouse.x) / 2;
+        const float height = (pt.y - ptMouse.y) / 2;
+        const float x1 = ptMouse.x + width;
+        const float y1 = ptMouse.y + height;
+
+        // ellipse is defined by the center point and x - and y - radii; every step of the drag is logged
+        const D2D1_ELLIPSE e = D2D1::Ellipse(D2D1::Point2F(x1, y1), width, height);
+        if (shape < 0 && width != 0 && height != 0)
+        {
+            shape = static_cast<ptrdiff_t>(document.CreateShape(e));
+        }
+        else if (shape >= 0)
+        {
+            document.Resize(static_cast<size_t>(shape), e);
+        }
+
+        InvalidateRect(m_hwnd, NULL, FALSE);
+        return width != 0 && height != 0;
+    };
+
+    for (;;)
+    {
+        const PointerEvent e = co_await next_pointer_event();
+
+        if (e.type == PointerEventType::Up)
+        {
+            // the final shape always uses the real release position, never a prediction;
+            // released where it started in either direction, it has no area and would only be an invisible shape
+            if (!stretch(e.pt) && shape >= 0)
+            {
+                document.Delete(static_cast<size_t>(shape));
+            }
+            break;
+        }
+
+        // check whether left mouse button is still down, if it is, recalculate the ellipse and repaint the window
+        if (e.type == PointerEventType::Move && (e.flags & MK_LBUTTON))
+        {
+            // the positions the move stands for come first; only the last one is drawn
+            for (UINT32 i = 0; i < e.coalescedCount; i++)
+            {
+                predictor.AddSample(e.coalesced[i].pt, e.coalesced[i].time);
+            }
+            predictor.AddSample(e.pt, e.time);
+
+            // the frame drawn for this move reaches the screen about one frame interval after the sample was taken
+            stretch(predictDrag ? predictor.Predict(e.time + frameInterval) : e.pt);
+        }
+    }
+
+    ReleaseCapture();
+
+    if (predictDrag && predictor.Stats().samples > 0)
+    {
+        const PredictionStats& stats = predictor.Stats();
+        wchar_t msg[128];
+        swprintf_s(msg, L"prediction: %d samples, %.1f ms ahead, error mean %.2f max %.2f DIPs\n",
+            stats.samples, stats.MeanLead(), stats.MeanError(), stats.maxError);
+        OutputDebugString(msg);
+    }
+
+    if (pointerHistory && pointerHistory->Stats().batches > 1)
+    {
+        const PointerHistoryStats& stats = pointerHistory->Stats();
+        wchar_t msg[160];
+        swprintf_s(msg, L"pointer history: %zu moves, %zu coalesced samples recovered (%.1f per move), %zu overflows, %.1f us per fetch\n",
+            stats.batches - 1, stats.samples, static_cast<double>(stats.samples) / (stats.batches - 1), stats.overflows, stats.MicrosecondsPerBatch());
+        OutputDebugString(msg);
+    }
+}
+
+
+// the select tool: the picked shape follows the mouse, keeping the offset between its center and the mouse-down position
+Gesture MainWindow::MoveShape(PointerEvent down, size_t shape)
+{
+    SetCapture(m_hwnd);
+
+    const D2D1_ELLIPSE start = scene.Get(shape);
+
+    for (;;)
+    {
+        const PointerEvent e = co_await next_pointer_event();
+
+        if (e.type == PointerEventType::Move && (e.flags & MK_LBUTTON))
+        {
+            D2D1_ELLIPSE moved = start;
+            const float zoom = viewport.Zoom();
+            moved.point = D2D1::Point2F(start.point.x + (e.pt.x - down.pt.x) / zoom, start.point.y + (e.pt.y - down.pt.y) / zoom);
+
+            // also moves the shape in the spatial grid
+            document.Resize(shape, moved);
+            InvalidateRect(m_hwnd, NULL, FALSE);
+        }
+        else if (e.type == PointerEventType::Up)
+        {
+            break;
+        }
+    }
+
+    ReleaseCapture();
+}
+
+
+// the mouse handlers only translate the message into a 'PointerEvent' and forward it to the gesture and the recognizer
+void MainWindow::OnLButtonDown(int pixelX, int pixelY, DWORD flags)
+{
+    PROFILE_ZONE("OnLButtonDown");
+    const PointerEvent e = { PointerEventType::Down, DPIScale::PixelsToDips(pixelX, pixelY), flags, static_cast<DWORD>(GetMessageTime()) };
+
+    // the history of this drag starts at the press; the first fetch only marks the place
+    if (pointerHistory)
+    {
+        pointerHistory->Reset();
+        pointerHistory->ResetStats();
+        historySamples.clear();
+        pointerHistory->Fetch(pixelX, pixelY, e.time, historySamples);
+    }
+
+    // the previous gesture's frame goes before the new one is allocated, so the new one reuses its block
+    gesture.Reset();
+    const size_t heapFrames = GesturePool().HeapFrames();
+    if (tool == Tool::Select)
+    {
+        selected = scene.Pick(viewport.ScreenToWorld(e.pt));
+        gesture = selected >= 0 ? MoveShape(e, selected) : Gesture();
+        InvalidateRect(m_hwnd, NULL, FALSE);
+    }
+    else
+    {
+        gesture = DragEllipse(e);
+    }
+    if (GesturePool().HeapFrames() != heapFrames)
+    {
+        wchar_t msg[128];
+        swprintf_s(msg, L"frame pool: a gesture frame went to the heap (frames up to %zu bytes, %zu-byte blocks)\n",
+            GesturePool().LargestFrame(), GestureFramePool::BlockBytes);
+        OutputDebugString(msg);
+    }
+    RecognizeGestures(e);
 }
 
 
 void MainWindow::OnMouseMove(int pixelX, int pixelY, DWORD flags)
 {
-    // check whether left mouse button is down, if it is, recalculate the ellipse and repaint the window
-    if (flags & MK_LBUTTON) 
+    PROFILE_ZONE("OnMouseMove");
+    PointerEvent e = { PointerEventType::Move, DPIScale::PixelsToDips(pixelX, pixelY), flags, static_cast<DWORD>(GetMessageTime()) };
+
+    if (panning)
     {
-        const D2D1_POINT_2F dips = DPIScale::PixelsToDips(pixelX, pixelY);
+        viewport.Pan(e.pt.x - panFrom.x, e.pt.y - panFrom.y);
+        panFrom = e.pt;
+        InvalidateRect(m_hwnd, NULL, FALSE);
+        return;
+    }
 
-        const float width = (dips.x - ptMouse.x) / 2;
-        const float height = (dips.y - ptMouse.y) / 2;
-        const float x1 = ptMouse.x + width;
-        const float y1 = ptMouse.y + height;
+    // while dragging, the positions the system merged into this message travel with it, oldest first
+    if (pointerHistory && (flags & MK_LBUTTON))
+    {
+        historySamples.clear();
+        pointerHistory->Fetch(pixelX, pixelY, e.time, historySamples);
+
+        coalescedEvents.clear();
+        for (const HistorySample& s : historySamples)
+        {
+            coalescedEvents.push_back(PointerEvent{ PointerEventType::Move, DPIScale::PixelsToDips(s.x, s.y), flags, s.time });
+        }
+        e.coalesced = coalescedEvents.data();
+        e.coalescedCount = static_cast<UINT32>(coalescedEvents.size());
+    }
 
-        // ellipse is defined by the center point and x - and y - radii
-        ellipse = D2D1::Ellipse(D2D1::Point2F(x1, y1), width, height);
+    gesture.Send(e);
+    RecognizeGestures(e);
 
+    // hover: outline the topmost shape under the mouse while no button is down; every move hit tests, so it goes
+    // through the grid cell under the mouse ('Pick') rather than the block boxes of the whole scene ('HitTest')
+    const ptrdiff_t hit = (flags & MK_LBUTTON) ? -1 : scene.Pick(viewport.ScreenToWorld(e.pt));
+    if (hit != hovered)
+    {
+        hovered = hit;
         InvalidateRect(m_hwnd, NULL, FALSE);
     }
 }
 
 
-void MainWindow::OnLButtonUp()
+void MainWindow::OnLButtonUp(int pixelX, int pixelY, DWORD flags)
 {
-    ReleaseCapture();
+    PROFILE_ZONE("OnLButtonUp");
+    const PointerEvent e = { PointerEventType::Up, DPIScale::PixelsToDips(pixelX, pixelY), flags, static_cast<DWORD>(GetMessageTime()) };
+
+    gesture.Send(e);
+    RecognizeGestures(e);
+}
+
+
+// the wheel zooms around the cursor, one notch (WHEEL_DELTA) at a time by a factor of 1.25
+void MainWindow::OnMouseWheel(int pixelX, int pixelY, short delta)
+{
+    PROFILE_ZONE("OnMouseWheel");
+    // wheel messages carry screen coordinates
+    POINT pt = { pixelX, pixelY };
+    ScreenToClient(m_hwnd, &pt);
+
+    viewport.ZoomAt(DPIScale::PixelsToDips(pt.x, pt.y), std::pow(1.25f, static_cast<float>(delta) / WHEEL_DELTA));
+    hovered = -1;
+    InvalidateRect(m_hwnd, NULL, FALSE);
+}
+
+
+void MainWindow::RecognizeGestures(const PointerEvent& e)
+{
+    // hover moves carry no gesture information
+    if (e.type == PointerEventType::Move && !recognizer.Pressed())
+    {
+        return;
+    }
+
+    // the coalesced positions sharpen the velocity a flick is recognized by
+    for (UINT32 i = 0; i < e.coalescedCount; i++)
+    {
+        const PointerSample coalesced = { e.coalesced[i].type, e.coalesced[i].pt, e.coalesced[i].time };
+        recognizer.AddSample(coalesced, [this](const RecognizedGesture& g) { OnGestureRecognized(g); });
+    }
+
+    const PointerSample sample = { e.type, e.pt, e.time };
+    recognizer.AddSample(sample, [this](const RecognizedGesture& g) { OnGestureRecognized(g); });
+
+    // the long-press timer only runs while the pointer is down
+    if (e.type == PointerEventType::Down)
+    {
+        SetTimer(m_hwnd, IDT_LONGPRESS, recognizer.Settings().longPressTime, NULL);
+    }
+    else if (e.type == PointerEventType::Up)
+    {
+        KillTimer(m_hwnd, IDT_LONGPRESS);
+    }
+}
+
+
+void MainWindow::OnGestureRecognized(const RecognizedGesture& g)
+{
+    static const wchar_t* const names[] = { L"click", L"double-click", L"drag", L"flick", L"long-press" };
+
+    wchar_t msg[96];
+    swprintf_s(msg, L"gesture: %s at (%.1f, %.1f), velocity (%.0f, %.0f) DIPs/s\n",
+        names[static_cast<int>(g.kind)], g.pt.x, g.pt.y, g.velocity.x, g.velocity.y);
+    OutputDebugString(msg);
+
+    if (g.kind == GestureKind::Drag || g.kind == GestureKind::LongPress)
+    {
+        KillTimer(m_hwnd, IDT_LONGPRESS);
+    }
+}
+
+
+void MainWindow::OnTimer(UINT_PTR id)
+{
+    if (id == IDT_LONGPRESS)
+    {
+        // the message time, like the samples' times: 'GetTickCount' would be read later than the timer fired
+        recognizer.Tick(static_cast<DWORD>(GetMessageTime()), [this](const RecognizedGesture& g) { OnGestureRecognized(g); });
+    }
+    else if (id == IDT_AUTOSAVE)
+    {
+        KillTimer(m_hwnd, IDT_AUTOSAVE);
+        autosaveArmed = false;
+        Autosave();
+    }
+    else if (id == IDT_IDLECHECK)
+    {
+        // after settling, an idle window must not have woken up or drawn at all
+        const IdleReport r = idle.Report(GetTickCount());
+        LogIdle(L"idle check", r);
+        idleCheckFailed = r.wakeups > 0 || r.frames > 0;
+        DestroyWindow(m_hwnd);
+    }
+}
+
+
+void MainWindow::OnWakeup(const MSG& msg)
+{
+    IdleReport ended;
+    if (IsInputMessage(msg.message))
+    {
+        if (idle.OnInput(msg.time, ended))
+        {
+            LogIdle(L"idle period ended", ended);
+        }
+    }
+    else if (msg.message != WM_TIMER || msg.wParam != IDT_IDLECHECK)
+    {
+        idle.OnWakeup(msg.time);
+    }
+}
+
+void MainWindow::LogIdle(const wchar_t* when, const IdleReport& r)
+{
+    wchar_t msg[256];
+    swprintf_s(msg, L"%s: idle %.1f min, %zu wakeups (%.2f/min) and %zu frames (%.2f/min) after settling, %zu wakeups while settling\n",
+        when, r.idleMs / 60000.0, r.wakeups, r.PerMinute(r.wakeups), r.frames, r.PerMinute(r.frames), r.settleWakeups);
+    OutputDebugString(msg);
+}
+
+// '/paintheap': counts the global allocations of the frame just painted, then changes the view a little and paints again
+void MainWindow::CheckPaint(size_t allocations)
+{
+    wchar_t msg[128];
+    paintCheckPainted++;
+    if (paintCheckPainted > PaintCheckWarmupFrames && allocations > 0)
+    {
+        paintCheckAllocations += allocations;
+        paintCheckDirty++;
+        swprintf_s(msg, L"paint check: frame %zu called operator new %zu times\n", paintCheckPainted, allocations);
+        OutputDebugString(msg);
+    }
+    if (paintCheckPainted == PaintCheckWarmupFrames + paintCheckFrames)
+    {
+        swprintf_s(msg, L"paint check: %zu of %zu frames allocated, %zu calls in all\n",
+            paintCheckDirty, paintCheckFrames, paintCheckAllocations);
+        OutputDebugString(msg);
+        DestroyWindow(m_hwnd);
+        return;
+    }
+
+    // panning back and forth by a pixel records the display list again every frame, between two views the warm-up
+    // has already seen; the hover outline moves from shape to shape on top
+    viewport.Pan(paintCheckPainted % 2 ? 1.0f : -1.0f, 0);
+    hovered = scene.Count() > 0 ? static_cast<ptrdiff_t>(paintCheckPainted % scene.Count()) : -1;
+    InvalidateRect(m_hwnd, NULL, FALSE);
+}
+
+
+// the UI thread's part of an autosave: taking the unsaved operations by reference, which is what the stall time measures
+void MainWindow::Autosave()
+{
+    // the paint check's stress scene is not the user's drawing, and must not replace it in the journal
+    if (!document.HasUnsaved() || paintCheckFrames > 0)
+    {
+        return;
+    }
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    LogSlice slice = document.TakeUnsaved();
+    const size_t operations = slice.last - slice.first;
+    autosaver.Submit(std::move(slice));
+    const double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    wchar_t msg[128];
+    swprintf_s(msg, L"autosave: %zu operations handed off, UI thread stalled %.1f us\n", operations, us);
+    OutputDebugString(msg);
+}
+
+
+/*
+ - pen and touch input arrives as WM_POINTER* messages, one pointer id per contact, so several contacts can be down at once
+ - the mouse is left on WM_LBUTTON* / WM_MOUSEMOVE (it only produces pointer messages after 'EnableMouseInPointer')
+ - returns false for messages that should go to DefWindowProc
+*/
+bool MainWindow::OnPointer(UINT uMsg, WPARAM wParam, LPARAM lParam)
+{
+    PROFILE_ZONE("OnPointer");
+    const UINT32 id = GET_POINTERID_WPARAM(wParam);
+
+    POINTER_INPUT_TYPE type;
+    if (!GetPointerType(id, &type) || type == PT_MOUSE)
+    {
+        return false;
+    }
+
+    if (uMsg == WM_POINTERCAPTURECHANGED)
+    {
+        // the contact was taken away from this window, drop it without keeping its ellipse
+        contacts.Remove(id);
+        InvalidateRect(m_hwnd, NULL, FALSE);
+        return true;
+    }
+
+    // pointer messages carry screen coordinates
+    POINT pt = { GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam) };
+    ScreenToClient(m_hwnd, &pt);
+    const D2D1_POINT_2F dips = viewport.ScreenToWorld(DPIScale::PixelsToDips(pt.x, pt.y));
+
+    // a pen hovering above the screen is not drawing
+    if (uMsg == WM_POINTERUPDATE && !IS_POINTER_INCONTACT_WPARAM(wParam))
+    {
+        return true;
+    }
+
+    // the released contact adds its ellipse to the scene, just like the end of a mouse drag
+    D2D1_ELLIPSE released;
+    if (contacts.OnMessage(uMsg, id, dips, released))
+    {
+        document.CreateShape(released);
+    }
+
+    InvalidateRect(m_hwnd, NULL, FALSE);
+    return true;
+}
+
+
+// F5: the selected shape takes the next color of the palette
+void MainWindow::Recolor()
+{
+    if (selected < 0)
+    {
+        return;
+    }
+
+    const UINT32 current = scene.Color(selected);
+    size_t next = 0;
+    for (size_t i = 0; i < ARRAYSIZE(Scene::Palette); i++)
+    {
+        if (Scene::Palette[i] == current)
+        {
+            next = (i + 1) % ARRAYSIZE(Scene::Palette);
+        }
+    }
+    document.Recolor(selected, Scene::Palette[next]);
+    InvalidateRect(m_hwnd, NULL, FALSE);
+}
+
+
+// PageUp / PageDown: step through the history in 1% increments, the next edit continues from the state shown
+void MainWindow::SeekHistory(ptrdiff_t step)
+{
+    const ptrdiff_t size = static_cast<ptrdiff_t>(document.OperationCount());
+    const ptrdiff_t stride = size / 100 > 1 ? size / 100 : 1;
+    ptrdiff_t target = static_cast<ptrdiff_t>(document.Position()) + step * stride;
+    target = target < 0 ? 0 : (target > size ? size : target);
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const size_t replayed = document.Seek(target);
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    wchar_t msg[128];
+    swprintf_s(msg, L"history: at %zu of %zu operations, %zu replayed in %.2f ms\n", document.Position(), document.OperationCount(), replayed, ms);
+    OutputDebugString(msg);
+
+    OnSceneReplaced();
+}
+
+
+// Ctrl+O: reopen the history saved with Ctrl+S
+void MainWindow::OpenDocument()
+{
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const bool opened = document.Open(L"drawing.history");
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    if (opened)
+    {
+        wchar_t msg[128];
+        swprintf_s(msg, L"open: %zu operations, %zu snapshots in %.2f ms\n", document.OperationCount(), document.SnapshotCount(), ms);
+        OutputDebugString(msg);
+        OnSceneReplaced();
+    }
+}
+
+
+// ends the drag in progress without waiting for the button to be released
+void MainWindow::CancelGesture()
+{
+    if (gesture.Active())
+    {
+        gesture = Gesture();
+        ReleaseCapture();
+    }
+}
+
+
+// the scene was rebuilt from the log: shape indices held by the UI may no longer exist
+void MainWindow::OnSceneReplaced()
+{
+    CancelGesture();
+    hovered = selected = -1;
+    InvalidateRect(m_hwnd, NULL, FALSE);
+}
+
+
+/*
+ - F6: a draw-call-bound scene for measuring the renderers; small random shapes all over the view
+ - Shift+F6: a dense scene of sub-pixel shapes, as a zoomed-out drawing would look, for measuring level of detail
+ - Ctrl+F6: a large scene reaching 25 views beyond each side of the current one, for measuring culling while panning
+*/
+void MainWindow::AddStressShapes(size_t count, float minRadius, float maxRadius, float spread)
+{
+    const D2D1_RECT_F view = viewport.VisibleRect(pRenderTarget ? pRenderTarget->GetSize() : D2D1::SizeF(800, 600));
+    const float width = view.right - view.left, height = view.bottom - view.top;
+    std::mt19937 random(static_cast<unsigned>(scene.Count()));
+    std::uniform_real_distribution<float> x(view.left - spread * width, view.right + spread * width);
+    std::uniform_real_distribution<float> y(view.top - spread * height, view.bottom + spread * height);
+    std::uniform_real_distribution<float> radius(minRadius, maxRadius);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        document.CreateShape(D2D1::Ellipse(D2D1::Point2F(x(random), y(random)), radius(random), radius(random)),
+            Scene::Palette[random() % ARRAYSIZE(Scene::Palette)]);
+    }
+    InvalidateRect(m_hwnd, NULL, FALSE);
+}
+
+
+// typed characters go into the text buffer; Backspace, Enter and the Ctrl+letter shortcuts arrive here as control characters
+void MainWindow::OnChar(wchar_t c)
+{
+    PROFILE_ZONE("OnChar");
+    switch (c)
+    {
+    case 0x08: // Backspace
+        text.Backspace();
+        break;
+
+    case L'\r': // Enter
+        text.Insert(L'\n');
+        break;
+
+    case 0x01: // Ctrl+A
+        text.SelectAll();
+        break;
+
+    case 0x03: // Ctrl+C
+        CopySelection();
+        return;
+
+    case 0x18: // Ctrl+X
+        CopySelection();
+        text.Delete();
+        break;
+
+    case 0x16: // Ctrl+V
+        Paste();
+        break;
+
+    default:
+        // other control characters (Escape, Ctrl+S, ...) are not text; surrogate halves arrive as two WM_CHAR messages
+        if (c < 0x20 && c != L'\t')
+        {
+            return;
+        }
+        text.Insert(c);
+        break;
+    }
+    InvalidateRect(m_hwnd, NULL, FALSE);
+}
+
+
+// caret movement and Delete; these keys produce no WM_CHAR
+bool MainWindow::OnEditKey(WPARAM key)
+{
+    PROFILE_ZONE("OnEditKey");
+    const bool extend = keys.IsDown(VK_SHIFT);
+
+    switch (key)
+    {
+    case VK_LEFT:   text.MoveLeft(extend); break;
+    case VK_RIGHT:  text.MoveRight(extend); break;
+    case VK_HOME:   text.MoveLineStart(extend); break;
+    case VK_END:    text.MoveLineEnd(extend); break;
+    case VK_DELETE: text.Delete(); break;
+    default:
+        return false;
+    }
+    InvalidateRect(m_hwnd, NULL, FALSE);
+    return true;
+}
+
+
+void MainWindow::CopySelection()
+{
+    if (!text.HasSelection() || !OpenClipboard(m_hwnd))
+    {
+        return;
+    }
+
+    std::wstring selection;
+    text.CopyRange(text.SelectionStart(), text.SelectionEnd(), selection);
+
+    // the clipboard owns the memory once 'SetClipboardData' succeeds
+    HGLOBAL hMem = GlobalAlloc(GMEM_MOVEABLE, (selection.size() + 1) * sizeof(wchar_t));
+    if (hMem)
+    {
+        memcpy(GlobalLock(hMem), selection.c_str(), (selection.size() + 1) * sizeof(wchar_t));
+        GlobalUnlock(hMem);
+
+        EmptyClipboard();
+        if (!SetClipboardData(CF_UNICODETEXT, hMem))
+        {
+            GlobalFree(hMem);
+        }
+    }
+    CloseClipboard();
+}
+
+
+// a paste is a single insert of the whole clipboard text, so large pastes cost one gap move and one copy
+void MainWindow::Paste()
+{
+    if (!OpenClipboard(m_hwnd))
+    {
+        return;
+    }
+
+    HANDLE hData = GetClipboardData(CF_UNICODETEXT);
+    const wchar_t* pData = hData ? static_cast<const wchar_t*>(GlobalLock(hData)) : NULL;
+    if (pData)
+    {
+        // normalize CRLF to the LF line breaks the buffer uses
+        std::wstring pasted;
+        for (const wchar_t* p = pData; *p; p++)
+        {
+            if (*p != L'\r')
+            {
+                pasted.push_back(*p);
+            }
+        }
+        text.Insert(pasted.c_str(), pasted.size());
+        GlobalUnlock(hData);
+    }
+    CloseClipboard();
 }
 
 
 int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE, PWSTR, int nCmdShow)
 {
+    StartupTimeline::Begin();
+
+    int argc = 0;
+    LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+    if (argv && argc >= 2)
+    {
+        for (const SelfTest& test : SelfTests())
+        {
+            if (wcscmp(argv[1], test.name) == 0 && (test.argc == 0 || test.argc == argc))
+            {
+                const int result = test.run(argc, argv);
+                LocalFree(argv);
+                return result;
+            }
+        }
+    }
+
+    // idle check: UserInputWin32.exe /idle <seconds>, exits with 1 if the window did any work while left alone
+    DWORD idleCheckMs = 0;
+    if (argv && argc == 3 && wcscmp(argv[1], L"/idle") == 0)
+    {
+        idleCheckMs = static_cast<DWORD>(_wtoi(argv[2])) * 1000;
+    }
+
+    // paint check: UserInputWin32.exe /paintheap <frames>, exits with 1 if a frame after the warm-up called 'operator new'
+    // (HEAPWATCH builds only)
+    size_t paintCheckFrames = 0;
+#ifdef HEAPWATCH
+    if (argv && argc == 3 && wcscmp(argv[1], L"/paintheap") == 0)
+    {
+        paintCheckFrames = static_cast<size_t>(_wtoi(argv[2]));
+    }
+#endif
+
+    // a run of '/startup': UserInputWin32.exe /firstframe <file> [/syncstartup]
+    std::filesystem::path firstFrameResult;
+    if (argv && (argc == 3 || argc == 4) && wcscmp(argv[1], L"/firstframe") == 0)
+    {
+        firstFrameResult = argv[2];
+    }
+
+    // '/syncstartup' creates the graphics factories in WM_CREATE, the old way, to compare time to first frame
+    const bool syncStartup = argv && ((argc == 2 && wcscmp(argv[1], L"/syncstartup") == 0) ||
+        (argc == 4 && !firstFrameResult.empty() && wcscmp(argv[3], L"/syncstartup") == 0));
+    LocalFree(argv);
+    StartupTimeline::Mark(L"command line parsed");
+
     MainWindow win;
+    win.SetIdleCheck(idleCheckMs);
+    win.SetPaintCheck(paintCheckFrames);
+    win.SetFirstFrameResult(firstFrameResult);
+    StartupTimeline::Mark(L"window object constructed");
+    if (!syncStartup)
+    {
+        win.StartWarmup();
+    }
 
     if (!win.Create(L"Draw Circle", WS_OVERLAPPEDWINDOW))
     {
@@ -253,38 +1364,78 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE, PWSTR, int nCmdShow)
     }
 
     ShowWindow(win.Window(), nCmdShow);
+    StartupTimeline::Mark(L"window shown");
 
     // Run the message loop.
     MSG msg = { };
     while (GetMessage(&msg, NULL, 0, 0))
     {
+        win.OnWakeup(msg);
         TranslateMessage(&msg);
         DispatchMessage(&msg);
     }
 
-    return 0;
+    return win.IdleCheckFailed() || win.PaintCheckFailed() ? 1 : 0;
 }
 
 
 // 'MainWindow::HandleMessage' is used to implement the window procedure
 LRESULT MainWindow::HandleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
 {
+    PROFILE_ZONE("HandleMessage");
     wchar_t msg[32];
+    if (IsInputMessage(uMsg))
+    {
+        inputExport.Publish(uMsg, wParam, lParam, GetMessageTime());
+    }
+
     switch (uMsg)
     {
     case WM_CREATE:
-        if (FAILED(D2D1CreateFactory(
-            D2D1_FACTORY_TYPE_SINGLE_THREADED, &pFactory))) // create Direct2D factory object 
-            /*
-             - first param is the flag that specifies creation objects
-                - 'D2D1_FACTORY_TYPE_SINGLE_THREADED' flag means that you will not call Direct2D from multiple threads
-                - to support calls from multiple threads, specify 'D2D1_FACTORY_TYPE_MULTI_THREADED'
-             - second param, receives a pointer to the 'ID2D1Factory' interface
-            */
+        // without the warm-up thread ('/syncstartup') the factories are created here, on the startup path
+        if (!warmupStarted && FAILED(warmup.Take(&pFactory, &pWriteFactory, &pTextFormat)))
         {
             return -1;  // Fail CreateWindowEx.
         }
         DPIScale::Initialize(m_hwnd);
+        {
+            // the drag threshold and double-click time follow the system settings
+            RecognizerSettings settings = recognizer.Settings();
+            settings.slop = DPIScale::PixelsToDips(GetSystemMetrics(SM_CXDRAG), GetSystemMetrics(SM_CYDRAG)).x;
+            settings.doubleClickTime = GetDoubleClickTime();
+            recognizer.SetSettings(settings);
+
+            // the predictor looks one refresh interval ahead
+            HDC hdc = GetDC(m_hwnd);
+            const int refresh = GetDeviceCaps(hdc, VREFRESH);
+            ReleaseDC(m_hwnd, hdc);
+            if (refresh > 1)
+            {
+                frameInterval = 1000 / refresh;
+            }
+        }
+        pointerHistory = std::make_unique<MouseMovePointsHistory>(m_hwnd);
+
+        // the journal of the previous session holds whatever was drawn when it ended, cleanly or not;
+        // the paint check draws a stress scene instead, and a '/startup' run starts empty, leaving the journal alone
+        if (paintCheckFrames > 0)
+        {
+            AddStressShapes(100000, 1.0f, 8.0f, 0);
+        }
+        else if (firstFrameResult.empty() && document.Recover(autosaver.Path()))
+        {
+            wchar_t msg[96];
+            swprintf_s(msg, L"autosave: recovered %zu operations\n", document.OperationCount());
+            OutputDebugString(msg);
+        }
+        StartupTimeline::Mark(L"WM_CREATE handled");
+
+        // the autosave timer is armed by the first paint if there is something to save; no timer runs otherwise
+        idle.Reset(GetTickCount());
+        if (idleCheckMs > 0)
+        {
+            SetTimer(m_hwnd, IDT_IDLECHECK, idleCheckMs, NULL);
+        }
         return 0;
     
     case WM_LBUTTONDOWN:
@@ -292,16 +1443,50 @@ LRESULT MainWindow::HandleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
         return 0;
 
     case WM_LBUTTONUP:
-        OnLButtonUp();
+        OnLButtonUp(GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam), (DWORD)wParam);
         return 0;
 
     case WM_MOUSEMOVE:
         OnMouseMove(GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam), (DWORD)wParam);
         return 0;
+
+    case WM_MBUTTONDOWN:
+        // the middle button drags the view
+        panning = true;
+        panFrom = DPIScale::PixelsToDips(GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam));
+        SetCapture(m_hwnd);
+        return 0;
+
+    case WM_MBUTTONUP:
+        if (panning)
+        {
+            panning = false;
+            ReleaseCapture();
+        }
+        return 0;
+
+    case WM_MOUSEWHEEL:
+        OnMouseWheel(GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam), GET_WHEEL_DELTA_WPARAM(wParam));
+        return 0;
+
+    case WM_POINTERDOWN:
+    case WM_POINTERUPDATE:
+    case WM_POINTERUP:
+    case WM_POINTERCAPTURECHANGED:
+        if (OnPointer(uMsg, wParam, lParam))
+        {
+            return 0;
+        }
+        break;
     
     case WM_DESTROY:
+        // the last changes go to the journal too; the autosaver finishes writing before the window object is gone
+        KillTimer(m_hwnd, IDT_AUTOSAVE);
+        Autosave();
         DiscardGraphicsResources();
         SafeRelease(&pFactory);
+        SafeRelease(&pTextFormat);
+        SafeRelease(&pWriteFactory);
         PostQuitMessage(0);
         return 0;
 
@@ -309,10 +1494,19 @@ LRESULT MainWindow::HandleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
         OnPaint();
         return 0;
 
+    case WM_TIMER:
+        OnTimer(wParam);
+        return 0;
+
     case WM_SIZE:
         Resize();
         return 0;
 
+    case WM_KILLFOCUS:
+        // key-up messages for keys released in another window never reach this one
+        keys.Clear();
+        break;
+
     case WM_SYSKEYDOWN:
         /*
          - indicates a system key, which is a key stroke that invokes a system command
@@ -321,6 +1515,7 @@ LRESULT MainWindow::HandleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
             - F10 -> activates the menu bar of the window 
          - if WM_SYSKEYDOWN message is intercepted, call DefWindowProc afterward 
         */
+        keys.OnKeyMessage(uMsg, wParam, lParam);
         swprintf_s(msg, L"WM_SYSKEYDOWN: 0x%x\n", wParam);
         OutputDebugString(msg);
         break;
@@ -336,6 +1531,7 @@ LRESULT MainWindow::HandleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
         break;
 
     case WM_SYSKEYUP: // key release
+        keys.OnKeyMessage(uMsg, wParam, lParam);
         swprintf_s(msg, L"WM_SYSKEYUP: 0x%x\n", wParam);
         OutputDebugString(msg);
         break;
@@ -344,11 +1540,119 @@ LRESULT MainWindow::HandleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
         /*
          - could implement keyboard shortcuts by handling individual WM_KEYDOWN messages, but accelerator tables provide a better solution
         */
+        if (keys.OnKeyMessage(uMsg, wParam, lParam).wasDown)
+        {
+            // auto-repeat: only the caret keys repeat, the toggles below react to the first press
+            if (OnEditKey(wParam))
+            {
+                return 0;
+            }
+        }
+        else if (wParam == VK_DELETE && tool == Tool::Select && selected >= 0)
+        {
+            // with a shape selected, Delete removes the shape instead of editing the text;
+            // a move still in progress would resize the removed shape, which brings it back
+            CancelGesture();
+            document.Delete(selected);
+            selected = hovered = -1;
+            InvalidateRect(m_hwnd, NULL, FALSE);
+        }
+        else if (OnEditKey(wParam))
+        {
+            return 0;
+        }
+        else if (wParam == VK_F1 || wParam == VK_F2)
+        {
+            tool = (wParam == VK_F1) ? Tool::Draw : Tool::Select;
+            selected = -1;
+            InvalidateRect(m_hwnd, NULL, FALSE);
+        }
+        else if (wParam == VK_F3)
+        {
+            softwareRendering = !softwareRendering;
+            InvalidateRect(m_hwnd, NULL, FALSE);
+        }
+        else if (keys.IsChordHeld(SaveChord))
+        {
+            // Ctrl+S saves the drawing so it can be exported later, and its history so it can be reopened
+            SaveScene(L"drawing.scene", scene);
+            document.Save(L"drawing.history");
+        }
+        else if (keys.IsChordHeld(OpenChord))
+        {
+            OpenDocument();
+        }
+#ifdef PROFILE_ZONES
+        else if (keys.IsChordHeld(ProfileChord))
+        {
+            Profiler::WriteChromeTrace(L"profile.json");
+        }
+#endif
+        else if (wParam == VK_F5)
+        {
+            Recolor();
+        }
+        else if (wParam == VK_PRIOR || wParam == VK_NEXT)
+        {
+            SeekHistory(wParam == VK_PRIOR ? -1 : 1);
+        }
+        else if (wParam == VK_F6)
+        {
+            if (keys.IsDown(VK_SHIFT))
+            {
+                AddStressShapes(1000000, 0.05f, 0.4f, 0);
+            }
+            else if (keys.IsDown(VK_CONTROL))
+            {
+                AddStressShapes(1000000, 1.0f, 8.0f, 25);
+            }
+            else
+            {
+                AddStressShapes(100000, 1.0f, 8.0f, 0);
+            }
+        }
+        else if (wParam == VK_F7)
+        {
+            // Shift+F7 switches the display list optimizer, F7 the way shapes are drawn
+            if (keys.IsDown(VK_SHIFT))
+            {
+                sceneList.SetOptimize(!sceneList.Optimize());
+            }
+            else
+            {
+                batchDrawing = !batchDrawing;
+            }
+            InvalidateRect(m_hwnd, NULL, FALSE);
+        }
+        else if (wParam == VK_F8)
+        {
+            levelOfDetail = !levelOfDetail;
+            InvalidateRect(m_hwnd, NULL, FALSE);
+        }
+        else if (wParam == VK_F9)
+        {
+            predictDrag = !predictDrag;
+        }
+        else if (wParam == VK_F11)
+        {
+            // only the software renderer has the frame in memory, so recording switches to it
+            if (recorder)
+            {
+                recorder.reset(); // finishes writing and logs what the capture cost
+            }
+            else
+            {
+                recorder = std::make_unique<FrameRecorder>(L"session.capture");
+                softwareRendering = true;
+                InvalidateRect(m_hwnd, NULL, FALSE);
+            }
+        }
         swprintf_s(msg, L"WM_KEYDOWN: 0x%x\n", wParam);
         OutputDebugString(msg);
         break;
 
     case WM_KEYUP: // key release
+        keys.OnKeyMessage(uMsg, wParam, lParam);
         swprintf_s(msg, L"WM_KEYUP: 0x%x\n", wParam);
         OutputDebugString(msg);
         break;
@@ -360,9 +1664,8 @@ LRESULT MainWindow::HandleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
          - data type id wchar_t
          - avoid using WM_CHAR to implement keyboard shortcuts
         */
-        swprintf_s(msg, L"WM_CHAR: %c\n", (wchar_t)wParam);
-        OutputDebugString(msg);
-        break;
+        OnChar((wchar_t)wParam);
+        return 0;
     }
     return DefWindowProc(m_hwnd, uMsg, wParam, lParam);
 }
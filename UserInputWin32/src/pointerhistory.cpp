@@ -0,0 +1,167 @@
+#include <windows.h>
+#include <d2d1.h>
+
+#include <chrono>
+#include <cmath>
+
+#include "pointerhistory.h"
+#include "predictor.h"
+
+namespace
+{
+    // display coordinates come back as 16-bit values: on a monitor left of or above the primary one they are negative
+    int DisplayCoordinate(int v)
+    {
+        return v > 32767 ? v - 65536 : v;
+    }
+}
+
+
+void MouseMovePointsHistory::Fetch(LONG x, LONG y, DWORD time, std::vector<HistorySample>& out)
+{
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    POINT screen = { x, y };
+    ClientToScreen(hwnd, &screen);
+
+    MOUSEMOVEPOINT in = {};
+    in.x = screen.x & 0xFFFF;
+    in.y = screen.y & 0xFFFF;
+    in.time = time;
+
+    // newest first, starting with the point of this message
+    MOUSEMOVEPOINT points[MouseHistoryPoints];
+    const int n = GetMouseMovePointsEx(sizeof(MOUSEMOVEPOINT), &in, points, MouseHistoryPoints, GMMP_USE_DISPLAY_POINTS);
+    if (n <= 0)
+    {
+        havePrevious = false; // not in the history (e.g. a synthesized move): start over from the next message
+        return;
+    }
+
+    // the points after the previous message's one are new
+    int end = 1;
+    if (havePrevious)
+    {
+        end = n;
+        for (int i = 1; i < n; i++)
+        {
+            if (points[i].x == previousX && points[i].y == previousY && points[i].time == previousTime)
+            {
+                end = i;
+                break;
+            }
+        }
+        if (end == n && n == MouseHistoryPoints)
+        {
+            stats.overflows++;
+        }
+    }
+
+    const size_t first = out.size();
+    for (int i = end - 1; i >= 1; i--)
+    {
+        POINT pt = { DisplayCoordinate(points[i].x), DisplayCoordinate(points[i].y) };
+        ScreenToClient(hwnd, &pt);
+        out.push_back(HistorySample{ pt.x, pt.y, points[i].time });
+    }
+
+    havePrevious = true;
+    previousX = points[0].x;
+    previousY = points[0].y;
+    previousTime = points[0].time;
+
+    stats.batches++;
+    stats.samples += out.size() - first;
+    stats.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+HistorySample SyntheticHistory::At(DWORD time)
+{
+    // one turn of a 300-pixel circle per second (about 1900 pixels/s), with a 40-pixel wobble at 7 turns per second
+    const double t = time / 1000.0;
+    const double a = 2 * 3.14159265358979 * t;
+    const double r = 300 + 40 * std::sin(7 * a);
+    return HistorySample{ static_cast<LONG>(std::lround(400 + r * std::cos(a))), static_cast<LONG>(std::lround(400 + r * std::sin(a))), time };
+}
+
+void SyntheticHistory::Fetch(LONG, LONG, DWORD time, std::vector<HistorySample>& out)
+{
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    const size_t first = out.size();
+    DWORD t = (previousTime / period + 1) * period;
+    if (havePrevious && t < time)
+    {
+        // every sample time strictly between the two messages, as far as the history reaches back: the message's own
+        // point takes one of the 'depth' kept, the rest go to the newest samples before it
+        const DWORD between = (time - 1 - t) / period + 1;
+        if (between > depth - 1)
+        {
+            t += (between - (depth - 1)) * period;
+            stats.overflows++;
+        }
+        for (; t < time; t += period)
+        {
+            out.push_back(At(t));
+        }
+    }
+    havePrevious = true;
+    previousTime = time;
+
+    stats.batches++;
+    stats.samples += out.size() - first;
+    stats.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+void MeasurePointerHistory(DWORD seconds, DWORD messageMs, DWORD sampleMs, PointerHistoryTimings& timings)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    auto point = [](const HistorySample& s) { return D2D1::Point2F(static_cast<float>(s.x), static_cast<float>(s.y)); };
+    auto distance = [](D2D1_POINT_2F a, D2D1_POINT_2F b) { return std::sqrt((a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y)); };
+
+    SyntheticHistory source(sampleMs);
+    PointerPredictor without, with;
+    std::vector<HistorySample> batch;
+    double feedSeconds = 0;
+    float sumWithout = 0, sumWith = 0;
+    size_t delivered = 0, messages = 0;
+
+    const DWORD end = seconds * 1000;
+    for (DWORD time = 0; time <= end; time += messageMs)
+    {
+        const HistorySample message = SyntheticHistory::At(time);
+        batch.clear();
+        source.Fetch(message.x, message.y, time, batch);
+
+        // both predictors look one message interval ahead, scored against where the path really is by then;
+        // only one of them sees what happened in between
+        const D2D1_POINT_2F ahead = point(SyntheticHistory::At(time + messageMs));
+        without.AddSample(point(message), time);
+        sumWithout += distance(without.Predict(time + messageMs), ahead);
+
+        const Clock::time_point start = Clock::now();
+        for (const HistorySample& s : batch)
+        {
+            with.AddSample(point(s), s.time);
+        }
+        with.AddSample(point(message), time);
+        feedSeconds += std::chrono::duration<double>(Clock::now() - start).count();
+        sumWith += distance(with.Predict(time + messageMs), ahead);
+
+        delivered += batch.size() + 1;
+        messages++;
+    }
+
+    const PointerHistoryStats& stats = source.Stats();
+    timings.samplesPerMessage = stats.SamplesPerBatch();
+    timings.fidelity = static_cast<double>(delivered) / (end / sampleMs + 1);
+    timings.fidelityWithout = static_cast<double>(messages) / (end / sampleMs + 1);
+    timings.overflowShare = stats.batches ? static_cast<double>(stats.overflows) / stats.batches : 0.0;
+    timings.fetchMicroseconds = stats.MicrosecondsPerBatch();
+    timings.feedMicroseconds = messages ? feedSeconds * 1e6 / messages : 0.0;
+    timings.errorWithout = messages ? sumWithout / messages : 0.0f;
+    timings.errorWith = messages ? sumWith / messages : 0.0f;
+}
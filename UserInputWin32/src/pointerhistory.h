@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/*
+ - Windows coalesces mouse moves: when the window is slow to read its queue, only the latest WM_MOUSEMOVE is kept,
+   so a fast drag sees a fraction of the positions the mouse reported
+ - a 'PointerHistory' recovers the positions in between: for each move message it returns the samples taken since
+   the previous one, oldest first, which the mouse handler passes along with the move as its coalesced events
+   (see 'PointerEvent::coalesced')
+ - 'MouseMovePointsHistory' reads them from the system's mouse history ('GetMouseMovePointsEx', the last 64 points);
+   'SyntheticHistory' makes them up along a known path at a fixed rate, needing no window or operating system support,
+   so the consumers and the fidelity measurement ('/pointerhistory') can run anywhere
+ - both keep only the last 'MouseHistoryPoints' points, the message's own included: a message arriving after a longer
+   stall gets the newest ones, and the batch counts as an overflow
+ - samples are in client pixels, with the message time clock (ms)
+*/
+
+// the points 'GetMouseMovePointsEx' keeps
+const int MouseHistoryPoints = 64;
+
+struct HistorySample
+{
+    LONG x, y;
+    DWORD time;
+};
+
+// totals over the batches fetched, for the fidelity and cost log
+struct PointerHistoryStats
+{
+    size_t batches = 0;
+    size_t samples = 0;   // recovered samples, not counting the messages' own positions
+    size_t overflows = 0; // batches that reached back past the history the source keeps, so samples were lost
+    double seconds = 0;
+
+    double SamplesPerBatch() const { return batches ? static_cast<double>(samples) / batches : 0.0; }
+    double MicrosecondsPerBatch() const { return batches ? seconds * 1e6 / batches : 0.0; }
+};
+
+
+class PointerHistory
+{
+public:
+    virtual ~PointerHistory() {}
+
+    // forgets the previous message: the next 'Fetch' returns nothing, it only marks where the following one starts
+    virtual void Reset() = 0;
+
+    // appends to 'out' the samples between the previous message and the one at (x, y, time), which is not included
+    virtual void Fetch(LONG x, LONG y, DWORD time, std::vector<HistorySample>& out) = 0;
+
+    const PointerHistoryStats& Stats() const { return stats; }
+    void ResetStats() { stats = PointerHistoryStats(); }
+
+protected:
+    PointerHistoryStats stats;
+};
+
+
+class MouseMovePointsHistory : public PointerHistory
+{
+    HWND hwnd;
+    bool havePrevious;
+    int previousX, previousY; // as 'GetMouseMovePointsEx' reported the previous message's point
+    DWORD previousTime;
+
+public:
+    explicit MouseMovePointsHistory(HWND window) : hwnd(window), havePrevious(false), previousX(0), previousY(0), previousTime(0) {}
+
+    void Reset() override { havePrevious = false; }
+    void Fetch(LONG x, LONG y, DWORD time, std::vector<HistorySample>& out) override;
+};
+
+
+// a pointer moving along a fixed curve (a circle with a wobble, about as fast as a quick drag), sampled every 'period' ms;
+// only the last 'depth' samples are kept, as the system keeps 'MouseHistoryPoints'
+class SyntheticHistory : public PointerHistory
+{
+    DWORD period;
+    DWORD depth;
+    bool havePrevious;
+    DWORD previousTime;
+
+public:
+    explicit SyntheticHistory(DWORD periodMs, DWORD keptPoints = MouseHistoryPoints)
+        : period(periodMs), depth(keptPoints), havePrevious(false), previousTime(0) {}
+
+    // where the pointer is at 'time'
+    static HistorySample At(DWORD time);
+
+    void Reset() override { havePrevious = false; }
+    void Fetch(LONG x, LONG y, DWORD time, std::vector<HistorySample>& out) override;
+};
+
+
+struct PointerHistoryTimings
+{
+    double samplesPerMessage; // recovered samples per move message
+    double fidelity;          // share of the source's samples that reached the consumer, with the history
+    double fidelityWithout;   // ... from the move messages alone
+    double overflowShare;     // share of the batches that lost samples beyond the history
+    double fetchMicroseconds; // per batch
+    double feedMicroseconds;  // per batch, feeding the samples to a predictor
+    float errorWithout;       // mean distance (pixels) from a prediction one message ahead to the path, from the messages alone
+    float errorWith;          // ... and with the recovered samples as well
+};
+
+// drags along the synthetic path for 'seconds', delivering a move message every 'messageMs' from a source
+// sampling every 'sampleMs'; the same messages are fed to a 'PointerPredictor' with and without the history
+void MeasurePointerHistory(DWORD seconds, DWORD messageMs, DWORD sampleMs, PointerHistoryTimings& timings);
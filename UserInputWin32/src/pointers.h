@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstddef>
+
+/*
+ - state of every pen/touch contact currently on the window, one ellipse per contact
+ - stored as a structure of arrays: the per-frame loop over all contacts reads a few dense float arrays,
+   which the compiler can vectorize, instead of striding over one struct per pointer
+ - contacts are kept packed; removing one moves the last contact into its slot
+*/
+
+class PointerContacts
+{
+public:
+    static const size_t MaxContacts = 64;
+
+private:
+    UINT32 ids[MaxContacts];
+    alignas(32) float anchorX[MaxContacts]; // contact-down position, one corner of the bounding box
+    alignas(32) float anchorY[MaxContacts];
+    alignas(32) float posX[MaxContacts];    // current position, the opposite corner
+    alignas(32) float posY[MaxContacts];
+    size_t count;
+
+public:
+    PointerContacts() : count(0) {}
+
+    size_t Count() const { return count; }
+
+    int Find(UINT32 id) const
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            if (ids[i] == id)
+            {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    // returns false when every slot is taken; the extra contact is then ignored
+    bool Add(UINT32 id, D2D1_POINT_2F pt)
+    {
+        int i = Find(id);
+        if (i < 0)
+        {
+            if (count == MaxContacts)
+            {
+                return false;
+            }
+            i = static_cast<int>(count++);
+            ids[i] = id;
+        }
+        anchorX[i] = posX[i] = pt.x;
+        anchorY[i] = posY[i] = pt.y;
+        return true;
+    }
+
+    bool Update(UINT32 id, D2D1_POINT_2F pt)
+    {
+        const int i = Find(id);
+        if (i < 0)
+        {
+            return false;
+        }
+        posX[i] = pt.x;
+        posY[i] = pt.y;
+        return true;
+    }
+
+    bool Remove(UINT32 id)
+    {
+        const int i = Find(id);
+        if (i < 0)
+        {
+            return false;
+        }
+        const size_t last = --count;
+        ids[i] = ids[last];
+        anchorX[i] = anchorX[last];
+        anchorY[i] = anchorY[last];
+        posX[i] = posX[last];
+        posY[i] = posY[last];
+        return true;
+    }
+
+    void Clear() { count = 0; }
+
+    /*
+     - what a WM_POINTERDOWN, WM_POINTERUPDATE (in contact) or WM_POINTERUP does to the contacts, at 'pt' in world DIPs;
+       shared by 'OnPointer' and the synthetic contacts of '/pointers'
+     - returns true when the message released a contact: 'released' then holds the ellipse it leaves behind
+    */
+    bool OnMessage(UINT uMsg, UINT32 id, D2D1_POINT_2F pt, D2D1_ELLIPSE& released)
+    {
+        switch (uMsg)
+        {
+        case WM_POINTERDOWN:
+            Add(id, pt);
+            break;
+
+        case WM_POINTERUPDATE:
+            Update(id, pt);
+            break;
+
+        case WM_POINTERUP:
+            if (Update(id, pt))
+            {
+                released = Ellipse(Find(id));
+                Remove(id);
+                return true;
+            }
+            break;
+        }
+        return false;
+    }
+
+    // ellipse of the contact at index 'i', same construction as the mouse drag
+    D2D1_ELLIPSE Ellipse(size_t i) const
+    {
+        const float width = (posX[i] - anchorX[i]) / 2;
+        const float height = (posY[i] - anchorY[i]) / 2;
+        return D2D1::Ellipse(D2D1::Point2F(anchorX[i] + width, anchorY[i] + height), width, height);
+    }
+
+    // ellipses for every contact, written as arrays; each array must hold 'Count()' entries
+    void Ellipses(float* centerX, float* centerY, float* radiusX, float* radiusY) const
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            radiusX[i] = (posX[i] - anchorX[i]) * 0.5f;
+            radiusY[i] = (posY[i] - anchorY[i]) * 0.5f;
+            centerX[i] = anchorX[i] + radiusX[i];
+            centerY[i] = anchorY[i] + radiusY[i];
+        }
+    }
+};
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cmath>
+
+/*
+ - extrapolates the pointer to the time the next frame reaches the screen, so a drag does not trail the cursor by a frame
+ - alpha-beta filter (a steady-state Kalman filter with a constant-velocity model) per axis:
+    - predict: x' = x + v * dt
+    - correct: x = x' + alpha * residual,  v = v + (beta / dt) * residual
+ - every real sample corrects the estimate, so a wrong prediction only lives until the next WM_MOUSEMOVE
+ - the prediction made for each sample is compared with the real position of the next one, to report
+   how much error the predictor trades for the latency it hides; '/predict' measures the same trade on a recorded
+   trace, for several look-aheads at once
+*/
+
+struct PredictionStats
+{
+    int samples = 0;
+    float sumError = 0; // DIPs
+    float maxError = 0;
+    float sumLead = 0;  // ms the rendered position was ahead of the last real sample
+
+    float MeanError() const { return samples ? sumError / samples : 0; }
+    float MeanLead() const { return samples ? sumLead / samples : 0; }
+};
+
+
+class PointerPredictor
+{
+    float alpha, beta;
+    float maxLead;   // ms, never extrapolate further than this
+    float maxSpeed;  // DIPs per ms, clamps the velocity after a jump
+
+    bool primed;
+    DWORD lastTime;
+    D2D1_POINT_2F pos, vel; // filtered position (DIPs) and velocity (DIPs per ms)
+    D2D1_POINT_2F lastReal; // unfiltered position of the last sample
+    D2D1_POINT_2F lastPrediction;
+    DWORD lastPredictionTime;
+    bool havePrediction;
+
+    PredictionStats stats;
+
+    float ClampSpeed(float v) const { return v > maxSpeed ? maxSpeed : (v < -maxSpeed ? -maxSpeed : v); }
+
+public:
+    PointerPredictor(float a = 0.5f, float b = 0.2f, float lead = 50.0f, float speed = 20.0f) :
+        alpha(a), beta(b), maxLead(lead), maxSpeed(speed), primed(false), lastTime(0),
+        pos(D2D1::Point2F()), vel(D2D1::Point2F()), lastReal(D2D1::Point2F()), lastPrediction(D2D1::Point2F()),
+        lastPredictionTime(0), havePrediction(false) {}
+
+    // start a new stroke; the filter restarts from rest at 'pt'
+    void Reset(D2D1_POINT_2F pt, DWORD time)
+    {
+        primed = true;
+        lastTime = time;
+        pos = lastReal = pt;
+        vel = D2D1::Point2F();
+        havePrediction = false;
+    }
+
+    // fold a real sample into the estimate
+    void AddSample(D2D1_POINT_2F pt, DWORD time)
+    {
+        if (!primed)
+        {
+            Reset(pt, time);
+            return;
+        }
+
+        if (havePrediction)
+        {
+            // the real position at the predicted instant, interpolated between the two real samples around it
+            const float span = static_cast<float>(static_cast<LONG>(time - lastTime));
+            const float lead = static_cast<float>(static_cast<LONG>(lastPredictionTime - lastTime));
+            const float t = (span > 0 && lead < span) ? lead / span : 1.0f;
+            const float ex = lastPrediction.x - (lastReal.x + (pt.x - lastReal.x) * t);
+            const float ey = lastPrediction.y - (lastReal.y + (pt.y - lastReal.y) * t);
+            const float error = std::sqrt(ex * ex + ey * ey);
+
+            stats.samples++;
+            stats.sumError += error;
+            stats.sumLead += lead;
+            if (error > stats.maxError)
+            {
+                stats.maxError = error;
+            }
+            havePrediction = false;
+        }
+        lastReal = pt;
+
+        const float dt = static_cast<float>(static_cast<LONG>(time - lastTime));
+        if (dt <= 0)
+        {
+            // several samples with the same timestamp: only track the position
+            pos = pt;
+            return;
+        }
+
+        const float px = pos.x + vel.x * dt;
+        const float py = pos.y + vel.y * dt;
+        const float rx = pt.x - px;
+        const float ry = pt.y - py;
+
+        pos = D2D1::Point2F(px + alpha * rx, py + alpha * ry);
+        vel = D2D1::Point2F(ClampSpeed(vel.x + beta / dt * rx), ClampSpeed(vel.y + beta / dt * ry));
+        lastTime = time;
+    }
+
+    // extrapolated position at 'presentTime' (ms, same clock as the samples)
+    D2D1_POINT_2F Predict(DWORD presentTime)
+    {
+        float lead = static_cast<float>(static_cast<LONG>(presentTime - lastTime));
+        lead = lead < 0 ? 0 : (lead > maxLead ? maxLead : lead);
+
+        lastPrediction = D2D1::Point2F(pos.x + vel.x * lead, pos.y + vel.y * lead);
+        lastPredictionTime = lastTime + static_cast<DWORD>(lead);
+        havePrediction = true;
+        return lastPrediction;
+    }
+
+    const PredictionStats& Stats() const { return stats; }
+    void ResetStats() { stats = PredictionStats(); }
+};
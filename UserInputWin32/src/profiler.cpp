@@ -0,0 +1,119 @@
+#include <windows.h>
+
+#include "profiler.h"
+
+#ifdef PROFILE_ZONES
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdio.h>
+#include <vector>
+
+namespace
+{
+    // every buffer ever registered, and the time stamp counter and performance counter read together at the first one,
+    // to convert counter ticks to microseconds when the trace is written (the first zone began just before, hence signed)
+    std::mutex lock;
+    std::vector<std::unique_ptr<ProfileBuffer>> buffers;
+    uint64_t baseTsc;
+    LONGLONG baseQpc;
+
+    // an event as read out of a ring
+    struct Copy
+    {
+        const char* name;
+        uint64_t begin, end;
+    };
+}
+
+ProfileBuffer* Profiler::RegisterThread()
+{
+    std::unique_ptr<ProfileBuffer> b = std::make_unique<ProfileBuffer>();
+    b->count.store(0, std::memory_order_relaxed);
+    b->written = 0;
+    b->threadId = GetCurrentThreadId();
+    buffer = b.get();
+
+    std::lock_guard<std::mutex> guard(lock);
+    if (buffers.empty())
+    {
+        LARGE_INTEGER qpc;
+        QueryPerformanceCounter(&qpc);
+        baseQpc = qpc.QuadPart;
+        baseTsc = __rdtsc();
+    }
+    buffers.push_back(std::move(b));
+    return buffer;
+}
+
+bool Profiler::WriteChromeTrace(const std::filesystem::path& path)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (buffers.empty())
+    {
+        return false;
+    }
+
+    // counter ticks per microsecond, measured over the whole time the profiler has run
+    LARGE_INTEGER qpc, frequency;
+    QueryPerformanceCounter(&qpc);
+    QueryPerformanceFrequency(&frequency);
+    const uint64_t tsc = __rdtsc();
+    const double us = (qpc.QuadPart - baseQpc) * 1e6 / frequency.QuadPart;
+    const double ticksPerUs = us > 0 ? (tsc - baseTsc) / us : 1.0;
+
+    std::ofstream file(path, std::ios::trunc);
+    if (!file)
+    {
+        return false;
+    }
+
+    // complete ("X") events, one per zone; nested zones show as a stack in the viewer
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    char line[256];
+    bool first = true;
+    size_t events = 0, dropped = 0;
+    std::vector<Copy> copies;
+    for (const std::unique_ptr<ProfileBuffer>& b : buffers)
+    {
+        // the events since the last trace that the ring still holds
+        const uint64_t count = b->count.load(std::memory_order_acquire);
+        uint64_t from = std::max(b->written, count > ProfileBuffer::Capacity ? count - ProfileBuffer::Capacity : 0);
+        copies.clear();
+        for (uint64_t i = from; i < count; i++)
+        {
+            const ProfileEvent& e = b->events[i & (ProfileBuffer::Capacity - 1)];
+            copies.push_back(Copy{ e.name.load(std::memory_order_relaxed), e.begin.load(std::memory_order_relaxed),
+                e.end.load(std::memory_order_relaxed) });
+        }
+
+        // whatever the owner recorded meanwhile, and the event it may be writing now, may have overwritten the oldest copies
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t now = b->count.load(std::memory_order_relaxed);
+        const uint64_t torn = now + 1 > ProfileBuffer::Capacity ? std::min(count, now + 1 - ProfileBuffer::Capacity) : 0;
+        const size_t skip = torn > from ? static_cast<size_t>(torn - from) : 0;
+        dropped += static_cast<size_t>(from + skip - b->written);
+        b->written = count;
+
+        for (size_t i = skip; i < copies.size(); i++)
+        {
+            const Copy& e = copies[i];
+            snprintf(line, sizeof(line), "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%lu,\"ts\":%.3f,\"dur\":%.3f}",
+                first ? "" : ",\n", e.name, static_cast<unsigned long>(b->threadId),
+                static_cast<int64_t>(e.begin - baseTsc) / ticksPerUs, (e.end - e.begin) / ticksPerUs);
+            file << line;
+            first = false;
+        }
+        events += copies.size() - skip;
+    }
+    file << "\n]}\n";
+
+    wchar_t msg[128];
+    swprintf_s(msg, L"profiler: %zu zones from %zu threads written, %zu overwritten before this trace\n", events, buffers.size(), dropped);
+    OutputDebugString(msg);
+    return static_cast<bool>(file);
+}
+
+#endif
@@ -0,0 +1,87 @@
+#pragma once
+
+/*
+ - scoped profiling zones: 'PROFILE_ZONE("OnPaint")' at the top of a block times the rest of the block
+ - compiled in only when PROFILE_ZONES is defined (add it to the preprocessor definitions of the project);
+   otherwise the macro expands to nothing and no profiler code is built at all
+ - a zone reads the time stamp counter when it opens and when it closes, and appends one event to a buffer owned by
+   its thread: no lock, no allocation, no system call; names are string literals, so only their pointers are stored
+ - each thread's buffer is registered once, the first time the thread opens a zone, and kept after the thread ends
+ - a buffer is a ring of the newest events, so profiling can stay on for a whole session; 'Profiler::WriteChromeTrace'
+   writes the events recorded since the last trace as Chrome trace-event JSON (load it in chrome://tracing or
+   https://ui.perfetto.dev), and counts those the ring overwrote before they could be written as dropped
+ - the owning thread may overwrite an event while the trace copies it; the copy is checked against the count afterwards
+   and thrown away if it might be torn, as in a seqlock, so the event fields are relaxed atomics
+ - what a zone costs on the machine at hand: UserInputWin32.exe /profile <zones>
+*/
+
+#ifdef PROFILE_ZONES
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <intrin.h>
+
+struct ProfileEvent
+{
+    std::atomic<const char*> name;
+    std::atomic<uint64_t> begin, end; // time stamp counter
+};
+
+struct ProfileBuffer
+{
+    static const size_t Capacity = 1 << 16; // a power of two
+
+    std::atomic<uint64_t> count; // events recorded so far; event 'i' is in 'events[i % Capacity]'; only the owner writes
+    uint64_t written;            // events up to here went into a trace already; guarded by the profiler's lock
+    DWORD threadId;
+    ProfileEvent events[Capacity];
+};
+
+class Profiler
+{
+    static inline thread_local ProfileBuffer* buffer = NULL; // defined here so every zone reads it directly
+
+    static ProfileBuffer* RegisterThread();
+
+public:
+    static void Record(const char* name, uint64_t begin, uint64_t end)
+    {
+        ProfileBuffer* b = buffer != NULL ? buffer : RegisterThread();
+        const uint64_t n = b->count.load(std::memory_order_relaxed);
+        ProfileEvent& e = b->events[n & (ProfileBuffer::Capacity - 1)];
+        std::atomic_thread_fence(std::memory_order_release); // a trace that sees this overwrite also sees 'count' reach 'n'
+        e.name.store(name, std::memory_order_relaxed);
+        e.begin.store(begin, std::memory_order_relaxed);
+        e.end.store(end, std::memory_order_relaxed);
+        b->count.store(n + 1, std::memory_order_release); // publishes the event to 'WriteChromeTrace'
+    }
+
+    // may run while other threads are still recording; their events up to now are written, and the next trace
+    // starts after them
+    static bool WriteChromeTrace(const std::filesystem::path& path);
+};
+
+class ProfileZone
+{
+    const char* name;
+    uint64_t begin;
+
+public:
+    explicit ProfileZone(const char* zoneName) : name(zoneName), begin(__rdtsc()) {}
+    ~ProfileZone() { Profiler::Record(name, begin, __rdtsc()); }
+
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)("" name "")
+
+#else
+
+#define PROFILE_ZONE(name)
+
+#endif
@@ -0,0 +1,198 @@
+#include "qoi.h"
+
+namespace
+{
+    const uint8_t OpIndex = 0x00;
+    const uint8_t OpDiff = 0x40;
+    const uint8_t OpLuma = 0x80;
+    const uint8_t OpRun = 0xc0;
+    const uint8_t OpRgb = 0xfe;
+    const uint8_t OpRgba = 0xff;
+
+    struct Rgba { uint8_t r, g, b, a; };
+
+    inline bool operator==(Rgba x, Rgba y) { return x.r == y.r && x.g == y.g && x.b == y.b && x.a == y.a; }
+
+    inline unsigned Hash(Rgba c) { return (c.r * 3 + c.g * 5 + c.b * 7 + c.a * 11) % 64; }
+
+    inline void PutBigEndian(std::vector<uint8_t>& out, uint32_t v)
+    {
+        out.push_back(static_cast<uint8_t>(v >> 24));
+        out.push_back(static_cast<uint8_t>(v >> 16));
+        out.push_back(static_cast<uint8_t>(v >> 8));
+        out.push_back(static_cast<uint8_t>(v));
+    }
+}
+
+
+void EncodeQoi(const uint32_t* pixels, uint32_t width, uint32_t height, uint32_t stride, std::vector<uint8_t>& out)
+{
+    // worst case is 5 bytes per pixel, plus the 14-byte header and the 8-byte end marker
+    out.reserve(out.size() + static_cast<size_t>(width) * height * 5 + 22);
+
+    out.push_back('q'); out.push_back('o'); out.push_back('i'); out.push_back('f');
+    PutBigEndian(out, width);
+    PutBigEndian(out, height);
+    out.push_back(4); // channels: RGBA
+    out.push_back(0); // colorspace: sRGB with linear alpha
+
+    Rgba index[64] = {};
+    Rgba prev = { 0, 0, 0, 255 };
+    unsigned run = 0;
+
+    for (uint32_t y = 0; y < height; y++)
+    {
+        const uint32_t* row = reinterpret_cast<const uint32_t*>(reinterpret_cast<const uint8_t*>(pixels) + static_cast<size_t>(y) * stride);
+        for (uint32_t x = 0; x < width; x++)
+        {
+            const uint32_t bgra = row[x];
+            const Rgba px = { static_cast<uint8_t>(bgra >> 16), static_cast<uint8_t>(bgra >> 8),
+                              static_cast<uint8_t>(bgra), static_cast<uint8_t>(bgra >> 24) };
+
+            if (px == prev)
+            {
+                if (++run == 62)
+                {
+                    out.push_back(static_cast<uint8_t>(OpRun | (run - 1)));
+                    run = 0;
+                }
+                continue;
+            }
+
+            if (run > 0)
+            {
+                out.push_back(static_cast<uint8_t>(OpRun | (run - 1)));
+                run = 0;
+            }
+
+            const unsigned slot = Hash(px);
+            if (index[slot] == px)
+            {
+                out.push_back(static_cast<uint8_t>(OpIndex | slot));
+            }
+            else
+            {
+                index[slot] = px;
+
+                if (px.a == prev.a)
+                {
+                    const int dr = static_cast<int8_t>(px.r - prev.r);
+                    const int dg = static_cast<int8_t>(px.g - prev.g);
+                    const int db = static_cast<int8_t>(px.b - prev.b);
+                    const int drg = dr - dg;
+                    const int dbg = db - dg;
+
+                    if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+                    {
+                        out.push_back(static_cast<uint8_t>(OpDiff | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2)));
+                    }
+                    else if (dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 && dbg >= -8 && dbg <= 7)
+                    {
+                        out.push_back(static_cast<uint8_t>(OpLuma | (dg + 32)));
+                        out.push_back(static_cast<uint8_t>((drg + 8) << 4 | (dbg + 8)));
+                    }
+                    else
+                    {
+                        out.push_back(OpRgb);
+                        out.push_back(px.r); out.push_back(px.g); out.push_back(px.b);
+                    }
+                }
+                else
+                {
+                    out.push_back(OpRgba);
+                    out.push_back(px.r); out.push_back(px.g); out.push_back(px.b); out.push_back(px.a);
+                }
+            }
+            prev = px;
+        }
+    }
+
+    if (run > 0)
+    {
+        out.push_back(static_cast<uint8_t>(OpRun | (run - 1)));
+    }
+
+    static const uint8_t end[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+    out.insert(out.end(), end, end + sizeof(end));
+}
+
+bool DecodeQoi(const uint8_t* data, size_t size, uint32_t width, uint32_t height, uint32_t* pixels, uint32_t stride)
+{
+    auto bigEndian = [data](size_t at)
+    {
+        return static_cast<uint32_t>(data[at]) << 24 | static_cast<uint32_t>(data[at + 1]) << 16 |
+               static_cast<uint32_t>(data[at + 2]) << 8 | data[at + 3];
+    };
+    if (size < 22 || data[0] != 'q' || data[1] != 'o' || data[2] != 'i' || data[3] != 'f' ||
+        bigEndian(4) != width || bigEndian(8) != height)
+    {
+        return false;
+    }
+
+    Rgba index[64] = {};
+    Rgba px = { 0, 0, 0, 255 };
+    unsigned run = 0;
+    size_t at = 14;
+    const size_t end = size - 8; // the end marker
+
+    for (uint32_t y = 0; y < height; y++)
+    {
+        uint32_t* row = reinterpret_cast<uint32_t*>(reinterpret_cast<uint8_t*>(pixels) + static_cast<size_t>(y) * stride);
+        for (uint32_t x = 0; x < width; x++)
+        {
+            if (run > 0)
+            {
+                run--;
+            }
+            else
+            {
+                if (at >= end)
+                {
+                    return false;
+                }
+                const uint8_t op = data[at++];
+                if (op == OpRgb || op == OpRgba)
+                {
+                    if (at + (op == OpRgba ? 4 : 3) > end)
+                    {
+                        return false;
+                    }
+                    px.r = data[at++]; px.g = data[at++]; px.b = data[at++];
+                    if (op == OpRgba)
+                    {
+                        px.a = data[at++];
+                    }
+                }
+                else if ((op & 0xc0) == OpIndex)
+                {
+                    px = index[op];
+                }
+                else if ((op & 0xc0) == OpDiff)
+                {
+                    px.r += ((op >> 4) & 3) - 2;
+                    px.g += ((op >> 2) & 3) - 2;
+                    px.b += (op & 3) - 2;
+                }
+                else if ((op & 0xc0) == OpLuma)
+                {
+                    if (at >= end)
+                    {
+                        return false;
+                    }
+                    const int dg = (op & 0x3f) - 32;
+                    const uint8_t rb = data[at++];
+                    px.r += dg - 8 + (rb >> 4);
+                    px.g += dg;
+                    px.b += dg - 8 + (rb & 0x0f);
+                }
+                else
+                {
+                    run = op & 0x3f; // this pixel and 'run' more repeat the previous one
+                }
+                index[Hash(px)] = px;
+            }
+            row[x] = static_cast<uint32_t>(px.a) << 24 | static_cast<uint32_t>(px.r) << 16 | static_cast<uint32_t>(px.g) << 8 | px.b;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ - encoder for the "Quite OK Image" format (https://qoiformat.org), a lossless format that is
+   several times faster to write than PNG and still compresses flat drawings well
+ - input is 32-bit BGRA (the layout the software renderer produces), 'stride' in bytes
+ - the encoded file is appended to 'out'
+ - the decoder reads what the encoder writes (4-channel images) back into the same BGRA layout
+*/
+
+void EncodeQoi(const uint32_t* pixels, uint32_t width, uint32_t height, uint32_t stride, std::vector<uint8_t>& out);
+
+// decodes into 'pixels' at 'stride' bytes per row, which must have room for the image; false if the data is not a QOI image
+// of exactly 'width' x 'height' pixels
+bool DecodeQoi(const uint8_t* data, size_t size, uint32_t width, uint32_t height, uint32_t* pixels, uint32_t stride);
@@ -0,0 +1,272 @@
+#pragma once
+
+#include <cstddef>
+#include <tuple>
+
+#include "gesture.h"
+
+/*
+ - recognizes click, double-click, drag, flick and long-press from the raw pointer samples
+ - the last samples are kept in a fixed-size ring buffer, so feeding a sample never allocates
+ - every recognizer is a small struct with an 'Update' method; the engine holds them in a tuple and
+   calls each one for every sample, with no virtual calls and no heap
+ - timestamps are passed in by the caller (GetMessageTime), so the same trace always produces the same gestures
+*/
+
+struct PointerSample
+{
+    PointerEventType type;
+    D2D1_POINT_2F pt; // DIPs
+    DWORD time;       // milliseconds
+};
+
+
+template <class T, size_t N>
+class RingBuffer
+{
+    T items[N];
+    size_t head;  // index of the next slot to write
+    size_t count;
+
+public:
+    RingBuffer() : items(), head(0), count(0) {}
+
+    void Push(const T& item)
+    {
+        items[head] = item;
+        head = (head + 1) % N;
+        if (count < N)
+        {
+            count++;
+        }
+    }
+
+    void Clear() { head = count = 0; }
+    size_t Size() const { return count; }
+    bool Empty() const { return count == 0; }
+
+    // 0 is the newest item, Size() - 1 the oldest one still kept
+    const T& operator[](size_t age) const { return items[(head + N - 1 - age) % N]; }
+};
+
+
+enum class GestureKind { Click, DoubleClick, Drag, Flick, LongPress };
+
+struct RecognizedGesture
+{
+    GestureKind kind;
+    D2D1_POINT_2F pt;
+    D2D1_POINT_2F velocity; // DIPs per second
+};
+
+struct RecognizerSettings
+{
+    float slop;            // DIPs the pointer may wander before a press turns into a drag
+    DWORD doubleClickTime; // ms between two clicks of a double-click
+    DWORD longPressTime;   // ms the pointer must stay down and still for a long-press
+    float flickSpeed;      // DIPs per second at release that turn a drag into a flick
+    DWORD velocityWindow;  // ms of history used for the velocity estimate
+};
+
+typedef RingBuffer<PointerSample, 64> SampleHistory;
+
+
+// least-squares slope of position over time for the samples in the last 'window' ms
+inline D2D1_POINT_2F EstimateVelocity(const SampleHistory& history, DWORD window)
+{
+    if (history.Size() < 2)
+    {
+        return D2D1::Point2F();
+    }
+
+    const DWORD newest = history[0].time;
+    float st = 0, sx = 0, sy = 0, stt = 0, stx = 0, sty = 0;
+    int n = 0;
+
+    for (size_t i = 0; i < history.Size(); i++)
+    {
+        const PointerSample& s = history[i];
+        if (newest - s.time > window)
+        {
+            break;
+        }
+        const float t = -static_cast<float>(newest - s.time) / 1000.0f; // seconds, relative to the newest sample
+        st += t; sx += s.pt.x; sy += s.pt.y;
+        stt += t * t; stx += t * s.pt.x; sty += t * s.pt.y;
+        n++;
+    }
+
+    const float denom = n * stt - st * st;
+    if (n < 2 || denom <= 1e-9f)
+    {
+        return D2D1::Point2F();
+    }
+    return D2D1::Point2F((n * stx - st * sx) / denom, (n * sty - st * sy) / denom);
+}
+
+
+// state shared by the recognizers: where and when the current press started
+struct PressState
+{
+    bool down = false;
+    bool moved = false; // left the slop region since the press started
+    bool held = false;  // reported as a long-press, so its release is not a click
+    PointerSample start = {};
+};
+
+inline float DistanceSquared(D2D1_POINT_2F a, D2D1_POINT_2F b)
+{
+    const float dx = a.x - b.x, dy = a.y - b.y;
+    return dx * dx + dy * dy;
+}
+
+
+struct ClickRecognizer
+{
+    // a click is reported for the first release; a second release close enough in time and space becomes a double-click
+    bool havePrevious = false;
+    PointerSample previous = {};
+
+    template <class Emit>
+    void Update(const RecognizerSettings& settings, const PressState& press, const SampleHistory&, const PointerSample& s, Emit& emit)
+    {
+        if (s.type != PointerEventType::Up || press.moved || press.held)
+        {
+            return;
+        }
+
+        if (havePrevious && s.time - previous.time <= settings.doubleClickTime &&
+            DistanceSquared(s.pt, previous.pt) <= settings.slop * settings.slop)
+        {
+            emit({ GestureKind::DoubleClick, s.pt, D2D1::Point2F() });
+            havePrevious = false; // a third click starts a new sequence
+        }
+        else
+        {
+            emit({ GestureKind::Click, s.pt, D2D1::Point2F() });
+            havePrevious = true;
+            previous = s;
+        }
+    }
+};
+
+
+struct DragRecognizer
+{
+    bool reported = false;
+
+    template <class Emit>
+    void Update(const RecognizerSettings& settings, const PressState& press, const SampleHistory& history, const PointerSample& s, Emit& emit)
+    {
+        if (s.type == PointerEventType::Down)
+        {
+            reported = false;
+        }
+
+        // reported once per press, on the sample that leaves the slop region
+        if (!reported && s.type == PointerEventType::Move && press.down && press.moved)
+        {
+            reported = true;
+            emit({ GestureKind::Drag, press.start.pt, EstimateVelocity(history, settings.velocityWindow) });
+        }
+    }
+};
+
+
+struct FlickRecognizer
+{
+    template <class Emit>
+    void Update(const RecognizerSettings& settings, const PressState& press, const SampleHistory& history, const PointerSample& s, Emit& emit)
+    {
+        if (s.type != PointerEventType::Up || !press.moved)
+        {
+            return;
+        }
+
+        const D2D1_POINT_2F v = EstimateVelocity(history, settings.velocityWindow);
+        if (v.x * v.x + v.y * v.y >= settings.flickSpeed * settings.flickSpeed)
+        {
+            emit({ GestureKind::Flick, s.pt, v });
+        }
+    }
+};
+
+
+struct LongPressRecognizer
+{
+    bool fired = false;
+
+    template <class Emit>
+    void Update(const RecognizerSettings& settings, const PressState& press, const SampleHistory&, const PointerSample& s, Emit& emit)
+    {
+        if (s.type == PointerEventType::Down)
+        {
+            fired = false;
+        }
+        Check(settings, press, s.time, emit);
+    }
+
+    // also called from a timer, because a pointer held perfectly still produces no samples
+    template <class Emit>
+    void Check(const RecognizerSettings& settings, const PressState& press, DWORD now, Emit& emit)
+    {
+        if (!fired && press.down && !press.moved && now - press.start.time >= settings.longPressTime)
+        {
+            fired = true;
+            emit({ GestureKind::LongPress, press.start.pt, D2D1::Point2F() });
+        }
+    }
+};
+
+
+class GestureRecognizer
+{
+    RecognizerSettings settings;
+    SampleHistory history;
+    PressState press;
+    std::tuple<ClickRecognizer, DragRecognizer, FlickRecognizer, LongPressRecognizer> recognizers;
+
+public:
+    explicit GestureRecognizer(const RecognizerSettings& s) : settings(s) {}
+
+    const RecognizerSettings& Settings() const { return settings; }
+    void SetSettings(const RecognizerSettings& s) { settings = s; }
+    const SampleHistory& History() const { return history; }
+    bool Pressed() const { return press.down; }
+
+    // 'emit' is called with a 'RecognizedGesture' for every gesture completed by this sample
+    template <class Emit>
+    void AddSample(const PointerSample& s, Emit&& emit)
+    {
+        if (s.type == PointerEventType::Down)
+        {
+            history.Clear();
+            press.down = true;
+            press.moved = false;
+            press.held = false;
+            press.start = s;
+        }
+        else if (press.down && DistanceSquared(s.pt, press.start.pt) > settings.slop * settings.slop)
+        {
+            press.moved = true;
+        }
+
+        history.Push(s);
+
+        auto noteHeld = [&](const RecognizedGesture& g) { press.held |= g.kind == GestureKind::LongPress; emit(g); };
+        std::apply([&](auto&... r) { (r.Update(settings, press, history, s, noteHeld), ...); }, recognizers);
+
+        if (s.type == PointerEventType::Up)
+        {
+            press.down = false;
+        }
+    }
+
+    // 'now' must be on the samples' clock: the 'GetMessageTime' of the WM_TIMER message
+    template <class Emit>
+    void Tick(DWORD now, Emit&& emit)
+    {
+        auto noteHeld = [&](const RecognizedGesture& g) { press.held |= g.kind == GestureKind::LongPress; emit(g); };
+        std::get<LongPressRecognizer>(recognizers).Check(settings, press, now, noteHeld);
+    }
+};
@@ -0,0 +1,318 @@
+#pragma once
+
+#include <cmath>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "batch.h"
+#include "simd.h"
+#include "spatialgrid.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/*
+ - the shapes drawn so far; the index of a shape is its z-order, later shapes are drawn on top
+ - stored as a structure of arrays (center x/y, radius x/y) so hit testing can evaluate 8 ellipses per AVX2 instruction
+   (on a CPU without AVX2 the same tests run one shape at a time, see simd.h)
+ - shapes are grouped in blocks of 8 (one AVX2 register), and every block keeps the bounding box of its shapes
+    - the block boxes are themselves tested 8 at a time, which is the coarse pre-filter: a hit test only
+      looks at the ellipses of blocks whose box contains the point
+ - the arrays are padded to a whole group of 8 blocks; padding lanes hold NaN so every comparison against them fails
+ - a spatial hash grid is kept up to date as shapes are added and moved; picking a shape to select it or
+   to outline it under the mouse goes through the grid, so it only looks at the shapes in one cell
+ - 'HitTest' gives the same answer from the block boxes alone; '/hover' and '/move' check 'Pick' against it
+ - culling to a view rectangle also goes through the grid, unless the view covers so many cells
+   (zoomed far out) that scanning the block boxes is cheaper
+ - a removed shape keeps its index (so indices stay valid as shape ids) but its center becomes NaN,
+   which drops it from hit testing, and it leaves the grid
+ - every change bumps 'Version', so whatever is derived from the shapes (e.g. a recorded display list) can tell it is stale
+*/
+
+class Scene
+{
+public:
+    static const size_t BlockSize = 8;                       // ellipses per AVX2 register
+    static const size_t GroupSize = BlockSize * BlockSize;   // ellipses covered by one register of block boxes
+    static const UINT32 DefaultColor = 0xFFFF0000;           // 0xAARRGGBB, red
+
+    // F5 cycles the selected shape through these colors; F6 and the self-tests pick from them too
+    static constexpr UINT32 Palette[] = { DefaultColor, 0xFF4682B4, 0xFF008000, 0xFFFFA500, 0xFF800080 };
+
+private:
+    std::vector<float> cx, cy, rx, ry;                 // one entry per shape, padded to a multiple of GroupSize
+    std::vector<float> boxMinX, boxMinY, boxMaxX, boxMaxY; // one entry per block, padded to a multiple of BlockSize
+    std::vector<UINT32> colors;                        // one entry per shape, not padded
+    size_t count;
+    uint64_t version;
+    SpatialGrid grid;
+
+    static float Nan() { return std::numeric_limits<float>::quiet_NaN(); }
+
+    static unsigned HighestBit(unsigned mask)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanReverse(&index, mask);
+        return index;
+#else
+        return 31 - __builtin_clz(mask);
+#endif
+    }
+
+    void Reserve(size_t shapes)
+    {
+        const size_t padded = (shapes + GroupSize - 1) / GroupSize * GroupSize;
+        if (padded > cx.size())
+        {
+            cx.resize(padded, Nan());
+            cy.resize(padded, Nan());
+            rx.resize(padded, 0);
+            ry.resize(padded, 0);
+
+            const size_t blocks = padded / BlockSize;
+            boxMinX.resize(blocks, Nan());
+            boxMinY.resize(blocks, Nan());
+            boxMaxX.resize(blocks, Nan());
+            boxMaxY.resize(blocks, Nan());
+        }
+    }
+
+    // recompute the bounding box of one block from its (at most 8) shapes
+    void UpdateBlock(size_t block)
+    {
+        float minX = std::numeric_limits<float>::max(), minY = minX;
+        float maxX = -minX, maxY = -minX;
+
+        const size_t first = block * BlockSize;
+        const size_t last = first + BlockSize < count ? first + BlockSize : count;
+        for (size_t i = first; i < last; i++)
+        {
+            minX = cx[i] - rx[i] < minX ? cx[i] - rx[i] : minX;
+            minY = cy[i] - ry[i] < minY ? cy[i] - ry[i] : minY;
+            maxX = cx[i] + rx[i] > maxX ? cx[i] + rx[i] : maxX;
+            maxY = cy[i] + ry[i] > maxY ? cy[i] + ry[i] : maxY;
+        }
+
+        if (first >= last)
+        {
+            minX = minY = maxX = maxY = Nan();
+        }
+        boxMinX[block] = minX;
+        boxMinY[block] = minY;
+        boxMaxX[block] = maxX;
+        boxMaxY[block] = maxY;
+    }
+
+    // bit i is set when the box of block 'group * BlockSize + i' contains the point
+    unsigned BoxMask(size_t group, float x, float y) const
+    {
+        const size_t first = group * BlockSize;
+        if (Simd::Avx2)
+        {
+            return Simd::BoxMask(&boxMinX[first], &boxMinY[first], &boxMaxX[first], &boxMaxY[first], x, y);
+        }
+
+        unsigned mask = 0;
+        for (size_t i = 0; i < BlockSize; i++)
+        {
+            const size_t b = first + i;
+            if (boxMinX[b] <= x && x <= boxMaxX[b] && boxMinY[b] <= y && y <= boxMaxY[b])
+            {
+                mask |= 1u << i;
+            }
+        }
+        return mask;
+    }
+
+    /*
+     - bit i is set when shape 'block * BlockSize + i' contains the point
+     - (dx / rx)^2 + (dy / ry)^2 <= 1 is evaluated without division as dx^2 * ry^2 + dy^2 * rx^2 <= rx^2 * ry^2
+     - that form is 0 <= 0 for a shape with a zero radius (or radii so small the product underflows), true everywhere,
+       so lanes without area are masked out
+    */
+    unsigned EllipseMask(size_t block, float x, float y) const
+    {
+        const size_t first = block * BlockSize;
+        if (Simd::Avx2)
+        {
+            return Simd::EllipseMask(&cx[first], &cy[first], &rx[first], &ry[first], x, y);
+        }
+
+        unsigned mask = 0;
+        for (size_t i = 0; i < BlockSize; i++)
+        {
+            const size_t s = first + i;
+            const float dx = x - cx[s], dy = y - cy[s];
+            const float rx2 = rx[s] * rx[s], ry2 = ry[s] * ry[s];
+            if (dx * dx * ry2 + dy * dy * rx2 <= rx2 * ry2 && rx2 * ry2 > 0)
+            {
+                mask |= 1u << i;
+            }
+        }
+        return mask;
+    }
+
+public:
+    Scene() : count(0), version(0) {}
+
+    size_t Count() const { return count; }
+    uint64_t Version() const { return version; }
+
+    D2D1_ELLIPSE Get(size_t i) const { return D2D1::Ellipse(D2D1::Point2F(cx[i], cy[i]), rx[i], ry[i]); }
+
+    UINT32 Color(size_t i) const { return colors[i]; }
+    void SetColor(size_t i, UINT32 color)
+    {
+        colors[i] = color;
+        version++;
+    }
+
+    bool Alive(size_t i) const { return !std::isnan(cx[i]); }
+
+    // all shapes as one batch; the geometry arrays are padded with NaN to a whole group, so reading 8 at a time is safe
+    EllipseBatch Batch() const
+    {
+        EllipseBatch batch = { cx.data(), cy.data(), rx.data(), ry.data(), colors.data(), count };
+        return batch;
+    }
+
+    // appends a shape on top of all others and returns its index
+    size_t Add(const D2D1_ELLIPSE& e, UINT32 color = DefaultColor)
+    {
+        Reserve(count + 1);
+        const size_t i = count++;
+        colors.push_back(color);
+        Set(i, e);
+        return i;
+    }
+
+    void Remove(size_t i)
+    {
+        cx[i] = cy[i] = Nan();
+        rx[i] = ry[i] = 0;
+        UpdateBlock(i / BlockSize);
+        grid.Remove(static_cast<uint32_t>(i));
+        version++;
+    }
+
+    // radii are stored as absolute values; a drag towards the upper left produces negative ones
+    void Set(size_t i, const D2D1_ELLIPSE& e)
+    {
+        cx[i] = e.point.x;
+        cy[i] = e.point.y;
+        rx[i] = std::fabs(e.radiusX);
+        ry[i] = std::fabs(e.radiusY);
+        UpdateBlock(i / BlockSize);
+        grid.Update(static_cast<uint32_t>(i), { cx[i] - rx[i], cy[i] - ry[i], cx[i] + rx[i], cy[i] + ry[i] });
+        version++;
+    }
+
+    // same test as 'EllipseMask', zero-radius shapes included
+    bool Contains(size_t i, D2D1_POINT_2F pt) const
+    {
+        const float dx = pt.x - cx[i], dy = pt.y - cy[i];
+        const float rx2 = rx[i] * rx[i], ry2 = ry[i] * ry[i];
+        return dx * dx * ry2 + dy * dy * rx2 <= rx2 * ry2 && rx2 * ry2 > 0;
+    }
+
+    void Clear()
+    {
+        count = 0;
+        cx.clear(); cy.clear(); rx.clear(); ry.clear();
+        boxMinX.clear(); boxMinY.clear(); boxMaxX.clear(); boxMaxY.clear();
+        colors.clear();
+        grid.Clear();
+        version++;
+    }
+
+    bool Overlaps(size_t i, const SpatialGrid::Box& box) const
+    {
+        return cx[i] + rx[i] >= box.left && cx[i] - rx[i] <= box.right && cy[i] + ry[i] >= box.top && cy[i] - ry[i] <= box.bottom;
+    }
+
+    // appends the shapes whose bounding box overlaps 'view' to 'out', in z-order
+    void Cull(const SpatialGrid::Box& view, BatchArrays& out) const
+    {
+        auto push = [&](size_t i) { out.Push(static_cast<uint32_t>(i), cx[i], cy[i], rx[i], ry[i], colors[i]); };
+
+        if (grid.CellsIn(view) <= static_cast<int64_t>(count / 8))
+        {
+            std::pmr::vector<uint32_t> ids(out.ids.get_allocator());
+            grid.QueryBox(view, [&](uint32_t id)
+            {
+                if (Overlaps(id, view))
+                {
+                    ids.push_back(id);
+                }
+            });
+            std::sort(ids.begin(), ids.end());
+            for (uint32_t id : ids)
+            {
+                push(id);
+            }
+            return;
+        }
+
+        // whole blocks outside the view are skipped by their box; NaN (removed) shapes fail every comparison
+        const size_t blocks = (count + BlockSize - 1) / BlockSize;
+        for (size_t b = 0; b < blocks; b++)
+        {
+            if (!(boxMaxX[b] >= view.left && boxMinX[b] <= view.right && boxMaxY[b] >= view.top && boxMinY[b] <= view.bottom))
+            {
+                continue;
+            }
+            const size_t last = std::min(count, (b + 1) * BlockSize);
+            for (size_t i = b * BlockSize; i < last; i++)
+            {
+                if (Overlaps(i, view))
+                {
+                    push(i);
+                }
+            }
+        }
+    }
+
+    // index of the topmost shape containing 'pt', or -1; walks front to back and stops at the first hit
+    ptrdiff_t HitTest(D2D1_POINT_2F pt) const
+    {
+        const size_t groups = cx.size() / GroupSize;
+        for (size_t g = groups; g-- > 0; )
+        {
+            unsigned boxes = BoxMask(g, pt.x, pt.y);
+            while (boxes)
+            {
+                const unsigned b = HighestBit(boxes);
+                boxes &= ~(1u << b);
+
+                const size_t block = g * BlockSize + b;
+                const unsigned hits = EllipseMask(block, pt.x, pt.y);
+                if (hits)
+                {
+                    return static_cast<ptrdiff_t>(block * BlockSize + HighestBit(hits));
+                }
+            }
+        }
+        return -1;
+    }
+
+    const SpatialGrid& Grid() const { return grid; }
+
+    // same result as 'HitTest', but only examines the shapes listed in the grid cell under 'pt'
+    ptrdiff_t Pick(D2D1_POINT_2F pt) const
+    {
+        ptrdiff_t top = -1;
+        grid.Query(pt.x, pt.y, [&](uint32_t id)
+        {
+            if (static_cast<ptrdiff_t>(id) > top && Contains(id, pt))
+            {
+                top = id;
+            }
+        });
+        return top;
+    }
+};
@@ -0,0 +1,107 @@
+#include <windows.h>
+#include <d2d1.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "scene.h"
+#include "scenefile.h"
+
+namespace
+{
+    const char Magic[4] = { 'E', 'L', 'P', 'S' };
+    const uint32_t Version = 2; // version 1 had no colors
+
+    // bytes left to read, so a count read from a damaged file is rejected before it sizes an allocation
+    uint64_t Remaining(std::ifstream& file)
+    {
+        const std::streampos here = file.tellg();
+        file.seekg(0, std::ios::end);
+        const std::streampos end = file.tellg();
+        file.seekg(here);
+        return here < 0 || end < here ? 0 : static_cast<uint64_t>(end - here);
+    }
+}
+
+
+bool SaveScene(const std::filesystem::path& path, const Scene& scene)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        return false;
+    }
+
+    // removed shapes are not written
+    std::vector<float> data;
+    std::vector<UINT32> colors;
+    data.reserve(scene.Count() * 4);
+    colors.reserve(scene.Count());
+    for (size_t i = 0; i < scene.Count(); i++)
+    {
+        if (!scene.Alive(i))
+        {
+            continue;
+        }
+        const D2D1_ELLIPSE e = scene.Get(i);
+        data.push_back(e.point.x);
+        data.push_back(e.point.y);
+        data.push_back(e.radiusX);
+        data.push_back(e.radiusY);
+        colors.push_back(scene.Color(i));
+    }
+    const uint32_t count = static_cast<uint32_t>(colors.size());
+
+    file.write(Magic, sizeof(Magic));
+    file.write(reinterpret_cast<const char*>(&Version), sizeof(Version));
+    file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    file.write(reinterpret_cast<const char*>(data.data()), data.size() * sizeof(float));
+    file.write(reinterpret_cast<const char*>(colors.data()), colors.size() * sizeof(UINT32));
+    return static_cast<bool>(file);
+}
+
+bool LoadScene(const std::filesystem::path& path, Scene& scene)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+
+    char magic[4];
+    uint32_t version = 0, count = 0;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(&version), sizeof(version));
+    file.read(reinterpret_cast<char*>(&count), sizeof(count));
+    if (!file || std::memcmp(magic, Magic, sizeof(Magic)) != 0 || version < 1 || version > Version)
+    {
+        return false;
+    }
+    const uint64_t shapeBytes = 4 * sizeof(float) + (version >= 2 ? sizeof(UINT32) : 0);
+    if (count > Remaining(file) / shapeBytes)
+    {
+        return false; // cut short, or the count is garbage
+    }
+
+    std::vector<float> data(static_cast<size_t>(count) * 4);
+    std::vector<UINT32> colors(count, Scene::DefaultColor);
+    file.read(reinterpret_cast<char*>(data.data()), data.size() * sizeof(float));
+    if (version >= 2)
+    {
+        file.read(reinterpret_cast<char*>(colors.data()), colors.size() * sizeof(UINT32));
+    }
+    if (!file)
+    {
+        return false;
+    }
+
+    scene.Clear();
+    for (size_t i = 0; i < count; i++)
+    {
+        const float* s = &data[i * 4];
+        scene.Add(D2D1::Ellipse(D2D1::Point2F(s[0], s[1]), s[2], s[3]), colors[i]);
+    }
+    return true;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <filesystem>
+
+class Scene;
+
+/*
+ - binary drawing file: the 4-byte magic "ELPS", a format version, the shape count, then
+   center x, center y, radius x, radius y (little-endian floats, DIPs) for every shape in z-order,
+   then one 0xAARRGGBB color per shape (version 2 and later)
+ - both functions return false if the file cannot be opened or is not a drawing; 'LoadScene' checks the shape count
+   against the file size before allocating, so a truncated or damaged file is rejected rather than throwing
+*/
+
+bool SaveScene(const std::filesystem::path& path, const Scene& scene);
+bool LoadScene(const std::filesystem::path& path, Scene& scene);
@@ -0,0 +1,2174 @@
+#include <windows.h>
+#include <windowsX.h>
+#include <d2d1.h>
+#include <wincodec.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <random>
+#include <string>
+#pragma comment(lib, "windowscodecs")
+
+#include "selftest.h"
+#include "autosave.h"
+#include "basewin.h"
+#include "capture.h"
+#include "displaylist.h"
+#include "displayoptimizer.h"
+#include "document.h"
+#include "ellipsesprites.h"
+#include "export.h"
+#include "framearena.h"
+#include "gesture.h"
+#include "heapwatch.h"
+#include "inputexport.h"
+#include "pointerhistory.h"
+#include "pointers.h"
+#include "predictor.h"
+#include "profiler.h"
+#include "qoi.h"
+#include "recognizer.h"
+#include "scene.h"
+#include "simd.h"
+#include "softrender.h"
+#include "textbuffer.h"
+#include "threadpool.h"
+#include "windowcache.h"
+
+namespace
+{
+    template <class T> void SafeRelease(T** ppT)
+    {
+        if (*ppT)
+        {
+            (*ppT)->Release();
+            *ppT = NULL;
+        }
+    }
+}
+
+
+// history timing: UserInputWin32.exe /history <operations> <file>
+// exits with 1 if a seek shows a different drawing than replaying the log from the start
+int RunHistory(int argc, wchar_t** argv)
+{
+    const long long operations = _wtoi64(argv[2]);
+    HistoryTimings timings;
+    if (operations <= 0 || !MeasureHistory(argv[3], static_cast<size_t>(operations), timings))
+    {
+        return 1;
+    }
+
+    wchar_t msg[192];
+    swprintf_s(msg, L"history: %zu operations, %zu snapshots, open %.1f ms, seek mean %.2f ms max %.2f ms (%zu replayed at most)\n",
+        timings.operations, timings.snapshots, timings.openSeconds * 1000, timings.seekMeanSeconds * 1000,
+        timings.seekMaxSeconds * 1000, timings.maxReplayed);
+    OutputDebugString(msg);
+    swprintf_s(msg, L"history: %zu of %zu seeks differ from replaying the log from the start\n",
+        timings.seekMismatches, timings.seeksChecked);
+    OutputDebugString(msg);
+    return timings.seekMismatches == 0 ? 0 : 1;
+}
+
+
+/*
+ - autosave round trip: UserInputWin32.exe /autosave <operations> <journal>
+ - random drag edits go into a document, which hands its unsaved operations to an 'Autosaver' every 1000 operations
+   and keeps editing while the worker writes them; now and then the history is stepped back before an edit, so
+   records replace the journal's tail and chunks the worker still holds are copied before they are written over
+ - once the autosaver has finished, the journal is recovered into a second document, then cut 10 bytes short, as
+   by a crash in the middle of the last record, and recovered into a third
+ - exits with 1 if the first recovery differs from the document's log as of the last autosave, or the second from
+   the log as of the one before
+*/
+int RunAutosave(int argc, wchar_t** argv)
+{
+    const long long operations = _wtoi64(argv[2]);
+    const std::filesystem::path path = argv[3];
+    if (operations <= 0)
+    {
+        return 1;
+    }
+
+    // the log as of the last two saves (the journal holds the whole log, which may go on past the position shown)
+    Scene scene, saved[2];
+    Document document(scene);
+    size_t savedCount[2] = { 0, 0 }, saves = 0;
+    {
+        Autosaver autosaver(path);
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> coordinate(0.0f, 2000.0f);
+        size_t shape = 0;
+        for (long long i = 0; i < operations; i++)
+        {
+            const unsigned roll = random() % 200;
+            if (i == 0 || roll == 0)
+            {
+                shape = document.CreateShape(D2D1::Ellipse(D2D1::Point2F(coordinate(random), coordinate(random)), 1.0f, 1.0f));
+            }
+            else if (roll == 1)
+            {
+                document.Recolor(random() % scene.Count(), random() | 0xFF000000);
+            }
+            else if (roll == 2 && shape > 0)
+            {
+                document.Delete(random() % shape);
+            }
+            else if (roll == 3 && document.Position() > 100)
+            {
+                document.Seek(document.Position() - 1 - random() % 100);
+                shape = scene.Count() - 1; // the first operation is a create, so there is one
+            }
+            else
+            {
+                document.Resize(shape, D2D1::Ellipse(D2D1::Point2F(coordinate(random), coordinate(random)), 8.0f, 8.0f));
+            }
+
+            if (i % 1000 == 999 || i == operations - 1)
+            {
+                saves++;
+                savedCount[saves % 2] = document.OperationCount();
+                document.Replay(document.OperationCount(), saved[saves % 2]);
+                autosaver.Submit(document.TakeUnsaved());
+            }
+        }
+    }
+
+    Scene recovered, cut;
+    Document full(recovered), crashed(cut);
+    const bool fullOk = full.Recover(path) && full.OperationCount() == savedCount[saves % 2] && SameDrawing(recovered, saved[saves % 2]);
+
+    std::error_code error;
+    const uintmax_t size = std::filesystem::file_size(path, error);
+    std::filesystem::resize_file(path, size - 10, error);
+    const size_t before = (saves + 1) % 2; // the save before the last one; with a single save, the empty document
+    const bool cutOk = !error && crashed.Recover(path) == (savedCount[before] > 0) && crashed.OperationCount() == savedCount[before] &&
+        SameDrawing(cut, saved[before]);
+
+    wchar_t msg[192];
+    swprintf_s(msg, L"autosave: %zu operations in %zu saves; recovered %zu (%s), %zu after cutting the last record (%s)\n",
+        document.OperationCount(), saves, full.OperationCount(), fullOk ? L"same drawing" : L"DIFFERENT",
+        crashed.OperationCount(), cutOk ? L"as of the save before" : L"WRONG");
+    OutputDebugString(msg);
+    return fullOk && cutOk ? 0 : 1;
+}
+
+
+// follows the input of a running window: UserInputWin32.exe /tap <events> [<trace file>]
+// with a file, the events also go into it as they are in the ring, one 'InputEvent' after another, for '/predict'
+int RunTap(int argc, wchar_t** argv)
+{
+    const long long events = _wtoi64(argv[2]);
+    InputTap tap;
+    if (events <= 0 || !tap.Open())
+    {
+        return 1;
+    }
+    std::ofstream trace;
+    if (argc == 4)
+    {
+        trace.open(std::filesystem::path(argv[3]), std::ios::binary | std::ios::trunc);
+        if (!trace)
+        {
+            return 1;
+        }
+    }
+
+    wchar_t msg[128];
+    InputEvent e;
+    for (long long i = 0; i < events; )
+    {
+        if (!tap.Next(e))
+        {
+            Sleep(1); // caught up; the writer never waits for us, so polling is all there is
+            continue;
+        }
+        swprintf_s(msg, L"tap: 0x%04x at %u ms, wParam 0x%llx, lParam 0x%llx (%llu dropped)\n", e.message, e.time,
+            static_cast<unsigned long long>(e.wParam), static_cast<unsigned long long>(e.lParam),
+            static_cast<unsigned long long>(tap.Dropped()));
+        OutputDebugString(msg);
+        if (trace.is_open())
+        {
+            trace.write(reinterpret_cast<const char*>(&e), sizeof(e));
+        }
+        i++;
+    }
+    return 0;
+}
+
+
+/*
+ - pointer prediction on a recorded trace: UserInputWin32.exe /predict <trace file>
+ - record one with '/tap <events> <trace file>' while drawing in a running window
+ - the trace's WM_MOUSEMOVEs are cut into strokes where the left button changes or the pointer rests over 100 ms, and
+   each stroke is fed through a 'PointerPredictor' as the drag feeds it, once per look-ahead; after every sample the
+   position predicted that far ahead is compared with where the trace really was by then (interpolated between moves)
+ - beside it, the error of showing the last sample, which is what not predicting shows for the same latency; the
+   predictor is worth it for look-aheads where its error is the smaller one
+ - positions are client pixels, as recorded
+ - exits with 1 if the trace cannot be read or has no stroke to replay
+*/
+int RunPredict(int argc, wchar_t** argv)
+{
+    std::vector<InputEvent> events;
+    {
+        std::ifstream trace(std::filesystem::path(argv[2]), std::ios::binary | std::ios::ate);
+        const std::streamoff size = trace ? static_cast<std::streamoff>(trace.tellg()) : -1;
+        if (size <= 0 || size % sizeof(InputEvent) != 0)
+        {
+            return 1;
+        }
+        events.resize(static_cast<size_t>(size / sizeof(InputEvent)));
+        trace.seekg(0);
+        trace.read(reinterpret_cast<char*>(events.data()), size);
+        if (!trace)
+        {
+            return 1;
+        }
+    }
+
+    // time in ms from the first move, so 'GetMessageTime' wrapping during the trace does not matter
+    struct Move { long long time; D2D1_POINT_2F pt; };
+    std::vector<std::vector<Move>> strokes;
+    long long now = 0;
+    uint32_t lastTime = 0;
+    bool lastDown = false, first = true;
+    for (const InputEvent& e : events)
+    {
+        if (e.message != WM_MOUSEMOVE)
+        {
+            continue;
+        }
+        if (!first)
+        {
+            now += static_cast<int32_t>(e.time - lastTime);
+        }
+        const LPARAM lParam = static_cast<LPARAM>(e.lParam);
+        const Move move = { now, D2D1::Point2F(static_cast<float>(GET_X_LPARAM(lParam)), static_cast<float>(GET_Y_LPARAM(lParam))) };
+        const bool down = (e.wParam & MK_LBUTTON) != 0;
+        if (first || down != lastDown || move.time - strokes.back().back().time > 100)
+        {
+            strokes.emplace_back();
+        }
+        strokes.back().push_back(move);
+        lastTime = e.time;
+        lastDown = down;
+        first = false;
+    }
+
+    size_t moves = 0, replayed = 0;
+    for (const std::vector<Move>& stroke : strokes)
+    {
+        moves += stroke.size();
+        replayed += stroke.size() > 1 ? 1 : 0;
+    }
+    wchar_t msg[224];
+    swprintf_s(msg, L"predict: %zu events, %zu moves in %zu strokes (%zu with more than one move)\n",
+        events.size(), moves, strokes.size(), replayed);
+    OutputDebugString(msg);
+    if (replayed == 0)
+    {
+        return 1;
+    }
+
+    auto distance = [](D2D1_POINT_2F a, D2D1_POINT_2F b) { return std::hypot(a.x - b.x, a.y - b.y); };
+    auto percentile = [](std::vector<float>& v, double p)
+    {
+        std::sort(v.begin(), v.end());
+        return v.empty() ? 0.0f : v[std::min(v.size() - 1, static_cast<size_t>(p * v.size()))];
+    };
+
+    const int leads[] = { 0, 4, 8, 16, 25, 33, 50 }; // ms; one to three frames at 60 Hz, and below
+    for (int lead : leads)
+    {
+        std::vector<float> predicted, held;
+        for (const std::vector<Move>& stroke : strokes)
+        {
+            PointerPredictor predictor;
+            predictor.Reset(stroke[0].pt, static_cast<DWORD>(stroke[0].time));
+            size_t next = 0; // first move at or after the predicted instant
+            for (size_t i = 1; i < stroke.size(); i++)
+            {
+                predictor.AddSample(stroke[i].pt, static_cast<DWORD>(stroke[i].time));
+                const D2D1_POINT_2F guess = predictor.Predict(static_cast<DWORD>(stroke[i].time + lead));
+
+                const long long at = stroke[i].time + lead;
+                if (at > stroke.back().time)
+                {
+                    break; // the trace does not say where the pointer went after the stroke
+                }
+                next = std::max(next, i);
+                while (stroke[next].time < at)
+                {
+                    next++;
+                }
+                D2D1_POINT_2F truth = stroke[next].pt;
+                if (stroke[next].time > at)
+                {
+                    const Move& a = stroke[next - 1];
+                    const Move& b = stroke[next];
+                    const float t = static_cast<float>(at - a.time) / static_cast<float>(b.time - a.time);
+                    truth = D2D1::Point2F(a.pt.x + (b.pt.x - a.pt.x) * t, a.pt.y + (b.pt.y - a.pt.y) * t);
+                }
+                predicted.push_back(distance(guess, truth));
+                held.push_back(distance(stroke[i].pt, truth));
+            }
+        }
+
+        double predictedSum = 0, heldSum = 0;
+        for (size_t i = 0; i < predicted.size(); i++)
+        {
+            predictedSum += predicted[i];
+            heldSum += held[i];
+        }
+        const double n = predicted.empty() ? 1.0 : static_cast<double>(predicted.size());
+        const float predictedMax = predicted.empty() ? 0.0f : *std::max_element(predicted.begin(), predicted.end());
+        const float predicted95 = percentile(predicted, 0.95), held95 = percentile(held, 0.95);
+        swprintf_s(msg, L"predict: %2d ms ahead, %zu samples: predicted off by %.2f px mean, %.2f 95th, %.2f max; "
+            L"the last sample by %.2f mean, %.2f 95th\n", lead, predicted.size(), predictedSum / n, predicted95,
+            predictedMax, heldSum / n, held95);
+        OutputDebugString(msg);
+    }
+    return 0;
+}
+
+
+// microseconds per frame to draw 'list' into 'pTarget'; 'EndDraw' is inside the timing, as Direct2D only draws there
+double TimeDirect2D(const DisplayList& list, ID2D1RenderTarget* pTarget, ID2D1SolidColorBrush* pBrush, int frames)
+{
+    D2DDisplayBackend backend(pTarget, pBrush);
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; i++)
+    {
+        pTarget->BeginDraw();
+        list.Replay(backend);
+        pTarget->EndDraw();
+    }
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / frames;
+}
+
+/*
+ - display list timing on static scenes: UserInputWin32.exe /displaylist <shapes>
+ - also checks that a list changes nothing drawn: replaying it must issue exactly the commands immediate issue does,
+   and the optimized list must draw the same pixels as the recorded one, exactly with the software renderer, and
+   within one level per channel with Direct2D, whose anti-aliased edges may round differently once reordered
+ - exits with 1 if a check fails
+*/
+int RunDisplayList(int argc, wchar_t** argv)
+{
+    const long long shapes = _wtoi64(argv[2]);
+    if (shapes <= 0)
+    {
+        return 1;
+    }
+
+    // the Direct2D backend draws into an 800 x 600 bitmap at 96 DPI, so one DIP of the lists below is one pixel
+    HRESULT hr = CoInitializeEx(NULL, COINIT_APARTMENTTHREADED | COINIT_DISABLE_OLE1DDE);
+    const bool comInitialized = SUCCEEDED(hr);
+    IWICImagingFactory* pWicFactory = NULL;
+    IWICBitmap* pBitmap = NULL;
+    ID2D1Factory* pFactory = NULL;
+    ID2D1RenderTarget* pTarget = NULL;
+    ID2D1SolidColorBrush* pBrush = NULL;
+    if (SUCCEEDED(hr))
+    {
+        hr = CoCreateInstance(CLSID_WICImagingFactory, NULL, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&pWicFactory));
+    }
+    if (SUCCEEDED(hr))
+    {
+        hr = pWicFactory->CreateBitmap(800, 600, GUID_WICPixelFormat32bppPBGRA, WICBitmapCacheOnLoad, &pBitmap);
+    }
+    if (SUCCEEDED(hr))
+    {
+        hr = D2D1CreateFactory(D2D1_FACTORY_TYPE_SINGLE_THREADED, &pFactory);
+    }
+    if (SUCCEEDED(hr))
+    {
+        hr = pFactory->CreateWicBitmapRenderTarget(pBitmap, D2D1::RenderTargetProperties(D2D1_RENDER_TARGET_TYPE_DEFAULT,
+            D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED), 96.0f, 96.0f), &pTarget);
+    }
+    if (SUCCEEDED(hr))
+    {
+        hr = pTarget->CreateSolidColorBrush(D2D1::ColorF(Scene::DefaultColor & 0xFFFFFF), &pBrush);
+    }
+
+    // an 800 x 600 view at 96 DPI over the shapes of F6 (visible, a few pixels across) and of Shift+F6 (sub-pixel, splatted)
+    size_t failures = 0;
+    struct Case { const wchar_t* name; float minRadius, maxRadius; };
+    const Case cases[] = { { L"small shapes", 2.0f, 12.0f }, { L"sub-pixel shapes", 0.1f, 0.4f } };
+    for (const Case& c : cases)
+    {
+        Scene scene;
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> x(0, 800), y(0, 600), radius(c.minRadius, c.maxRadius);
+        for (long long i = 0; i < shapes; i++)
+        {
+            scene.Add(D2D1::Ellipse(D2D1::Point2F(x(random), y(random)), radius(random), radius(random)), Scene::Palette[random() % ARRAYSIZE(Scene::Palette)]);
+        }
+
+        const SceneDisplayList::Key key = { scene.Version(), 0, 0, 800, 600, 1.0f, 1.0f, true, 0xFFFFEBCD };
+        DisplayListTimings timings;
+        MeasureDisplayList(scene, key, 100, timings);
+
+        wchar_t msg[256];
+        swprintf_s(msg, L"display list, %s: %zu commands in %zu bytes; per frame: immediate %.1f us, record %.1f us, replay %.1f us\n",
+            c.name, timings.commands, timings.bytes, timings.immediateMicroseconds, timings.recordMicroseconds, timings.replayMicroseconds);
+        OutputDebugString(msg);
+        swprintf_s(msg, L"  optimized in %.1f us: %zu commands, %zu color changes (from %zu); replay %.1f us\n",
+            timings.optimizeMicroseconds, timings.optimizedCommands, timings.optimizedColors, timings.colors, timings.replayOptimizedMicroseconds);
+        OutputDebugString(msg);
+        swprintf_s(msg, L"  replay %s immediate issue; software renderer: %zu pixels differ after optimizing\n",
+            timings.replaySame ? L"matches" : L"DIFFERS FROM", timings.optimizedPixelsDiffering);
+        OutputDebugString(msg);
+        failures += !timings.replaySame || timings.optimizedPixelsDiffering > 0;
+
+        if (pBrush)
+        {
+            std::pmr::unsynchronized_pool_resource scratch;
+            DisplayList recorded, optimized;
+            SceneDisplayList::Record(scene, key, &scratch, recorded);
+            OptimizeDisplayList(recorded, SceneDisplayList::PixelGrid(key), &scratch, optimized);
+            const double before = TimeDirect2D(recorded, pTarget, pBrush, 10);
+            std::vector<BYTE> recordedPixels(800 * 600 * 4), optimizedPixels(800 * 600 * 4);
+            pBitmap->CopyPixels(NULL, 800 * 4, static_cast<UINT>(recordedPixels.size()), recordedPixels.data());
+            const double after = TimeDirect2D(optimized, pTarget, pBrush, 10);
+            pBitmap->CopyPixels(NULL, 800 * 4, static_cast<UINT>(optimizedPixels.size()), optimizedPixels.data());
+
+            size_t differing = 0;
+            int worst = 0;
+            for (size_t i = 0; i < recordedPixels.size(); i += 4)
+            {
+                int most = 0;
+                for (size_t channel = i; channel < i + 4; channel++)
+                {
+                    most = std::max(most, std::abs(recordedPixels[channel] - optimizedPixels[channel]));
+                }
+                differing += most > 0;
+                worst = std::max(worst, most);
+            }
+            swprintf_s(msg, L"  Direct2D backend per frame: %.1f us recorded, %.1f us optimized; %zu pixels differ, by at most %d\n",
+                before, after, differing, worst);
+            OutputDebugString(msg);
+            failures += worst > 1;
+        }
+    }
+
+    SafeRelease(&pBrush);
+    SafeRelease(&pTarget);
+    SafeRelease(&pFactory);
+    SafeRelease(&pBitmap);
+    SafeRelease(&pWicFactory);
+    if (comInitialized)
+    {
+        CoUninitialize();
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+/*
+ - frame times of the scene's drawing paths: UserInputWin32.exe /frames <shapes> <frames>
+ - <shapes> random shapes of F6 over an 800 x 600 view at 96 DPI, drawn <frames> times each way into a WIC bitmap, with
+   'EndDraw' inside the timing as Direct2D only draws there; both ways cull the scene and use the frame arena every frame,
+   as 'OnPaint' does
+    - batched: the culled shapes as one sprite batch ('EllipseSprites'), skipped where the render target has no
+      'ID2D1DeviceContext3'
+    - per shape: the display list recorded and replayed with one 'FillEllipse' per shape
+ - then as many shapes over 16 times the view in each direction, through the software renderer on the calling thread:
+    - seen whole at zoom 1/16, where a third are below a pixel, with splats (level of detail) and with every shape rasterized
+    - panned across at zoom 1, 8 x 6 DIPs per frame, with the scene culled to the view ('Scene::Cull') and whole,
+      leaving the clipping to the renderer
+ - exits with 1 if the shapes the display list draws are not the batch the sprites draw, in the same order and colors,
+   if splatting covers other pixels than full rasterization does plus the pixel under each splatted shape's center,
+   or if a panned frame culls other shapes than a test of every shape against the view finds, or draws other pixels
+*/
+int RunFrames(int argc, wchar_t** argv)
+{
+    const long long shapes = _wtoi64(argv[2]);
+    const int frames = _wtoi(argv[3]);
+    if (shapes <= 0 || frames <= 0)
+    {
+        return 1;
+    }
+
+    HRESULT hr = CoInitializeEx(NULL, COINIT_APARTMENTTHREADED | COINIT_DISABLE_OLE1DDE);
+    const bool comInitialized = SUCCEEDED(hr);
+    IWICImagingFactory* pWicFactory = NULL;
+    IWICBitmap* pBitmap = NULL;
+    ID2D1Factory* pFactory = NULL;
+    ID2D1RenderTarget* pTarget = NULL;
+    ID2D1SolidColorBrush* pBrush = NULL;
+    if (SUCCEEDED(hr))
+    {
+        hr = CoCreateInstance(CLSID_WICImagingFactory, NULL, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&pWicFactory));
+    }
+    if (SUCCEEDED(hr))
+    {
+        hr = pWicFactory->CreateBitmap(800, 600, GUID_WICPixelFormat32bppPBGRA, WICBitmapCacheOnLoad, &pBitmap);
+    }
+    if (SUCCEEDED(hr))
+    {
+        hr = D2D1CreateFactory(D2D1_FACTORY_TYPE_SINGLE_THREADED, &pFactory);
+    }
+    if (SUCCEEDED(hr))
+    {
+        hr = pFactory->CreateWicBitmapRenderTarget(pBitmap, D2D1::RenderTargetProperties(D2D1_RENDER_TARGET_TYPE_DEFAULT,
+            D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED), 96.0f, 96.0f), &pTarget);
+    }
+    if (SUCCEEDED(hr))
+    {
+        hr = pTarget->CreateSolidColorBrush(D2D1::ColorF(Scene::DefaultColor & 0xFFFFFF), &pBrush);
+    }
+    EllipseSprites sprites;
+    if (pTarget == NULL || FAILED(sprites.Create(pTarget)))
+    {
+        OutputDebugString(L"frames: no sprite batches on this render target, the batched path is not timed\n");
+    }
+
+    Scene scene;
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> x(0, 800), y(0, 600), radius(2.0f, 12.0f);
+    for (long long i = 0; i < shapes; i++)
+    {
+        scene.Add(D2D1::Ellipse(D2D1::Point2F(x(random), y(random)), radius(random), radius(random)), Scene::Palette[random() % ARRAYSIZE(Scene::Palette)]);
+    }
+
+    typedef std::chrono::steady_clock Clock;
+    FrameArena arena;
+    wchar_t msg[192];
+    size_t failures = 0;
+
+    // batched against per shape: the sprite path against the display list, no level of detail at zoom 1
+    {
+        const SpatialGrid::Box view = { 0, 0, 800, 600 };
+        const SceneDisplayList::Key key = { scene.Version(), view.left, view.top, view.right, view.bottom, 1.0f, 1.0f, false, 0xFFFFEBCD };
+        DisplayList list;
+
+        BatchArrays listed(std::pmr::get_default_resource()), culled(std::pmr::get_default_resource());
+        SceneDisplayList::Record(scene, key, &arena, list);
+        BatchDisplayBackend gather(listed);
+        list.Replay(gather);
+        scene.Cull(view, culled);
+        arena.Reset();
+        const bool same = listed.cx == culled.cx && listed.cy == culled.cy && listed.rx == culled.rx && listed.ry == culled.ry &&
+            listed.colors == culled.colors;
+        failures += !same;
+
+        double batchedMs = 0, perShapeMs = 0;
+        if (sprites.Ready())
+        {
+            const Clock::time_point start = Clock::now();
+            for (int f = 0; f < frames; f++)
+            {
+                pTarget->BeginDraw();
+                {
+                    BatchArrays visible(&arena);
+                    scene.Cull(view, visible);
+                    pTarget->Clear(D2D1::ColorF(D2D1::ColorF::BlanchedAlmond));
+                    sprites.Draw(visible.Batch(), 1.0f, 1.0f, false, &arena);
+                }
+                pTarget->EndDraw();
+                arena.Reset();
+            }
+            batchedMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / frames;
+        }
+        if (pBrush)
+        {
+            D2DDisplayBackend backend(pTarget, pBrush);
+            const Clock::time_point start = Clock::now();
+            for (int f = 0; f < frames; f++)
+            {
+                pTarget->BeginDraw();
+                SceneDisplayList::Record(scene, key, &arena, list);
+                list.Replay(backend);
+                pTarget->EndDraw();
+                arena.Reset();
+            }
+            perShapeMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / frames;
+        }
+
+        swprintf_s(msg, L"frames, %zu of %zu shapes visible: batched %.2f ms, per shape %.2f ms per frame; %s\n",
+            culled.ids.size(), scene.Count(), batchedMs, perShapeMs, same ? L"same shapes" : L"SHAPES DIFFER");
+        OutputDebugString(msg);
+    }
+
+    // the scene of the software renderer, 12800 x 9600 DIPs
+    const float Zoom = 1.0f / 16;
+    const UINT32 Background = 0xFFFFEBCD; // BlanchedAlmond, no color of the palette
+    Scene wide;
+    std::uniform_real_distribution<float> wideX(0, 800 / Zoom), wideY(0, 600 / Zoom);
+    for (long long i = 0; i < shapes; i++)
+    {
+        wide.Add(D2D1::Ellipse(D2D1::Point2F(wideX(random), wideY(random)), radius(random), radius(random)), Scene::Palette[random() % ARRAYSIZE(Scene::Palette)]);
+    }
+    const EllipseBatch batch = wide.Batch();
+
+    // splats against full rasterization: a full shape below a pixel covers at most the pixel under its center, which
+    // is the one its splat covers, so the splats add exactly those pixels and nothing else changes
+    {
+
+        auto time = [&](SoftwareRenderer& renderer)
+        {
+            renderer.Resize(800, 600);
+            renderer.Render(batch, Zoom, Zoom, 0, 0, Background);
+            const Clock::time_point start = Clock::now();
+            for (int f = 0; f < frames; f++)
+            {
+                renderer.Render(batch, Zoom, Zoom, 0, 0, Background);
+            }
+            return std::chrono::duration<double, std::milli>(Clock::now() - start).count() / frames;
+        };
+        SoftwareRenderer splatted, full;
+        full.SetLevelOfDetail(false);
+        const double splattedMs = time(splatted), fullMs = time(full);
+
+        // the same arithmetic as the renderer, so the pixel is the one it picks
+        std::vector<bool> centers(800 * 600);
+        size_t splats = 0;
+        for (size_t i = 0; i < batch.count; i++)
+        {
+            const float cx = batch.cx[i] * Zoom, cy = batch.cy[i] * Zoom, rx = batch.rx[i] * Zoom, ry = batch.ry[i] * Zoom;
+            if (rx > 0 && ry > 0 && rx < SplatRadius && ry < SplatRadius)
+            {
+                splats++;
+                const float px = std::floor(cx), py = std::floor(cy);
+                if (px >= 0 && px < 800 && py >= 0 && py < 600)
+                {
+                    centers[static_cast<size_t>(py) * 800 + static_cast<size_t>(px)] = true;
+                }
+            }
+        }
+        size_t differing = 0;
+        for (size_t p = 0; p < centers.size(); p++)
+        {
+            differing += (splatted.Pixels()[p] != Background) != (full.Pixels()[p] != Background || centers[p]);
+        }
+        failures += differing > 0;
+
+        swprintf_s(msg, L"frames, %zu shapes at zoom 1/16, %zu splatted: splats %.2f ms, full %.2f ms per frame; %zu pixels differ\n",
+            wide.Count(), splats, splattedMs, fullMs, differing);
+        OutputDebugString(msg);
+    }
+
+    // culled against unculled while panning: both frames are timed, then compared untimed
+    {
+        SoftwareRenderer culledRenderer, wholeRenderer;
+        culledRenderer.Resize(800, 600);
+        wholeRenderer.Resize(800, 600);
+        std::vector<uint32_t> expected;
+        double culledMs = 0, wholeMs = 0;
+        size_t visibleShapes = 0, wrongCulls = 0, wrongFrames = 0;
+        for (int f = 0; f < frames; f++)
+        {
+            const float left = std::fmod(8.0f * f, 800 / Zoom - 800), top = std::fmod(6.0f * f, 600 / Zoom - 600);
+            const SpatialGrid::Box view = { left, top, left + 800, top + 600 };
+
+            {
+                const Clock::time_point start = Clock::now();
+                BatchArrays visible(&arena);
+                wide.Cull(view, visible);
+                culledRenderer.Render(visible.Batch(), 1.0f, 1.0f, -left, -top, Background);
+                culledMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+                // the reference: every shape tested against the view, in z-order
+                expected.clear();
+                for (size_t i = 0; i < wide.Count(); i++)
+                {
+                    if (wide.Overlaps(i, view))
+                    {
+                        expected.push_back(static_cast<uint32_t>(i));
+                    }
+                }
+                wrongCulls += !std::equal(visible.ids.begin(), visible.ids.end(), expected.begin(), expected.end());
+                visibleShapes += visible.ids.size();
+            }
+            arena.Reset();
+
+            const Clock::time_point start = Clock::now();
+            wholeRenderer.Render(batch, 1.0f, 1.0f, -left, -top, Background);
+            wholeMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+            wrongFrames += !std::equal(culledRenderer.Pixels(), culledRenderer.Pixels() + 800 * 600, wholeRenderer.Pixels());
+        }
+        failures += wrongCulls > 0 || wrongFrames > 0;
+
+        swprintf_s(msg, L"frames, panning over %zu shapes, %zu visible on average: culled %.2f ms, whole scene %.2f ms per frame; "
+            L"%zu frames culled other shapes, %zu drew other pixels\n",
+            wide.Count(), visibleShapes / frames, culledMs / frames, wholeMs / frames, wrongCulls, wrongFrames);
+        OutputDebugString(msg);
+    }
+
+    sprites.Discard();
+    SafeRelease(&pBrush);
+    SafeRelease(&pTarget);
+    SafeRelease(&pFactory);
+    SafeRelease(&pBitmap);
+    SafeRelease(&pWicFactory);
+    if (comInitialized)
+    {
+        CoUninitialize();
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+
+// the bounding box of a drag, as a gesture coroutine: what '/gesture' measures against 'DragBoxHandlers'
+Gesture DragBox(PointerEvent down, D2D1_RECT_F& box)
+{
+    box = D2D1::RectF(down.pt.x, down.pt.y, down.pt.x, down.pt.y);
+    for (;;)
+    {
+        const PointerEvent e = co_await next_pointer_event();
+        box.left = std::min(box.left, e.pt.x);
+        box.top = std::min(box.top, e.pt.y);
+        box.right = std::max(box.right, e.pt.x);
+        box.bottom = std::max(box.bottom, e.pt.y);
+        if (e.type == PointerEventType::Up)
+        {
+            break;
+        }
+    }
+}
+
+// the same drag the way the mouse handlers did it before gestures: state in members, one call per message;
+// not inlined, as a message handler is reached through the window procedure
+struct DragBoxHandlers
+{
+    D2D1_RECT_F box;
+    bool dragging;
+
+    __declspec(noinline) void OnDown(const PointerEvent& e)
+    {
+        box = D2D1::RectF(e.pt.x, e.pt.y, e.pt.x, e.pt.y);
+        dragging = true;
+    }
+
+    __declspec(noinline) void OnMove(const PointerEvent& e)
+    {
+        if (dragging)
+        {
+            box.left = std::min(box.left, e.pt.x);
+            box.top = std::min(box.top, e.pt.y);
+            box.right = std::max(box.right, e.pt.x);
+            box.bottom = std::max(box.bottom, e.pt.y);
+        }
+    }
+
+    __declspec(noinline) void OnUp(const PointerEvent& e)
+    {
+        OnMove(e);
+        dragging = false;
+    }
+};
+
+/*
+ - what writing a gesture as a coroutine costs per event: UserInputWin32.exe /gesture <events>
+ - random drags of 100 events each go through 'DragBox' (one 'Gesture::Send', a resume, per event) and through
+   'DragBoxHandlers' (one direct call per event); starting a gesture, which allocates its frame from the pool and runs
+   it to its first 'co_await', and ending it, which frees the frame, is timed on its own
+ - exits with 1 if the two disagree on any box, or if a frame came from the heap instead of the pool
+*/
+int RunGesture(int argc, wchar_t** argv)
+{
+    const long long events = _wtoi64(argv[2]);
+    const int PerGesture = 100;
+    if (events < PerGesture)
+    {
+        return 1;
+    }
+
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> coordinate(0, 800);
+    std::vector<PointerEvent> trace(PerGesture);
+    for (int i = 0; i < PerGesture; i++)
+    {
+        const PointerEventType type = i == 0 ? PointerEventType::Down : i == PerGesture - 1 ? PointerEventType::Up : PointerEventType::Move;
+        trace[i] = { type, D2D1::Point2F(coordinate(random), coordinate(random)), MK_LBUTTON, static_cast<DWORD>(i) };
+    }
+
+    const long long gestures = events / PerGesture;
+    const size_t heapBefore = GesturePool().HeapFrames();
+    typedef std::chrono::steady_clock Clock;
+    size_t mismatches = 0;
+    double coroutine = 0, direct = 0, startEnd = 0;
+
+    D2D1_RECT_F box = {};
+    DragBoxHandlers handlers = {};
+    for (long long g = 0; g < gestures; g++)
+    {
+        // a different drag each time, so neither version can keep results around
+        const float shift = static_cast<float>(g % 64);
+
+        Clock::time_point start = Clock::now();
+        Gesture gesture = DragBox(trace[0], box);
+        startEnd += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        start = Clock::now();
+        for (int i = 1; i < PerGesture; i++)
+        {
+            PointerEvent e = trace[i];
+            e.pt.x += shift;
+            gesture.Send(e);
+        }
+        coroutine += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        start = Clock::now();
+        gesture.Reset();
+        startEnd += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+        start = Clock::now();
+        handlers.OnDown(trace[0]);
+        for (int i = 1; i < PerGesture - 1; i++)
+        {
+            PointerEvent e = trace[i];
+            e.pt.x += shift;
+            handlers.OnMove(e);
+        }
+        PointerEvent up = trace[PerGesture - 1];
+        up.pt.x += shift;
+        handlers.OnUp(up);
+        direct += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+        mismatches += memcmp(&box, &handlers.box, sizeof(box)) != 0;
+    }
+    const size_t heapFrames = GesturePool().HeapFrames() - heapBefore;
+
+    const double sent = static_cast<double>(gestures) * (PerGesture - 1);
+    wchar_t msg[192];
+    swprintf_s(msg, L"gesture: %.1f ns per event resumed, %.1f ns per direct handler call; %.0f ns to start and end a gesture\n",
+        coroutine / sent, direct / sent, startEnd / gestures);
+    OutputDebugString(msg);
+    swprintf_s(msg, L"gesture: %lld gestures, frames up to %zu bytes in %zu-byte blocks, %zu from the heap, %zu disagreements\n",
+        gestures, GesturePool().LargestFrame(), GestureFramePool::BlockBytes, heapFrames, mismatches);
+    OutputDebugString(msg);
+    return mismatches == 0 && heapFrames == 0 ? 0 : 1;
+}
+
+
+// one step of a recognizer trace: a pointer sample ('d'own, 'm'ove, 'u'p) or a long-press timer tick ('t')
+struct TraceStep
+{
+    char kind;
+    float x, y;
+    DWORD time;
+};
+
+struct RecognizerTrace
+{
+    const wchar_t* name;
+    std::vector<TraceStep> steps;
+    std::vector<GestureKind> expected;
+};
+
+// traces of pointer input at a mouse's 8 ms report interval, with the gestures the window's settings must find in them
+std::vector<RecognizerTrace> RecognizerTraces()
+{
+    typedef GestureKind G;
+    return {
+        { L"click", { { 'd', 100, 100, 1000 }, { 'm', 101, 100, 1008 }, { 'u', 101, 101, 1090 } }, { G::Click } },
+        { L"double-click", { { 'd', 100, 100, 1000 }, { 'u', 100, 100, 1080 }, { 'd', 101, 100, 1250 }, { 'u', 101, 100, 1320 } },
+            { G::Click, G::DoubleClick } },
+        { L"two slow clicks", { { 'd', 100, 100, 1000 }, { 'u', 100, 100, 1080 }, { 'd', 100, 100, 1700 }, { 'u', 100, 100, 1760 } },
+            { G::Click, G::Click } },
+        { L"clicks apart", { { 'd', 100, 100, 1000 }, { 'u', 100, 100, 1080 }, { 'd', 140, 100, 1200 }, { 'u', 140, 100, 1260 } },
+            { G::Click, G::Click } },
+        { L"triple click", { { 'd', 100, 100, 1000 }, { 'u', 100, 100, 1060 }, { 'd', 100, 100, 1200 }, { 'u', 100, 100, 1260 },
+            { 'd', 100, 100, 1400 }, { 'u', 100, 100, 1460 } }, { G::Click, G::DoubleClick, G::Click } },
+        { L"slow drag", { { 'd', 100, 100, 0 }, { 'm', 103, 100, 16 }, { 'm', 106, 100, 32 }, { 'm', 109, 100, 48 },
+            { 'm', 112, 101, 64 }, { 'm', 115, 101, 80 }, { 'u', 115, 101, 400 } }, { G::Drag } },
+        { L"flick", { { 'd', 100, 100, 0 }, { 'm', 120, 100, 8 }, { 'm', 140, 101, 16 }, { 'm', 160, 101, 24 },
+            { 'm', 180, 102, 32 }, { 'u', 200, 102, 40 } }, { G::Drag, G::Flick } },
+        { L"long-press", { { 'd', 100, 100, 0 }, { 'm', 101, 100, 300 }, { 't', 0, 0, 500 }, { 't', 0, 0, 800 },
+            { 't', 0, 0, 900 }, { 'u', 101, 100, 1200 } }, { G::LongPress } },
+        { L"early release", { { 'd', 100, 100, 0 }, { 't', 0, 0, 500 }, { 'u', 100, 100, 600 }, { 't', 0, 0, 800 } }, { G::Click } },
+        { L"long-press, then a click", { { 'd', 100, 100, 0 }, { 't', 0, 0, 800 }, { 'u', 100, 100, 900 },
+            { 'd', 100, 100, 1000 }, { 'u', 100, 100, 1050 } }, { G::LongPress, G::Click } },
+    };
+}
+
+/*
+ - the gesture recognizer on recorded traces and at full rate: UserInputWin32.exe /recognizer <samples>
+ - every trace of 'RecognizerTraces' must produce exactly its gestures, in order; the recognizer takes the time
+   from its samples and ticks, so a trace always gives the same answer
+ - then '<samples>' random presses of 2 to 64 samples each (taps, drags and flicks, in 1 to 16 ms steps) are fed
+   through 'AddSample' and timed
+ - exits with 1 if a trace gives other gestures than expected
+*/
+int RunRecognizer(int argc, wchar_t** argv)
+{
+    const long long samples = _wtoi64(argv[2]);
+    if (samples <= 0)
+    {
+        return 1;
+    }
+
+    const RecognizerSettings settings = { 4.0f, 500, 800, 1000.0f, 100 }; // as in the window
+    static const wchar_t* const names[] = { L"click", L"double-click", L"drag", L"flick", L"long-press" };
+    wchar_t msg[256];
+    int failures = 0;
+    for (const RecognizerTrace& trace : RecognizerTraces())
+    {
+        GestureRecognizer recognizer(settings);
+        std::vector<GestureKind> found;
+        auto emit = [&](const RecognizedGesture& g) { found.push_back(g.kind); };
+        for (const TraceStep& step : trace.steps)
+        {
+            if (step.kind == 't')
+            {
+                recognizer.Tick(step.time, emit);
+                continue;
+            }
+            const PointerEventType type = step.kind == 'd' ? PointerEventType::Down : step.kind == 'u' ? PointerEventType::Up : PointerEventType::Move;
+            recognizer.AddSample({ type, D2D1::Point2F(step.x, step.y), step.time }, emit);
+        }
+
+        if (found != trace.expected)
+        {
+            failures++;
+            std::wstring got;
+            for (GestureKind kind : found)
+            {
+                got += names[static_cast<int>(kind)];
+                got += L" ";
+            }
+            swprintf_s(msg, L"recognizer: trace '%s' gave %zu gestures, expected %zu: %s\n", trace.name, found.size(),
+                trace.expected.size(), got.empty() ? L"none" : got.c_str());
+            OutputDebugString(msg);
+        }
+    }
+
+    std::mt19937 random(1);
+    std::vector<PointerSample> stream;
+    stream.reserve(static_cast<size_t>(samples));
+    DWORD time = 0;
+    while (stream.size() < static_cast<size_t>(samples))
+    {
+        const int length = 2 + static_cast<int>(random() % 63);
+        const float speed = static_cast<float>(random() % 40); // DIPs per step, 0 for a tap
+        D2D1_POINT_2F pt = D2D1::Point2F(static_cast<float>(random() % 800), static_cast<float>(random() % 600));
+        for (int i = 0; i < length && stream.size() < static_cast<size_t>(samples); i++)
+        {
+            const PointerEventType type = i == 0 ? PointerEventType::Down : i == length - 1 ? PointerEventType::Up : PointerEventType::Move;
+            stream.push_back({ type, pt, time });
+            pt.x += speed;
+            time += 1 + random() % 16;
+        }
+        time += random() % 1000;
+    }
+
+    GestureRecognizer recognizer(settings);
+    size_t counts[5] = {};
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (const PointerSample& sample : stream)
+    {
+        recognizer.AddSample(sample, [&](const RecognizedGesture& g) { counts[static_cast<int>(g.kind)]++; });
+    }
+    const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / stream.size();
+
+    swprintf_s(msg, L"recognizer: %zu traces, %d failed\n", RecognizerTraces().size(), failures);
+    OutputDebugString(msg);
+    swprintf_s(msg, L"recognizer: %.1f ns per sample over %zu samples (%.0f million per second); %zu clicks, %zu double-clicks, "
+        L"%zu drags, %zu flicks\n", ns, stream.size(), 1000.0 / ns, counts[0], counts[1], counts[2], counts[3]);
+    OutputDebugString(msg);
+    return failures == 0 ? 0 : 1;
+}
+
+
+#ifdef PROFILE_ZONES
+/*
+ - what a profiling zone costs on this machine: UserInputWin32.exe /profile <zones> (profiling builds only)
+ - times '<zones>' empty zones, and as many pairs of bare time stamp counter reads, the floor under a zone
+ - then writes profile.json twice and reads each back: the first trace must hold the newest zones, as many as the
+   ring keeps (one slot fewer than it holds, as the slot being written next may be torn), each well formed, of
+   non-negative duration and in order; the second must be empty, its zones having gone into the first
+ - exits with 1 if either trace is wrong
+*/
+int RunProfile(int argc, wchar_t** argv)
+{
+    const long long zones = _wtoi64(argv[2]);
+    if (zones <= 0)
+    {
+        return 1;
+    }
+
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+    for (long long i = 0; i < zones; i++)
+    {
+        PROFILE_ZONE("empty");
+    }
+    const double zone = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / zones;
+
+    uint64_t sum = 0;
+    start = Clock::now();
+    for (long long i = 0; i < zones; i++)
+    {
+        const uint64_t begin = __rdtsc();
+        sum += __rdtsc() - begin;
+    }
+    const double rdtsc = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / zones;
+
+    wchar_t msg[160];
+    swprintf_s(msg, L"profiler: %.1f ns per zone, %.1f ns per pair of counter reads (%llu ticks between them on average)\n",
+        zone, rdtsc, static_cast<unsigned long long>(sum / zones));
+    OutputDebugString(msg);
+
+    // the zones in a trace, one per line; false if a line is not a zone as 'WriteChromeTrace' writes it
+    auto read = [](size_t& events)
+    {
+        std::ifstream file(L"profile.json");
+        std::string line;
+        events = 0;
+        double previous = -1e300;
+        bool ok = static_cast<bool>(std::getline(file, line)) && line == "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        while (ok && std::getline(file, line) && line != "]}")
+        {
+            if (line.empty())
+            {
+                continue; // the line break before the closing bracket
+            }
+            double ts = 0, dur = 0;
+            char name[16] = {};
+            ok = sscanf_s(line.c_str(), "{\"name\":\"%15[^\"]\",\"ph\":\"X\",\"pid\":1,\"tid\":%*u,\"ts\":%lf,\"dur\":%lf}",
+                name, static_cast<unsigned>(sizeof(name)), &ts, &dur) == 3 && strcmp(name, "empty") == 0 && dur >= 0 && ts >= previous;
+            previous = ts;
+            events++;
+        }
+        return ok && line == "]}";
+    };
+
+    const size_t expected = static_cast<unsigned long long>(zones) >= ProfileBuffer::Capacity ?
+        ProfileBuffer::Capacity - 1 : static_cast<size_t>(zones);
+    size_t first = 0, second = 0;
+    const bool firstOk = Profiler::WriteChromeTrace(L"profile.json") && read(first) && first == expected;
+    const bool secondOk = Profiler::WriteChromeTrace(L"profile.json") && read(second) && second == 0;
+    swprintf_s(msg, L"profiler: first trace %zu zones of %zu expected (%s), second %zu (%s)\n",
+        first, expected, firstOk ? L"ok" : L"WRONG", second, secondOk ? L"ok" : L"WRONG");
+    OutputDebugString(msg);
+    return firstOk && secondOk ? 0 : 1;
+}
+#endif
+
+
+/*
+ - many pen/touch contacts at once, without a touch screen: UserInputWin32.exe /pointers <contacts>
+ - a synthetic driver plays the pointer messages of up to <contacts> pointers through 'PointerContacts::OnMessage',
+   as 'OnPointer' does: each pointer puts a contact down, drags it along a random line for 10 .. 60 frames, lifts it
+   and comes down again a little later under a new id; every frame moves every pointer, in a shuffled order, then
+   computes the ellipses of all contacts in one pass, as 'OnPaint' does
+ - runs with 1, 2, 4, ... <contacts> pointers, 2000 frames each, and logs the time per frame: all messages plus the
+   ellipse pass, and the ellipse pass alone
+ - a plain model of every pointer runs alongside; a pointer that comes down while 'MaxContacts' contacts are held is
+   ignored, and so are its moves and its release
+ - exits with 1 if the ellipses of a frame, or the ellipse a contact leaves behind, ever differ from the model's
+*/
+int RunPointers(int argc, wchar_t** argv)
+{
+    const int pointerCount = _wtoi(argv[2]);
+    if (pointerCount <= 0)
+    {
+        return 1;
+    }
+
+    struct Pointer
+    {
+        UINT32 id;      // 0 while lifted
+        bool accepted;  // came down while a contact slot was free
+        int framesLeft; // until it lifts, or while lifted, until it comes down again
+        D2D1_POINT_2F anchor, pos, step;
+    };
+
+    // the ellipse of a contact, constructed as 'PointerContacts' does, so the results compare exactly
+    auto modelEllipse = [](const Pointer& p)
+    {
+        const float width = (p.pos.x - p.anchor.x) / 2, height = (p.pos.y - p.anchor.y) / 2;
+        return D2D1::Ellipse(D2D1::Point2F(p.anchor.x + width, p.anchor.y + height), width, height);
+    };
+    auto before = [](const D2D1_ELLIPSE& a, const D2D1_ELLIPSE& b)
+    {
+        if (a.point.x != b.point.x) return a.point.x < b.point.x;
+        if (a.point.y != b.point.y) return a.point.y < b.point.y;
+        if (a.radiusX != b.radiusX) return a.radiusX < b.radiusX;
+        return a.radiusY < b.radiusY;
+    };
+    auto same = [](const D2D1_ELLIPSE& a, const D2D1_ELLIPSE& b)
+    {
+        return a.point.x == b.point.x && a.point.y == b.point.y && a.radiusX == b.radiusX && a.radiusY == b.radiusY;
+    };
+
+    std::vector<int> counts;
+    for (int n = 1; n < pointerCount; n *= 2)
+    {
+        counts.push_back(n);
+    }
+    counts.push_back(pointerCount);
+
+    const int Frames = 2000;
+    typedef std::chrono::steady_clock Clock;
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> coord(0, 800), delta(-4.0f, 4.0f);
+    std::uniform_int_distribution<int> heldFrames(10, 60), liftedFrames(1, 20);
+    size_t failures = 0;
+
+    for (int n : counts)
+    {
+        PointerContacts contacts;
+        std::vector<Pointer> pointers(n, Pointer{ 0, false, 0, D2D1::Point2F(0, 0), D2D1::Point2F(0, 0), D2D1::Point2F(0, 0) });
+        std::vector<int> order(n);
+        for (int i = 0; i < n; i++)
+        {
+            order[i] = i;
+        }
+        std::vector<D2D1_ELLIPSE> expected, actual;
+        float cx[PointerContacts::MaxContacts], cy[PointerContacts::MaxContacts];
+        float rx[PointerContacts::MaxContacts], ry[PointerContacts::MaxContacts];
+        UINT32 nextId = 1;
+        size_t accepted = 0, released = 0, mismatches = 0, contactFrames = 0;
+        double frameUs = 0, passUs = 0;
+
+        for (int frame = 0; frame < Frames; frame++)
+        {
+            std::shuffle(order.begin(), order.end(), random);
+            const Clock::time_point start = Clock::now();
+            for (int k : order)
+            {
+                Pointer& p = pointers[k];
+                D2D1_ELLIPSE shape; // what a released contact leaves behind
+                if (p.id == 0)
+                {
+                    if (--p.framesLeft > 0)
+                    {
+                        continue;
+                    }
+                    p.id = nextId++;
+                    p.accepted = accepted < PointerContacts::MaxContacts;
+                    accepted += p.accepted;
+                    p.anchor = p.pos = D2D1::Point2F(coord(random), coord(random));
+                    p.step = D2D1::Point2F(delta(random), delta(random));
+                    p.framesLeft = heldFrames(random);
+                    contacts.OnMessage(WM_POINTERDOWN, p.id, p.pos, shape);
+                    continue;
+                }
+
+                p.pos = D2D1::Point2F(p.pos.x + p.step.x, p.pos.y + p.step.y);
+                if (--p.framesLeft > 0)
+                {
+                    contacts.OnMessage(WM_POINTERUPDATE, p.id, p.pos, shape);
+                    continue;
+                }
+                const bool up = contacts.OnMessage(WM_POINTERUP, p.id, p.pos, shape);
+                mismatches += up != p.accepted || (up && !same(shape, modelEllipse(p)));
+                released += up;
+                accepted -= p.accepted;
+                p.id = 0;
+                p.framesLeft = liftedFrames(random);
+            }
+            const Clock::time_point pass = Clock::now();
+            contacts.Ellipses(cx, cy, rx, ry);
+            const Clock::time_point end = Clock::now();
+            frameUs += std::chrono::duration<double, std::micro>(end - start).count();
+            passUs += std::chrono::duration<double, std::micro>(end - pass).count();
+            contactFrames += contacts.Count();
+
+            // the contacts are kept in no particular order, so both sides are sorted before comparing
+            expected.clear();
+            actual.clear();
+            for (const Pointer& p : pointers)
+            {
+                if (p.id != 0 && p.accepted)
+                {
+                    expected.push_back(modelEllipse(p));
+                }
+            }
+            for (size_t i = 0; i < contacts.Count(); i++)
+            {
+                actual.push_back(D2D1::Ellipse(D2D1::Point2F(cx[i], cy[i]), rx[i], ry[i]));
+            }
+            std::sort(expected.begin(), expected.end(), before);
+            std::sort(actual.begin(), actual.end(), before);
+            mismatches += !std::equal(expected.begin(), expected.end(), actual.begin(), actual.end(), same);
+        }
+
+        wchar_t msg[192];
+        swprintf_s(msg, L"pointers, %d at once: %.1f contacts held on average, %.2f us per frame, ellipse pass %.3f us, %zu released, %zu mismatches\n",
+            n, static_cast<double>(contactFrames) / Frames, frameUs / Frames, passUs / Frames, released, mismatches);
+        OutputDebugString(msg);
+        failures += mismatches;
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+
+/*
+ - the software renderer across thread counts: UserInputWin32.exe /softrender <threads>
+ - a fixed scene, 100000 shapes of F6 over a 1920 x 1080 frame on top of a few degenerate ones (edges far outside the
+   int range, an infinite radius, a removed shape), is rendered on the calling thread alone, then with pools of
+   1 .. <threads> threads; one frame to warm up, then 20 timed frames each
+ - logs the time per frame and the speed-up over the calling thread alone for each thread count
+ - exits with 1 if a pool renders any pixel differently from the calling thread, or if a timed frame calls
+   'operator new' on the calling thread, which bins the shapes and deals the tiles to the pool (counted in HEAPWATCH
+   builds only)
+*/
+int RunSoftRender(int argc, wchar_t** argv)
+{
+    const int threads = _wtoi(argv[2]);
+    if (threads <= 0)
+    {
+        return 1;
+    }
+
+    const UINT32 Width = 1920, Height = 1080, Background = 0xFFFFFFFF;
+    const int Frames = 20;
+    BatchArrays shapes(std::pmr::get_default_resource());
+    shapes.Push(0, 960, 540, 1e30f, 1e30f, Scene::Palette[1]);
+    shapes.Push(1, -1e30f, 1e30f, 2e30f, 2e30f, Scene::Palette[2]);
+    shapes.Push(2, 960, 540, std::numeric_limits<float>::infinity(), 20, Scene::Palette[3]);
+    shapes.Push(3, std::numeric_limits<float>::quiet_NaN(), 540, 10, 10, Scene::Palette[4]);
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> x(0, static_cast<float>(Width)), y(0, static_cast<float>(Height)), radius(1.0f, 8.0f);
+    for (uint32_t i = 4; i < 100004; i++)
+    {
+        shapes.Push(i, x(random), y(random), radius(random), radius(random), Scene::Palette[random() % ARRAYSIZE(Scene::Palette)]);
+    }
+    const EllipseBatch batch = shapes.Batch();
+
+    // mean ms per timed frame; 'allocations' gets the calling thread's 'operator new' calls during them
+    typedef std::chrono::steady_clock Clock;
+    auto measure = [&](SoftwareRenderer& renderer, size_t& allocations)
+    {
+        renderer.Resize(Width, Height);
+        renderer.Render(batch, 1, 1, 0, 0, Background);
+        HeapWatch watch;
+        const Clock::time_point start = Clock::now();
+        for (int f = 0; f < Frames; f++)
+        {
+            renderer.Render(batch, 1, 1, 0, 0, Background);
+        }
+        allocations = watch.Allocations();
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count() / Frames;
+    };
+
+    wchar_t msg[160];
+    if (!HeapWatch::Counting)
+    {
+        OutputDebugString(L"softrender: allocations are not counted, HEAPWATCH is not defined\n");
+    }
+    size_t allocations = 0, failures = 0;
+    SoftwareRenderer reference;
+    const double alone = measure(reference, allocations);
+    swprintf_s(msg, L"softrender: calling thread alone %.2f ms per frame, %zu allocations\n", alone, allocations);
+    OutputDebugString(msg);
+    failures += allocations > 0;
+
+    for (int t = 1; t <= threads; t++)
+    {
+        WorkStealingPool pool(static_cast<unsigned>(t));
+        SoftwareRenderer renderer(&pool);
+        const double ms = measure(renderer, allocations);
+        const bool same = std::equal(renderer.Pixels(), renderer.Pixels() + static_cast<size_t>(Width) * Height, reference.Pixels());
+        swprintf_s(msg, L"softrender: %d threads %.2f ms per frame (%.2fx), %zu allocations, %s\n",
+            t, ms, alone / ms, allocations, same ? L"same pixels" : L"PIXELS DIFFER");
+        OutputDebugString(msg);
+        failures += allocations > 0 || !same;
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+
+/*
+ - hover hit testing on a static scene: UserInputWin32.exe /hover <shapes>
+ - random shapes over an 800 x 600 view as F6 adds them, one in ten with a zero radius (no area, so never hit);
+   100000 random points go through 'HitTest' (block boxes, 8 ellipses per instruction) and 'Pick' (the grid cell),
+   and the first 1000 also through a plain loop over every shape from the top, the reference
+ - on a CPU with AVX2, 'HitTest' runs again on the scalar path (see simd.h), which other CPUs take
+ - exits with 1 if they ever disagree
+*/
+int RunHover(int argc, wchar_t** argv)
+{
+    const long long shapes = _wtoi64(argv[2]);
+    if (shapes <= 0)
+    {
+        return 1;
+    }
+
+    Scene scene;
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> x(0, 800), y(0, 600), radius(1.0f, 8.0f);
+    for (long long i = 0; i < shapes; i++)
+    {
+        const float rx = random() % 10 == 0 ? 0.0f : radius(random);
+        scene.Add(D2D1::Ellipse(D2D1::Point2F(x(random), y(random)), rx, radius(random)), Scene::Palette[random() % ARRAYSIZE(Scene::Palette)]);
+    }
+
+    const int Points = 100000, Checked = 1000;
+    std::vector<D2D1_POINT_2F> points(Points);
+    for (D2D1_POINT_2F& pt : points)
+    {
+        pt = D2D1::Point2F(x(random), y(random));
+    }
+
+    typedef std::chrono::steady_clock Clock;
+    std::vector<ptrdiff_t> hits(Points), picks(Points);
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < Points; i++)
+    {
+        hits[i] = scene.HitTest(points[i]);
+    }
+    const double hitTest = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / Points;
+
+    start = Clock::now();
+    for (int i = 0; i < Points; i++)
+    {
+        picks[i] = scene.Pick(points[i]);
+    }
+    const double pick = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / Points;
+
+    size_t mismatches = 0, hit = 0;
+    for (int i = 0; i < Points; i++)
+    {
+        mismatches += hits[i] != picks[i];
+        hit += hits[i] >= 0;
+    }
+
+    start = Clock::now();
+    for (int i = 0; i < Checked; i++)
+    {
+        ptrdiff_t top = -1;
+        for (size_t j = scene.Count(); j-- > 0; )
+        {
+            if (scene.Contains(j, points[i]))
+            {
+                top = static_cast<ptrdiff_t>(j);
+                break;
+            }
+        }
+        mismatches += top != hits[i];
+    }
+    const double linear = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / Checked;
+
+    wchar_t msg[192];
+    swprintf_s(msg, L"hover, %lld shapes: %.2f us per HitTest, %.2f us per Pick, %.1f us per linear scan; %zu of %d points hit a shape\n",
+        shapes, hitTest, pick, linear, hit, Points);
+    OutputDebugString(msg);
+
+    if (Simd::Avx2)
+    {
+        Simd::Avx2 = false;
+        start = Clock::now();
+        for (int i = 0; i < Points; i++)
+        {
+            mismatches += scene.HitTest(points[i]) != hits[i];
+        }
+        const double scalar = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / Points;
+        Simd::Avx2 = true;
+
+        swprintf_s(msg, L"hover: %.2f us per HitTest without AVX2\n", scalar);
+    }
+    else
+    {
+        swprintf_s(msg, L"hover: this CPU has no AVX2, HitTest ran on the scalar path\n");
+    }
+    OutputDebugString(msg);
+    swprintf_s(msg, L"hover: %zu disagreements between HitTest, Pick and the linear scan\n", mismatches);
+    OutputDebugString(msg);
+    return mismatches == 0 ? 0 : 1;
+}
+
+
+/*
+ - moving shapes continuously in a large scene: UserInputWin32.exe /move <shapes>
+ - the shapes of Ctrl+F6 (a few DIPs across, over 10 x 10 views of 800 x 600); 1000 of them are dragged at once,
+   each taking 1000 random steps of up to 8 DIPs, so they keep crossing grid cells; every step moves the shape
+   ('Scene::Set', which updates the grid) and picks it again at its new center, as the select tool does
+ - exits with 1 if a pick at a moved shape's center disagrees with 'HitTest', or if the grid holds more cells
+   than one built from scratch over the final positions (cells left behind by shapes that moved on)
+*/
+int RunMove(int argc, wchar_t** argv)
+{
+    const long long shapes = _wtoi64(argv[2]);
+    if (shapes <= 0)
+    {
+        return 1;
+    }
+
+    Scene scene;
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> x(0, 8000), y(0, 6000), radius(1.0f, 8.0f), step(-8.0f, 8.0f);
+    for (long long i = 0; i < shapes; i++)
+    {
+        scene.Add(D2D1::Ellipse(D2D1::Point2F(x(random), y(random)), radius(random), radius(random)), Scene::Palette[random() % ARRAYSIZE(Scene::Palette)]);
+    }
+    const size_t cellsBefore = scene.Grid().CellCount();
+
+    const int Dragged = 1000, Steps = 1000;
+    std::vector<size_t> dragged(Dragged);
+    for (size_t& shape : dragged)
+    {
+        shape = random() % scene.Count();
+    }
+
+    typedef std::chrono::steady_clock Clock;
+    double moveSeconds = 0, pickSeconds = 0;
+    size_t mismatches = 0;
+    for (int s = 0; s < Steps; s++)
+    {
+        for (size_t shape : dragged)
+        {
+            D2D1_ELLIPSE e = scene.Get(shape);
+            e.point = D2D1::Point2F(e.point.x + step(random), e.point.y + step(random));
+
+            Clock::time_point start = Clock::now();
+            scene.Set(shape, e);
+            const Clock::time_point moved = Clock::now();
+            const ptrdiff_t picked = scene.Pick(e.point);
+            const Clock::time_point end = Clock::now();
+            moveSeconds += std::chrono::duration<double>(moved - start).count();
+            pickSeconds += std::chrono::duration<double>(end - moved).count();
+
+            // checking every pick against the slow path would dominate the run; one step in 100 is enough
+            if (s % 100 == 0)
+            {
+                mismatches += picked != scene.HitTest(e.point);
+            }
+        }
+    }
+
+    Scene rebuilt;
+    for (size_t i = 0; i < scene.Count(); i++)
+    {
+        rebuilt.Add(scene.Get(i), scene.Color(i));
+    }
+    const size_t cellsAfter = scene.Grid().CellCount(), cellsExpected = rebuilt.Grid().CellCount();
+
+    // the clock is read around every call, so the figures include about two clock reads each
+    const double moves = static_cast<double>(Dragged) * Steps;
+    wchar_t msg[192];
+    swprintf_s(msg, L"move, %lld shapes: %.0f ns per move, %.0f ns per pick over %.0f moves\n",
+        shapes, moveSeconds * 1e9 / moves, pickSeconds * 1e9 / moves, moves);
+    OutputDebugString(msg);
+    swprintf_s(msg, L"move: grid cells %zu before, %zu after (table of %zu slots), %zu when rebuilt; %zu picks disagreed with HitTest\n",
+        cellsBefore, cellsAfter, scene.Grid().TableSize(), cellsExpected, mismatches);
+    OutputDebugString(msg);
+    return mismatches == 0 && cellsAfter == cellsExpected ? 0 : 1;
+}
+
+
+// a message-only window that counts WM_USER and does nothing else, for timing the dispatch in 'BaseWindow::WindowProc'
+class ProbeWindow : public BaseWindow<ProbeWindow>
+{
+public:
+    size_t received = 0;
+
+    PCWSTR  ClassName() const { return L"Probe Window Class"; }
+    LRESULT HandleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
+    {
+        if (uMsg == WM_USER)
+        {
+            received++;
+            return 0;
+        }
+        return DefWindowProc(m_hwnd, uMsg, wParam, lParam);
+    }
+};
+
+/*
+ - per-message cost of 'BaseWindow::WindowProc' with and without the window instance cache: UserInputWin32.exe /windowproc <windows>
+ - messages go to the windows in bursts of 64 (as input to one window arrives) and one window after the other
+   (the recent-window array misses, so the table answers); 'WindowProc' is called directly, which isolates the lookup,
+   and through 'SendMessage', which adds what user32 costs anyway
+ - afterwards every window is destroyed and the cache must be empty again
+*/
+int RunWindowProc(int argc, wchar_t** argv)
+{
+    const int count = _wtoi(argv[2]);
+    if (count <= 0)
+    {
+        return 1;
+    }
+
+    std::vector<std::unique_ptr<ProbeWindow>> windows;
+    for (int i = 0; i < count; i++)
+    {
+        windows.push_back(std::make_unique<ProbeWindow>());
+        if (!windows.back()->Create(L"Probe", 0, 0, CW_USEDEFAULT, CW_USEDEFAULT, CW_USEDEFAULT, CW_USEDEFAULT, HWND_MESSAGE))
+        {
+            return 1;
+        }
+    }
+
+    const int Messages = 1000000;
+    WindowInstanceCache& cache = WindowInstanceCache::ForThread();
+    struct Pattern { const wchar_t* name; int burst; };
+    const Pattern patterns[] = { { L"bursts of 64", 64 }, { L"round robin", 1 } };
+    for (const Pattern& pattern : patterns)
+    {
+        for (int sent = 0; sent < 2; sent++)
+        {
+            double ns[2]; // without, with the cache
+            for (int cached = 0; cached < 2; cached++)
+            {
+                cache.SetEnabled(cached != 0);
+                const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                for (int i = 0; i < Messages; i++)
+                {
+                    const HWND hwnd = windows[(i / pattern.burst) % count]->Window();
+                    if (sent)
+                    {
+                        SendMessage(hwnd, WM_USER, 0, 0);
+                    }
+                    else
+                    {
+                        ProbeWindow::WindowProc(hwnd, WM_USER, 0, 0);
+                    }
+                }
+                ns[cached] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / Messages;
+            }
+
+            wchar_t msg[192];
+            swprintf_s(msg, L"WindowProc, %d windows, %s, %s: %.1f ns per message uncached, %.1f ns cached\n", count,
+                pattern.name, sent ? L"SendMessage" : L"direct call", ns[0], ns[1]);
+            OutputDebugString(msg);
+        }
+    }
+
+    size_t received = 0;
+    for (const std::unique_ptr<ProbeWindow>& window : windows)
+    {
+        received += window->received;
+        DestroyWindow(window->Window());
+    }
+    wchar_t msg[128];
+    swprintf_s(msg, L"WindowProc: %zu messages handled, %zu windows left in the cache after destroying them all\n",
+        received, cache.Size());
+    OutputDebugString(msg);
+    return cache.Size() == 0 && received == static_cast<size_t>(Messages) * 8 ? 0 : 1;
+}
+
+
+/*
+ - self-check of 'WindowInstanceCache' against a std::map: UserInputWin32.exe /windowcache <operations>
+ - random inserts, erases and lookups over a few thousand handles; most are small consecutive numbers, as real handles
+   are, and some are far apart, so both the recent-window array and long probe chains in the table get exercised
+ - every lookup must agree with the map, and so must the size after every operation; now and then the cache is
+   switched off and on again, which must empty it
+ - no windows are created: the cache only compares handles, so any value but NULL stands in for one
+*/
+int RunWindowCache(int argc, wchar_t** argv)
+{
+    const long long operations = _wtoi64(argv[2]);
+    if (operations <= 0)
+    {
+        return 1;
+    }
+
+    WindowInstanceCache cache;
+    std::map<HWND, void*> reference;
+    std::mt19937 random(1);
+    wchar_t msg[160];
+    for (long long i = 0; i < operations; i++)
+    {
+        const uint32_t op = random() % 16;
+        const uintptr_t handle = random() % 8 == 0 ? (static_cast<uintptr_t>(random() % 64) << 20) + 4 : 4 * (1 + random() % 3000);
+        const HWND hwnd = reinterpret_cast<HWND>(handle);
+        switch (op < 6 ? 0 : op < 10 ? 1 : op < 15 ? 2 : 3)
+        {
+        case 0:
+        {
+            void* instance = reinterpret_cast<void*>(static_cast<uintptr_t>(random()) | 1);
+            cache.Insert(hwnd, instance);
+            reference[hwnd] = instance;
+            break;
+        }
+        case 1:
+            cache.Erase(hwnd);
+            reference.erase(hwnd);
+            break;
+        case 2:
+        {
+            const std::map<HWND, void*>::const_iterator found = reference.find(hwnd);
+            void* expected = found == reference.end() ? NULL : found->second;
+            if (cache.Find(hwnd) != expected)
+            {
+                swprintf_s(msg, L"window cache: operation %lld, lookup of 0x%llx disagrees with the map\n", i,
+                    static_cast<unsigned long long>(handle));
+                OutputDebugString(msg);
+                return 1;
+            }
+            break;
+        }
+        default:
+            if (random() % 4096 == 0)
+            {
+                cache.SetEnabled(false);
+                reference.clear();
+                cache.SetEnabled(true);
+            }
+            break;
+        }
+
+        if (cache.Size() != reference.size())
+        {
+            swprintf_s(msg, L"window cache: operation %lld, %zu entries cached, %zu in the map\n", i, cache.Size(), reference.size());
+            OutputDebugString(msg);
+            return 1;
+        }
+    }
+
+    swprintf_s(msg, L"window cache: %lld operations agree with the map, %zu entries left\n", operations, cache.Size());
+    OutputDebugString(msg);
+    return 0;
+}
+
+
+// the caret and selection rules of 'TextBuffer', on a std::wstring: the reference '/typing' checks the buffer against
+struct TextModel
+{
+    std::wstring text;
+    size_t caret = 0, anchor = 0;
+
+    static bool IsPair(const std::wstring& s, size_t low) { return low > 0 && low < s.size() && s[low] >= 0xDC00 && s[low] <= 0xDFFF && s[low - 1] >= 0xD800 && s[low - 1] <= 0xDBFF; }
+    size_t First() const { return std::min(caret, anchor); }
+    size_t Last() const { return std::max(caret, anchor); }
+
+    void Insert(const wchar_t* s, size_t count)
+    {
+        text.replace(First(), Last() - First(), s, count);
+        caret = anchor = First() + count;
+    }
+    void Backspace()
+    {
+        if (caret != anchor)
+        {
+            text.erase(First(), Last() - First());
+            caret = anchor = First();
+        }
+        else if (caret > 0)
+        {
+            const size_t first = caret - (IsPair(text, caret - 1) ? 2 : 1);
+            text.erase(first, caret - first);
+            caret = anchor = first;
+        }
+    }
+    void MoveLeft(bool extend)
+    {
+        if (!extend && caret != anchor)
+        {
+            caret = anchor = First();
+            return;
+        }
+        if (caret > 0)
+        {
+            caret -= IsPair(text, caret - 1) ? 2 : 1;
+        }
+        anchor = extend ? anchor : caret;
+    }
+    void MoveRight(bool extend)
+    {
+        if (!extend && caret != anchor)
+        {
+            caret = anchor = Last();
+            return;
+        }
+        if (caret < text.size())
+        {
+            caret += IsPair(text, caret + 1) ? 2 : 1;
+        }
+        anchor = extend ? anchor : caret;
+    }
+    void MoveLineStart()
+    {
+        const size_t newline = caret == 0 ? std::wstring::npos : text.rfind(L'\n', caret - 1);
+        caret = anchor = newline == std::wstring::npos ? 0 : newline + 1;
+    }
+    void MoveLineEnd()
+    {
+        caret = anchor = std::min(text.find(L'\n', caret), text.size());
+    }
+};
+
+/*
+ - the text buffer under sustained typing and large pastes: UserInputWin32.exe /typing <keystrokes> <paste MB>
+ - typing: one 'Insert' per character at a caret that keeps moving (arrows, Home and End, a line break every 60 or so
+   characters, some Backspaces, and Shift+arrows now and then, so the next character replaces a selection); one
+   character in 50 is outside the BMP, a surrogate pair
+ - pasting: a text of <paste MB> megabytes, one character in 4 a surrogate pair, goes in with one 'Insert' over a
+   selection in the middle of what was typed, then again at the end; 10000 keystrokes follow on the large text
+ - every step is mirrored on a 'std::wstring' ('TextModel'); the clock is read around every 'Insert' for the slowest
+   one, so the typing figures include about two clock reads each
+ - exits with 1 if the length, caret or selection ever differ from the reference, or the text does (compared every
+   4096 keystrokes and after each paste)
+*/
+int RunTyping(int argc, wchar_t** argv)
+{
+    const long long keystrokes = _wtoi64(argv[2]);
+    const long long pasteMegabytes = _wtoi64(argv[3]);
+    if (keystrokes <= 0 || pasteMegabytes <= 0)
+    {
+        return 1;
+    }
+
+    typedef std::chrono::steady_clock Clock;
+    TextBuffer buffer;
+    TextModel model;
+    std::mt19937 random(1);
+    size_t mismatches = 0;
+    std::wstring copy;
+
+    auto check = [&](bool wholeText)
+    {
+        bool ok = buffer.Length() == model.text.size() && buffer.Caret() == model.caret &&
+            buffer.SelectionStart() == model.First() && buffer.SelectionEnd() == model.Last();
+        if (ok && wholeText)
+        {
+            buffer.CopyRange(0, buffer.Length(), copy);
+            ok = copy == model.text;
+        }
+        mismatches += !ok;
+    };
+
+    // returns the slowest 'Insert' in seconds, adding the time of all of them to 'seconds' and their number to 'inserts'
+    auto type = [&](long long count, double& seconds, size_t& inserts)
+    {
+        double slowest = 0;
+        size_t lineLength = 0;
+        for (long long i = 0; i < count && mismatches == 0; i++)
+        {
+            const unsigned roll = random() % 100;
+            if (roll < 2)
+            {
+                buffer.Backspace();
+                model.Backspace();
+            }
+            else if (roll < 6)
+            {
+                buffer.MoveLeft(roll == 5);
+                model.MoveLeft(roll == 5);
+            }
+            else if (roll < 10)
+            {
+                buffer.MoveRight(roll == 9);
+                model.MoveRight(roll == 9);
+            }
+            else if (roll == 10)
+            {
+                buffer.MoveLineStart(false);
+                model.MoveLineStart();
+            }
+            else if (roll == 11)
+            {
+                buffer.MoveLineEnd(false);
+                model.MoveLineEnd();
+            }
+            else
+            {
+                wchar_t typed[2] = { static_cast<wchar_t>(L'a' + random() % 26), 0 };
+                size_t length = 1;
+                if (++lineLength > 60 && random() % 8 == 0)
+                {
+                    typed[0] = L'\n';
+                    lineLength = 0;
+                }
+                else if (random() % 50 == 0)
+                {
+                    typed[0] = static_cast<wchar_t>(0xD83D); // U+1F600 and on
+                    typed[1] = static_cast<wchar_t>(0xDE00 + random() % 0x40);
+                    length = 2;
+                }
+
+                const Clock::time_point start = Clock::now();
+                buffer.Insert(typed, length);
+                const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+                seconds += elapsed;
+                slowest = std::max(slowest, elapsed);
+                inserts++;
+                model.Insert(typed, length);
+            }
+            check(i % 4096 == 4095);
+        }
+        return slowest;
+    };
+
+    double typingSeconds = 0;
+    size_t typed = 0;
+    const double typingSlowest = type(keystrokes, typingSeconds, typed);
+    check(true);
+
+    // the pasted text: words and line breaks, with emoji among them
+    std::wstring paste;
+    const size_t pasteLength = static_cast<size_t>(pasteMegabytes) * 1024 * 1024 / sizeof(wchar_t);
+    paste.reserve(pasteLength);
+    while (paste.size() + 2 <= pasteLength)
+    {
+        const unsigned roll = random() % 16;
+        if (roll < 4)
+        {
+            paste += static_cast<wchar_t>(0xD83D);
+            paste += static_cast<wchar_t>(0xDE00 + random() % 0x40);
+        }
+        else
+        {
+            paste += roll == 4 ? L'\n' : roll == 5 ? L' ' : static_cast<wchar_t>(L'a' + random() % 26);
+        }
+    }
+
+    // a selection of up to 100 code units in the middle of the typed text, reached with the arrow keys
+    buffer.SelectAll();
+    model.caret = model.text.size();
+    model.anchor = 0;
+    buffer.MoveLeft(false);
+    model.MoveLeft(false);
+    while (buffer.Caret() < buffer.Length() / 2)
+    {
+        buffer.MoveRight(false);
+        model.MoveRight(false);
+    }
+    for (int i = 0; i < 100; i++)
+    {
+        buffer.MoveRight(true);
+        model.MoveRight(true);
+    }
+
+    double pasteSeconds[2];
+    for (double& seconds : pasteSeconds)
+    {
+        const Clock::time_point start = Clock::now();
+        buffer.Insert(paste.data(), paste.size());
+        seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        model.Insert(paste.data(), paste.size());
+        check(true);
+
+        // the second paste goes at the end
+        buffer.SelectAll();
+        buffer.MoveRight(false);
+        model.caret = model.anchor = model.text.size();
+    }
+
+    double afterSeconds = 0;
+    size_t typedAfter = 0;
+    const double afterSlowest = type(10000, afterSeconds, typedAfter);
+    check(true);
+
+    wchar_t msg[256];
+    swprintf_s(msg, L"typing, %lld keystrokes: %zu inserts, %.0f ns each, slowest %.1f us\n",
+        keystrokes, typed, typed ? typingSeconds * 1e9 / typed : 0.0, typingSlowest * 1e6);
+    OutputDebugString(msg);
+    swprintf_s(msg, L"typing: pasting %lld MB (%zu code units) took %.1f ms in the middle, %.1f ms at the end (%.0f MB/s)\n",
+        pasteMegabytes, paste.size(), pasteSeconds[0] * 1e3, pasteSeconds[1] * 1e3, pasteMegabytes / pasteSeconds[0]);
+    OutputDebugString(msg);
+    swprintf_s(msg, L"typing: after the pastes, %zu inserts at %.0f ns each, slowest %.1f us; %zu code units in the end\n",
+        typedAfter, typedAfter ? afterSeconds * 1e9 / typedAfter : 0.0, afterSlowest * 1e6, buffer.Length());
+    OutputDebugString(msg);
+    swprintf_s(msg, L"typing: the buffer %s the std::wstring\n", mismatches == 0 ? L"matches" : L"DIFFERS FROM");
+    OutputDebugString(msg);
+    return mismatches == 0 ? 0 : 1;
+}
+
+
+/*
+ - how much of the pointer's path the move messages alone lose, and what recovering it costs: UserInputWin32.exe /pointerhistory
+ - a synthetic 1000 Hz pointer is read through move messages every 16 ms, as when a busy window coalesces every
+   frame's moves, then every 100 ms, as when it stalls; the source keeps the last 64 points like the system's history,
+   so the stalled window gets the newest 63 samples of each gap and loses the rest
+ - exits with 1 if a 16 ms gap, which the history covers, loses a sample, or a 100 ms one does not
+*/
+int RunPointerHistory(int argc, wchar_t** argv)
+{
+    const DWORD intervals[] = { 16, 100 };
+    bool ok = true;
+    for (DWORD messageMs : intervals)
+    {
+        PointerHistoryTimings timings;
+        MeasurePointerHistory(10, messageMs, 1, timings);
+
+        wchar_t msg[192];
+        swprintf_s(msg, L"pointer history, a move every %lu ms: %.1f samples recovered per move, %.0f%% of the path delivered (%.0f%% from the moves alone), %.0f%% of batches overflowed\n",
+            messageMs, timings.samplesPerMessage, timings.fidelity * 100, timings.fidelityWithout * 100, timings.overflowShare * 100);
+        OutputDebugString(msg);
+        swprintf_s(msg, L"pointer history: %.2f us to fetch a batch, %.2f us to feed it to the predictor\n",
+            timings.fetchMicroseconds, timings.feedMicroseconds);
+        OutputDebugString(msg);
+        swprintf_s(msg, L"pointer history: prediction one move ahead off by %.2f pixels from the moves alone, %.2f with the history\n",
+            timings.errorWithout, timings.errorWith);
+        OutputDebugString(msg);
+
+        const bool covered = messageMs < static_cast<DWORD>(MouseHistoryPoints);
+        ok = ok && (covered ? timings.fidelity >= 0.999 && timings.overflowShare == 0 : timings.fidelity < 0.999 && timings.overflowShare > 0);
+    }
+    return ok ? 0 : 1;
+}
+
+
+// decodes a capture into one QOI image per frame: UserInputWin32.exe /play <session.capture> <folder>
+int RunPlay(int argc, wchar_t** argv)
+{
+    CapturePlayer player;
+    if (!player.Open(argv[2]))
+    {
+        return 1;
+    }
+
+    const std::filesystem::path folder = argv[3];
+    std::vector<uint8_t> encoded;
+    size_t frames = 0;
+    double decodeSeconds = 0;
+    for (;;)
+    {
+        const std::chrono::steady_clock::time_point before = std::chrono::steady_clock::now();
+        if (!player.Next())
+        {
+            break;
+        }
+        decodeSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - before).count();
+
+        // named by frame number and time, so the gaps left by skipped frames show
+        wchar_t name[64];
+        swprintf_s(name, L"frame_%05zu_%08u.qoi", frames++, player.TimeMs());
+        encoded.clear();
+        EncodeQoi(player.Pixels(), player.Width(), player.Height(), player.Stride(), encoded);
+        std::ofstream image(folder / name, std::ios::binary | std::ios::trunc);
+        image.write(reinterpret_cast<const char*>(encoded.data()), encoded.size());
+    }
+
+    wchar_t msg[128];
+    swprintf_s(msg, L"play: %zu frames, decode %.2f ms/frame\n", frames, frames ? decodeSeconds * 1000 / frames : 0.0);
+    OutputDebugString(msg);
+    return frames ? 0 : 1;
+}
+
+
+/*
+ - capture round trip: UserInputWin32.exe /capture <frames> <session.capture>
+ - the software renderer draws a few hundred still shapes and one that moves, resizing from 640x480 to 800x600 halfway,
+   and every frame is submitted to a 'FrameRecorder' as fast as it renders, so the worker falls behind and skips some
+ - every frame is a function of its number, so the capture is played back and each played frame is compared bit for bit
+   with the frames rendered again from the one after the last match on: skipped frames are stepped over, and a
+   played frame that matches none is damage
+ - exits with 1 if a played frame matches no frame, or nothing was played
+*/
+int RunCapture(int argc, wchar_t** argv)
+{
+    const int frames = _wtoi(argv[2]);
+    const std::filesystem::path path = argv[3];
+    if (frames <= 0)
+    {
+        return 1;
+    }
+
+    const UINT32 Background = 0xFFFFFFFF;
+    BatchArrays shapes(std::pmr::get_default_resource());
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> x(0.0f, 800.0f), y(0.0f, 600.0f), radius(2.0f, 40.0f);
+    for (uint32_t i = 0; i < 300; i++)
+    {
+        shapes.Push(i, x(random), y(random), radius(random), radius(random), Scene::Palette[random() % ARRAYSIZE(Scene::Palette)]);
+    }
+    shapes.Push(300, 0, 0, 30, 20, Scene::Palette[0]);
+
+    auto render = [&](SoftwareRenderer& renderer, int frame)
+    {
+        const bool large = frame >= frames / 2;
+        renderer.Resize(large ? 800 : 640, large ? 600 : 480);
+        shapes.cx.back() = 20.0f + 3.0f * (frame % 250);
+        shapes.cy.back() = 20.0f + 2.0f * (frame % 200);
+        renderer.Render(shapes.Batch(), 1, 1, 0, 0, Background);
+    };
+
+    {
+        FrameRecorder recorder(path);
+        if (!recorder.IsOpen())
+        {
+            return 1;
+        }
+        SoftwareRenderer renderer;
+        for (int f = 0; f < frames; f++)
+        {
+            render(renderer, f);
+            recorder.Submit(renderer);
+        }
+    }
+
+    CapturePlayer player;
+    if (!player.Open(path))
+    {
+        return 1;
+    }
+    SoftwareRenderer reference;
+    int next = 0; // the first frame a played one may be
+    size_t played = 0, damaged = 0;
+    while (player.Next())
+    {
+        played++;
+        const size_t pixels = static_cast<size_t>(player.Width()) * player.Height();
+        int f = next;
+        for (; f < frames; f++)
+        {
+            render(reference, f);
+            if (reference.Width() == player.Width() && reference.Height() == player.Height() &&
+                std::equal(player.Pixels(), player.Pixels() + pixels, reference.Pixels()))
+            {
+                break;
+            }
+        }
+        if (f == frames)
+        {
+            damaged++; // matches no frame left; look for the next one after the same frames
+        }
+        else
+        {
+            next = f + 1;
+        }
+    }
+
+    wchar_t msg[160];
+    swprintf_s(msg, L"capture: %d frames rendered, %zu played back, %zu not recorded, %zu matching no rendered frame\n",
+        frames, played, static_cast<size_t>(frames) - std::min(played, static_cast<size_t>(frames)), damaged);
+    OutputDebugString(msg);
+    return played > 0 && damaged == 0 ? 0 : 1;
+}
+
+
+/*
+ - time to first frame, warm-up thread against '/syncstartup': UserInputWin32.exe /startup <runs>
+ - launches this program 'runs' times each way, alternating so that a warming disk cache or a busy moment weighs on
+   both; each run is started with '/firstframe <file>', writes its time to first frame there and closes itself
+ - the runs start with an empty drawing, so the autosave journal is neither recovered nor written
+ - logs the median, fastest and slowest run each way; exits with 1 if a run did not report within 30 s
+*/
+int RunStartup(int argc, wchar_t** argv)
+{
+    const int runs = _wtoi(argv[2]);
+    if (runs <= 0)
+    {
+        return 1;
+    }
+
+    wchar_t exe[MAX_PATH];
+    if (GetModuleFileName(NULL, exe, MAX_PATH) == 0)
+    {
+        return 1;
+    }
+    std::error_code error;
+    const std::filesystem::path result = std::filesystem::temp_directory_path(error) / L"UserInputWin32.firstframe";
+
+    std::vector<double> times[2]; // warm-up thread, '/syncstartup'
+    size_t failures = 0;
+    for (int i = 0; i < 2 * runs; i++)
+    {
+        const bool sync = i % 2 == 1;
+        std::filesystem::remove(result, error);
+        std::wstring commandLine = L"\"" + std::wstring(exe) + L"\" /firstframe \"" + result.wstring() + L"\"";
+        if (sync)
+        {
+            commandLine += L" /syncstartup";
+        }
+
+        STARTUPINFO si = { sizeof(si) };
+        PROCESS_INFORMATION pi = {};
+        if (!CreateProcess(exe, &commandLine[0], NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi))
+        {
+            failures++;
+            continue;
+        }
+        const bool exited = WaitForSingleObject(pi.hProcess, 30000) == WAIT_OBJECT_0;
+        if (!exited)
+        {
+            TerminateProcess(pi.hProcess, 1);
+        }
+        CloseHandle(pi.hThread);
+        CloseHandle(pi.hProcess);
+
+        double ms = 0;
+        std::ifstream in(result);
+        if (exited && in >> ms && ms > 0)
+        {
+            times[sync].push_back(ms);
+        }
+        else
+        {
+            failures++;
+        }
+    }
+    std::filesystem::remove(result, error);
+
+    const wchar_t* const names[2] = { L"warm-up thread", L"/syncstartup" };
+    for (int sync = 0; sync < 2; sync++)
+    {
+        std::vector<double>& t = times[sync];
+        if (t.empty())
+        {
+            continue;
+        }
+        std::sort(t.begin(), t.end());
+        wchar_t msg[160];
+        swprintf_s(msg, L"startup: %s, %zu runs: time to first frame median %.1f ms, fastest %.1f ms, slowest %.1f ms\n",
+            names[sync], t.size(), t[t.size() / 2], t.front(), t.back());
+        OutputDebugString(msg);
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+
+// headless batch export: UserInputWin32.exe /export <width> <height> <drawing.scene>...
+int RunExport(int argc, wchar_t** argv)
+{
+    if (argc < 5)
+    {
+        return 1;
+    }
+    const int width = _wtoi(argv[2]);
+    const int height = _wtoi(argv[3]);
+    if (width <= 0 || height <= 0)
+    {
+        return 1;
+    }
+
+    std::vector<std::filesystem::path> files(argv + 4, argv + argc);
+
+    WorkStealingPool pool;
+    const ExportResult result = ExportDrawings(files, width, height, pool);
+
+    wchar_t msg[128];
+    swprintf_s(msg, L"export: %zu images in %.3f s (%.1f images/s), %zu failed\n", result.written, result.seconds,
+        result.seconds > 0 ? result.written / result.seconds : 0.0, result.failed);
+    OutputDebugString(msg);
+
+    return result.failed ? 1 : 0;
+}
+
+
+const SelfTest SelfTestTable[] =
+{
+    { L"/export", 0, RunExport },
+    { L"/history", 4, RunHistory },
+    { L"/autosave", 4, RunAutosave },
+    { L"/tap", 3, RunTap },
+    { L"/tap", 4, RunTap },
+    { L"/predict", 3, RunPredict },
+    { L"/play", 4, RunPlay },
+    { L"/capture", 4, RunCapture },
+    { L"/startup", 3, RunStartup },
+    { L"/displaylist", 3, RunDisplayList },
+    { L"/frames", 4, RunFrames },
+    { L"/move", 3, RunMove },
+    { L"/gesture", 3, RunGesture },
+    { L"/recognizer", 3, RunRecognizer },
+#ifdef PROFILE_ZONES
+    { L"/profile", 3, RunProfile },
+#endif
+    { L"/pointers", 3, RunPointers },
+    { L"/softrender", 3, RunSoftRender },
+    { L"/hover", 3, RunHover },
+    { L"/windowproc", 3, RunWindowProc },
+    { L"/windowcache", 3, RunWindowCache },
+    { L"/typing", 4, RunTyping },
+    { L"/pointerhistory", 2, RunPointerHistory },
+};
+
+std::span<const SelfTest> SelfTests()
+{
+    return SelfTestTable;
+}
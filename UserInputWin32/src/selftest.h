@@ -0,0 +1,20 @@
+#pragma once
+
+#include <span>
+
+/*
+ - the headless self-tests and benchmarks: 'UserInputWin32.exe /<mode> <arguments>' runs one in place of the window
+ - each mode logs its figures with 'OutputDebugString' and returns the exit code, 1 when its check fails; what a mode
+   measures and checks is described above its function in selftest.cpp
+ - 'wWinMain' runs the first entry whose name is the first argument and whose argument count matches, and opens the
+   window when none does; modes that configure the window ('/idle', '/paintheap', '/firstframe') stay there
+*/
+
+struct SelfTest
+{
+    const wchar_t* name; // e.g. L"/hover"
+    int argc;            // 'argc' of the command line, the program and the mode included; 0 for a mode that checks it
+    int (*run)(int argc, wchar_t** argv);
+};
+
+std::span<const SelfTest> SelfTests();
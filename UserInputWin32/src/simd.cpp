@@ -0,0 +1,35 @@
+#include "simd.h"
+
+#include <intrin.h>
+
+namespace
+{
+    bool DetectAvx2()
+    {
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+        {
+            return false;
+        }
+
+        // AVX and OSXSAVE: the CPU has the registers and the OS can be asked whether it saves them
+        __cpuid(info, 1);
+        const int avxAndOsxsave = (1 << 28) | (1 << 27);
+        if ((info[2] & avxAndOsxsave) != avxAndOsxsave)
+        {
+            return false;
+        }
+        // XMM and YMM state enabled by the OS
+        if ((_xgetbv(0) & 6) != 6)
+        {
+            return false;
+        }
+
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+    }
+}
+
+
+bool Simd::Avx2 = DetectAvx2();
@@ -0,0 +1,40 @@
+#pragma once
+
+/*
+ - the AVX2 kernels behind hit testing ('Scene') and binning ('SoftwareRenderer'), 8 shapes per instruction
+ - only simdavx2.cpp is compiled with AVX2 enabled; the rest of the program runs on any x64 CPU, and the callers
+   take the kernels only when 'Simd::Avx2' is set, keeping their scalar loops for CPUs without AVX2
+ - 'Avx2' is decided once, before 'wWinMain', from CPUID and from whether the OS saves the AVX registers (XGETBV);
+   '/hover' clears it for a second pass to check the scalar path against the kernels
+ - the kernels take plain pointers and call nothing but intrinsics: an inline function compiled in simdavx2.cpp
+   (a 'std::vector' accessor, 'std::floor') could come out with AVX2 instructions, and the linker may keep that copy
+   for the whole program
+*/
+
+class Simd
+{
+public:
+    static bool Avx2;
+
+    // bit i is set when box i (of 8, given as 4 arrays of edges) contains (x, y)
+    static unsigned BoxMask(const float* minX, const float* minY, const float* maxX, const float* maxY, float x, float y);
+
+    // bit i is set when ellipse i (of 8, with positive area) contains (x, y); see 'Scene::EllipseMask'
+    static unsigned EllipseMask(const float* cx, const float* cy, const float* rx, const float* ry, float x, float y);
+
+    struct BinParams
+    {
+        float scaleX, scaleY, offsetX, offsetY; // DIPs to pixels
+        float width, height;                    // pixels
+        float perTile;                          // 1 / tile size
+        int lastX, lastY;                       // last tile column and row
+    };
+
+    struct alignas(32) TileRanges
+    {
+        int x0[8], y0[8], x1[8], y1[8]; // inclusive, clipped to the screen
+    };
+
+    // bit i is set when ellipse i (of 8) is on screen, non-empty and not removed; its tile range is then in 'out'
+    static unsigned BinBoxes(const float* cx, const float* cy, const float* rx, const float* ry, const BinParams& p, TileRanges& out);
+};
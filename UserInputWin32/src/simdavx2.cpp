@@ -0,0 +1,67 @@
+// compiled with AVX2 enabled (see simd.h); includes nothing but the intrinsics
+#include "simd.h"
+
+#include <immintrin.h>
+
+unsigned Simd::BoxMask(const float* minX, const float* minY, const float* maxX, const float* maxY, float x, float y)
+{
+    const __m256 px = _mm256_set1_ps(x);
+    const __m256 py = _mm256_set1_ps(y);
+    const __m256 inside = _mm256_and_ps(
+        _mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(minX), px, _CMP_LE_OQ),
+                      _mm256_cmp_ps(px, _mm256_loadu_ps(maxX), _CMP_LE_OQ)),
+        _mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(minY), py, _CMP_LE_OQ),
+                      _mm256_cmp_ps(py, _mm256_loadu_ps(maxY), _CMP_LE_OQ)));
+    return static_cast<unsigned>(_mm256_movemask_ps(inside));
+}
+
+unsigned Simd::EllipseMask(const float* cx, const float* cy, const float* rx, const float* ry, float x, float y)
+{
+    const __m256 dx = _mm256_sub_ps(_mm256_set1_ps(x), _mm256_loadu_ps(cx));
+    const __m256 dy = _mm256_sub_ps(_mm256_set1_ps(y), _mm256_loadu_ps(cy));
+    const __m256 rx2 = _mm256_mul_ps(_mm256_loadu_ps(rx), _mm256_loadu_ps(rx));
+    const __m256 ry2 = _mm256_mul_ps(_mm256_loadu_ps(ry), _mm256_loadu_ps(ry));
+    const __m256 lhs = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(dx, dx), ry2), _mm256_mul_ps(_mm256_mul_ps(dy, dy), rx2));
+    const __m256 area = _mm256_mul_ps(rx2, ry2);
+    const __m256 inside = _mm256_and_ps(_mm256_cmp_ps(lhs, area, _CMP_LE_OQ), _mm256_cmp_ps(area, _mm256_setzero_ps(), _CMP_GT_OQ));
+    return static_cast<unsigned>(_mm256_movemask_ps(inside));
+}
+
+/*
+ - scale the bounding boxes to pixels, reject the ones that are off screen, empty or removed (NaN fails every
+   comparison), and convert the rest to tile ranges clipped to the screen
+ - only appending to the bins is left to the caller
+*/
+unsigned Simd::BinBoxes(const float* cx, const float* cy, const float* rx, const float* ry, const BinParams& p, TileRanges& out)
+{
+    const __m256 sx = _mm256_set1_ps(p.scaleX), sy = _mm256_set1_ps(p.scaleY);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 w = _mm256_set1_ps(p.width), h = _mm256_set1_ps(p.height);
+    const __m256 perTile = _mm256_set1_ps(p.perTile);
+
+    const __m256 x = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(cx), sx), _mm256_set1_ps(p.offsetX));
+    const __m256 y = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(cy), sy), _mm256_set1_ps(p.offsetY));
+    const __m256 radiusX = _mm256_mul_ps(_mm256_loadu_ps(rx), sx);
+    const __m256 radiusY = _mm256_mul_ps(_mm256_loadu_ps(ry), sy);
+    const __m256 left = _mm256_sub_ps(x, radiusX), right = _mm256_add_ps(x, radiusX);
+    const __m256 top = _mm256_sub_ps(y, radiusY), bottom = _mm256_add_ps(y, radiusY);
+
+    const __m256 visible = _mm256_and_ps(
+        _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(radiusX, zero, _CMP_GT_OQ), _mm256_cmp_ps(radiusY, zero, _CMP_GT_OQ)),
+                      _mm256_and_ps(_mm256_cmp_ps(right, zero, _CMP_GE_OQ), _mm256_cmp_ps(bottom, zero, _CMP_GE_OQ))),
+        _mm256_and_ps(_mm256_cmp_ps(left, w, _CMP_LT_OQ), _mm256_cmp_ps(top, h, _CMP_LT_OQ)));
+    const unsigned mask = static_cast<unsigned>(_mm256_movemask_ps(visible));
+    if (mask == 0)
+    {
+        return 0;
+    }
+
+    // clamping before the conversion keeps huge shapes from overflowing the integer range
+    _mm256_store_si256(reinterpret_cast<__m256i*>(out.x0), _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_max_ps(left, zero), perTile)));
+    _mm256_store_si256(reinterpret_cast<__m256i*>(out.y0), _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_max_ps(top, zero), perTile)));
+    _mm256_store_si256(reinterpret_cast<__m256i*>(out.x1),
+        _mm256_min_epi32(_mm256_cvttps_epi32(_mm256_mul_ps(_mm256_min_ps(right, w), perTile)), _mm256_set1_epi32(p.lastX)));
+    _mm256_store_si256(reinterpret_cast<__m256i*>(out.y1),
+        _mm256_min_epi32(_mm256_cvttps_epi32(_mm256_mul_ps(_mm256_min_ps(bottom, h), perTile)), _mm256_set1_epi32(p.lastY)));
+    return mask;
+}
@@ -0,0 +1,178 @@
+#include <windows.h>
+#include <d2d1.h>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+#include "scene.h"
+#include "simd.h"
+#include "softrender.h"
+
+namespace
+{
+    // 'v' as an int in [lo, hi]; converting a float that is NaN or out of the int range is undefined, so it is
+    // clamped first, and NaN fails both tests and becomes 'lo'
+    inline int ClampToInt(float v, int lo, int hi)
+    {
+        if (!(v >= static_cast<float>(lo)))
+        {
+            return lo;
+        }
+        return v <= static_cast<float>(hi) ? static_cast<int>(v) : hi;
+    }
+}
+
+
+void SoftwareRenderer::Resize(UINT32 w, UINT32 h)
+{
+    width = w;
+    height = h;
+    pixels.resize(static_cast<size_t>(w) * h);
+
+    tilesX = static_cast<int>((w + TileSize - 1) / TileSize);
+    tilesY = static_cast<int>((h + TileSize - 1) / TileSize);
+    bins.resize(static_cast<size_t>(tilesX) * tilesY);
+}
+
+void SoftwareRenderer::BinRange(uint32_t shape, int tx0, int ty0, int tx1, int ty1)
+{
+    for (int ty = ty0; ty <= ty1; ty++)
+    {
+        for (int tx = tx0; tx <= tx1; tx++)
+        {
+            bins[static_cast<size_t>(ty) * tilesX + tx].push_back(shape);
+        }
+    }
+}
+
+void SoftwareRenderer::Bin(const EllipseBatch& batch, float scaleX, float scaleY, float offsetX, float offsetY)
+{
+    for (std::vector<uint32_t>& bin : bins)
+    {
+        bin.clear(); // keeps the capacity, so a steady scene does not allocate
+    }
+
+    size_t i = 0;
+    if (Simd::Avx2)
+    {
+        const Simd::BinParams params = { scaleX, scaleY, offsetX, offsetY, static_cast<float>(width), static_cast<float>(height),
+            1.0f / TileSize, tilesX - 1, tilesY - 1 };
+        Simd::TileRanges ranges;
+        for (; i + 8 <= batch.count; i += 8)
+        {
+            unsigned mask = Simd::BinBoxes(batch.cx + i, batch.cy + i, batch.rx + i, batch.ry + i, params, ranges);
+            while (mask)
+            {
+                const unsigned lane = static_cast<unsigned>(std::countr_zero(mask));
+                mask &= mask - 1;
+                BinRange(static_cast<uint32_t>(i + lane), ranges.x0[lane], ranges.y0[lane], ranges.x1[lane], ranges.y1[lane]);
+            }
+        }
+    }
+
+    for (; i < batch.count; i++)
+    {
+        // tile range covered by the bounding box, clipped to the screen
+        const float left = (batch.cx[i] - batch.rx[i]) * scaleX + offsetX;
+        const float top = (batch.cy[i] - batch.ry[i]) * scaleY + offsetY;
+        const float right = (batch.cx[i] + batch.rx[i]) * scaleX + offsetX;
+        const float bottom = (batch.cy[i] + batch.ry[i]) * scaleY + offsetY;
+        if (!(batch.rx[i] > 0 && batch.ry[i] > 0 && right >= 0 && bottom >= 0 && left < width && top < height))
+        {
+            continue;
+        }
+
+        // clamped to the screen before the conversion, like the AVX2 path: a huge shape's edges are far outside the int range
+        BinRange(static_cast<uint32_t>(i), ClampToInt(left, 0, static_cast<int>(width)) / TileSize,
+            ClampToInt(top, 0, static_cast<int>(height)) / TileSize,
+            std::min(tilesX - 1, ClampToInt(right, 0, static_cast<int>(width)) / TileSize),
+            std::min(tilesY - 1, ClampToInt(bottom, 0, static_cast<int>(height)) / TileSize));
+    }
+}
+
+void SoftwareRenderer::RasterizeTile(int tile, const EllipseBatch& batch, float scaleX, float scaleY, float offsetX, float offsetY, UINT32 background)
+{
+    const int x0 = (tile % tilesX) * TileSize;
+    const int y0 = (tile / tilesX) * TileSize;
+    const int x1 = std::min(x0 + TileSize, static_cast<int>(width));
+    const int y1 = std::min(y0 + TileSize, static_cast<int>(height));
+
+    for (int y = y0; y < y1; y++)
+    {
+        std::fill(&pixels[static_cast<size_t>(y) * width + x0], &pixels[static_cast<size_t>(y) * width + x1], background);
+    }
+
+    for (uint32_t i : bins[tile])
+    {
+        const float cx = batch.cx[i] * scaleX + offsetX;
+        const float cy = batch.cy[i] * scaleY + offsetY;
+        const float rx = batch.rx[i] * scaleX;
+        const float ry = batch.ry[i] * scaleY;
+        const UINT32 color = batch.colors[i];
+
+        if (lod && rx < SplatRadius && ry < SplatRadius)
+        {
+            // the bounding box may reach into a neighbouring tile, but only the tile holding the center writes the pixel
+            const int x = ClampToInt(std::floor(cx), x0 - 1, x1);
+            const int y = ClampToInt(std::floor(cy), y0 - 1, y1);
+            if (x >= x0 && x < x1 && y >= y0 && y < y1)
+            {
+                pixels[static_cast<size_t>(y) * width + x] = color;
+            }
+            continue;
+        }
+
+        // pixel rows whose centers fall inside the ellipse, clipped to the tile (an empty range if the bounds are NaN)
+        const int rowFirst = ClampToInt(std::ceil(cy - ry - 0.5f), y0, y1);
+        const int rowLast = ClampToInt(std::floor(cy + ry - 0.5f), y0 - 1, y1 - 1);
+
+        for (int y = rowFirst; y <= rowLast; y++)
+        {
+            const float dy = (y + 0.5f - cy) / ry;
+            const float t = 1.0f - dy * dy;
+            if (t < 0)
+            {
+                continue;
+            }
+            const float half = rx * std::sqrt(t);
+            const int spanFirst = ClampToInt(std::ceil(cx - half - 0.5f), x0, x1);
+            const int spanLast = ClampToInt(std::floor(cx + half - 0.5f), x0 - 1, x1 - 1);
+            if (spanFirst <= spanLast)
+            {
+                UINT32* row = &pixels[static_cast<size_t>(y) * width];
+                std::fill(row + spanFirst, row + spanLast + 1, color);
+            }
+        }
+    }
+}
+
+void SoftwareRenderer::Render(const Scene& scene, float scaleX, float scaleY, UINT32 background)
+{
+    Render(scene.Batch(), scaleX, scaleY, 0, 0, background);
+}
+
+void SoftwareRenderer::Render(const EllipseBatch& batch, float scaleX, float scaleY, float offsetX, float offsetY, UINT32 background)
+{
+    if (width == 0 || height == 0)
+    {
+        return;
+    }
+
+    Bin(batch, scaleX, scaleY, offsetX, offsetY);
+
+    if (pool)
+    {
+        pool->ParallelFor(bins.size(), [&](size_t tile)
+        {
+            RasterizeTile(static_cast<int>(tile), batch, scaleX, scaleY, offsetX, offsetY, background);
+        });
+    }
+    else
+    {
+        for (size_t tile = 0; tile < bins.size(); tile++)
+        {
+            RasterizeTile(static_cast<int>(tile), batch, scaleX, scaleY, offsetX, offsetY, background);
+        }
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "batch.h"
+#include "threadpool.h"
+
+class Scene;
+
+/*
+ - CPU rasterizer for the scene, drawing into a 32-bit BGRA pixel buffer
+ - two stages:
+    - binning: every shape is appended to the list of each screen tile its bounding box overlaps,
+      in z-order, so each tile knows exactly which shapes to draw
+    - rasterization: tiles are independent, so they are spread over all cores by a work-stealing pool
+      (without a pool the tiles are rasterized on the calling thread, e.g. when many drawings are rendered in parallel)
+ - ellipses are filled row by row: for each pixel row the covered span is solved from the ellipse equation
+ - the input is an 'EllipseBatch'; binning converts 8 bounding boxes to tile ranges per AVX2 instruction
+   where the CPU has AVX2 ('Simd::BinBoxes'), one at a time elsewhere
+ - with level of detail on, sub-pixel shapes are splatted (see 'SplatRadius') instead of solved row by row
+*/
+
+class SoftwareRenderer
+{
+public:
+    static const int TileSize = 64; // pixels
+
+private:
+    WorkStealingPool* pool;
+    UINT32 width, height;
+    std::vector<UINT32> pixels;
+    int tilesX, tilesY;
+    std::vector<std::vector<uint32_t>> bins; // shape indices per tile, reused from frame to frame
+    bool lod;
+
+    void BinRange(uint32_t shape, int tx0, int ty0, int tx1, int ty1);
+    void Bin(const EllipseBatch& batch, float scaleX, float scaleY, float offsetX, float offsetY);
+    void RasterizeTile(int tile, const EllipseBatch& batch, float scaleX, float scaleY, float offsetX, float offsetY, UINT32 background);
+
+public:
+    explicit SoftwareRenderer(WorkStealingPool* p = NULL) : pool(p), width(0), height(0), tilesX(0), tilesY(0), lod(true) {}
+
+    void Resize(UINT32 w, UINT32 h);
+
+    void SetLevelOfDetail(bool enable) { lod = enable; }
+
+    // shapes are in DIPs; a shape at x is drawn at pixel x * scaleX + offsetX (y likewise). Colors are 0xAARRGGBB.
+    void Render(const EllipseBatch& batch, float scaleX, float scaleY, float offsetX, float offsetY, UINT32 background);
+    void Render(const Scene& scene, float scaleX, float scaleY, UINT32 background);
+
+    const UINT32* Pixels() const { return pixels.data(); }
+
+    // trades the finished frame for another buffer, which the next frame is drawn into (see 'FrameRecorder')
+    void SwapPixels(std::vector<UINT32>& other)
+    {
+        pixels.swap(other);
+        pixels.resize(static_cast<size_t>(width) * height);
+    }
+    UINT32 Width() const { return width; }
+    UINT32 Height() const { return height; }
+    UINT32 Stride() const { return width * sizeof(UINT32); }
+};
@@ -0,0 +1,411 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ - uniform grid over the plane, hashed so it needs no bounds: a cell is the pair of integer
+   coordinates floor(x / cellSize), floor(y / cellSize) packed into one 64-bit key
+ - every shape is listed in each cell its bounding box touches
+ - moving a shape only touches the grid when its box enters or leaves a cell, so a drag costs O(1) amortized per move
+ - shapes covering more than 'MaxCellsPerShape' cells are kept in a separate list that every query checks,
+   so one huge shape cannot make updates expensive
+ - a box query reports a shape only from the first cell it shares with the box, so shapes spanning several cells
+   are reported once without marking them; when the box covers more cells than exist, the occupied cells are walked instead
+ - cells live in one open-addressing table; a cell's shapes are kept in chunks of 'ChunkSize' ids taken from a pool,
+   so a query reads them a cache line at a time
+ - every place a shape is listed in is recorded in a link, and a shape's links are chained, so unlinking a shape goes
+   straight to its entries and never scans a cell; the cell's last entry fills the hole
+ - a cell whose last shape leaves stays in the table, so a shape moving back and forth reuses it; emptied cells are
+   dropped when the table is rebuilt, once half its slots are in use, so the table stays proportional to the
+   occupied cells however far shapes travel
+ - once the pool and the table have grown to a drag's working set, moving shapes allocates nothing
+ - cell coordinates are clamped to +-'MaxCell' (NaN goes to the lower bound): converting NaN or a float beyond the
+   range of int is undefined, and the clamp keeps cell counts and spans within int
+*/
+
+class SpatialGrid
+{
+public:
+    struct Box { float left, top, right, bottom; };
+
+private:
+    static const int MaxCellsPerShape = 64;
+    static const int MaxCell = 1 << 29;
+    static const uint32_t None = 0xFFFFFFFFu;
+    static const uint64_t EmptyKey = 0x8000000080000000ull; // (-2^31, -2^31), outside the clamped range
+    static const uint32_t ChunkSize = 7;
+
+    struct Span
+    {
+        int x0, y0, x1, y1; // inclusive cell range, x1 < x0 when the shape is not in the grid
+        bool oversized;
+        uint32_t first;     // the shape's first link, or its index in 'oversized'
+    };
+
+    struct Bucket
+    {
+        uint64_t key;  // 'EmptyKey' for a free slot
+        uint32_t head; // first chunk, 'None' when the cell is empty
+        uint32_t size;
+    };
+
+    // a run of a cell's shapes; the head chunk holds the last (size - 1) % ChunkSize + 1 of them, the others are full
+    struct alignas(64) Chunk
+    {
+        uint32_t ids[ChunkSize];
+        uint32_t links[ChunkSize]; // the link of each id, to update when it moves within the cell
+        uint32_t next;             // the next chunk of the cell; the next free chunk once released
+    };
+
+    // one per shape and cell it is listed in
+    struct Link
+    {
+        uint32_t cell;    // slot in 'table'
+        uint32_t chunk;
+        uint32_t index;   // within the chunk
+        uint32_t sibling; // the shape's next link; the next free link once released
+    };
+
+    float cellSize;
+    std::vector<Bucket> table;  // size a power of two, linear probing
+    std::vector<Bucket> spare;  // the previous table, kept for a rebuild that does not need to grow
+    size_t used;                // slots holding a cell, empty or not
+    size_t occupied;            // cells holding a shape
+    std::vector<Chunk> chunks;
+    std::vector<Link> links;
+    uint32_t freeChunks, freeLinks;
+    std::vector<Span> spans;        // indexed by shape id
+    std::vector<uint32_t> oversized; // shapes too large to list cell by cell
+
+    static uint64_t Key(int x, int y) { return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y); }
+
+    int Cell(float v) const
+    {
+        const float c = std::floor(v / cellSize);
+        if (!(c > -MaxCell))
+        {
+            return -MaxCell;
+        }
+        return c < MaxCell ? static_cast<int>(c) : MaxCell;
+    }
+
+    Span SpanOf(const Box& box) const
+    {
+        Span s = { Cell(box.left), Cell(box.top), Cell(box.right), Cell(box.bottom), false, None };
+        const int64_t cellsCovered = static_cast<int64_t>(s.x1 - s.x0 + 1) * (s.y1 - s.y0 + 1);
+        s.oversized = cellsCovered > MaxCellsPerShape;
+        return s;
+    }
+
+    // neighbouring cells have consecutive keys; Fibonacci hashing spreads them over the table
+    size_t Slot(uint64_t key) const
+    {
+        return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & (table.size() - 1);
+    }
+
+    uint32_t Find(uint64_t key) const
+    {
+        if (table.empty())
+        {
+            return None;
+        }
+        for (size_t i = Slot(key);; i = (i + 1) & (table.size() - 1))
+        {
+            if (table[i].key == key)
+            {
+                return static_cast<uint32_t>(i);
+            }
+            if (table[i].key == EmptyKey)
+            {
+                return None;
+            }
+        }
+    }
+
+    // calls 'visit(id)' for every shape in 'cell'
+    template <class Visit>
+    void ForEach(const Bucket& cell, Visit&& visit) const
+    {
+        uint32_t n = cell.size == 0 ? 0 : (cell.size - 1) % ChunkSize + 1;
+        for (uint32_t c = cell.head; c != None; c = chunks[c].next, n = ChunkSize)
+        {
+            for (uint32_t i = 0; i < n; i++)
+            {
+                visit(chunks[c].ids[i]);
+            }
+        }
+    }
+
+    // moves the occupied cells to a table at least four times their number, dropping the empty ones
+    void Rebuild()
+    {
+        size_t size = 16;
+        while (size < 4 * (occupied + 1))
+        {
+            size *= 2;
+        }
+        spare.assign(size, Bucket{ EmptyKey, None, 0 });
+        spare.swap(table);
+        used = 0;
+        for (const Bucket& cell : spare)
+        {
+            if (cell.key != EmptyKey && cell.size != 0)
+            {
+                size_t i = Slot(cell.key);
+                while (table[i].key != EmptyKey)
+                {
+                    i = (i + 1) & (table.size() - 1);
+                }
+                table[i] = cell;
+                used++;
+
+                uint32_t n = (cell.size - 1) % ChunkSize + 1;
+                for (uint32_t c = cell.head; c != None; c = chunks[c].next, n = ChunkSize)
+                {
+                    for (uint32_t k = 0; k < n; k++)
+                    {
+                        links[chunks[c].links[k]].cell = static_cast<uint32_t>(i);
+                    }
+                }
+            }
+        }
+    }
+
+    uint32_t FindOrAdd(uint64_t key)
+    {
+        const uint32_t found = Find(key);
+        if (found != None)
+        {
+            return found;
+        }
+        if (2 * (used + 1) > table.size())
+        {
+            Rebuild();
+        }
+        size_t i = Slot(key);
+        while (table[i].key != EmptyKey)
+        {
+            i = (i + 1) & (table.size() - 1);
+        }
+        table[i] = Bucket{ key, None, 0 };
+        used++;
+        return static_cast<uint32_t>(i);
+    }
+
+    void Insert(uint32_t id, const Span& s)
+    {
+        if (s.oversized)
+        {
+            spans[id].first = static_cast<uint32_t>(oversized.size());
+            oversized.push_back(id);
+            return;
+        }
+        uint32_t first = None;
+        for (int y = s.y0; y <= s.y1; y++)
+        {
+            for (int x = s.x0; x <= s.x1; x++)
+            {
+                uint32_t l = freeLinks;
+                if (l != None)
+                {
+                    freeLinks = links[l].sibling;
+                }
+                else
+                {
+                    l = static_cast<uint32_t>(links.size());
+                    links.push_back(Link());
+                }
+
+                const uint32_t c = FindOrAdd(Key(x, y));
+                Bucket& cell = table[c];
+                const uint32_t index = cell.size % ChunkSize;
+                if (index == 0)
+                {
+                    uint32_t k = freeChunks;
+                    if (k != None)
+                    {
+                        freeChunks = chunks[k].next;
+                    }
+                    else
+                    {
+                        k = static_cast<uint32_t>(chunks.size());
+                        chunks.push_back(Chunk());
+                    }
+                    chunks[k].next = cell.head;
+                    cell.head = k;
+                }
+                chunks[cell.head].ids[index] = id;
+                chunks[cell.head].links[index] = l;
+                links[l] = Link{ c, cell.head, index, first };
+                occupied += cell.size++ == 0;
+                first = l;
+            }
+        }
+        spans[id].first = first;
+    }
+
+    void Unlink(const Span& s)
+    {
+        if (s.oversized)
+        {
+            oversized[s.first] = oversized.back();
+            spans[oversized[s.first]].first = s.first;
+            oversized.pop_back();
+            return;
+        }
+        uint32_t l = s.first;
+        while (l != None)
+        {
+            Link& link = links[l];
+            Bucket& cell = table[link.cell];
+
+            // the cell's last shape takes the place of the one leaving
+            Chunk& head = chunks[cell.head];
+            const uint32_t last = --cell.size % ChunkSize;
+            chunks[link.chunk].ids[link.index] = head.ids[last];
+            chunks[link.chunk].links[link.index] = head.links[last];
+            links[head.links[last]].chunk = link.chunk;
+            links[head.links[last]].index = link.index;
+            if (last == 0)
+            {
+                const uint32_t released = cell.head;
+                cell.head = head.next;
+                head.next = freeChunks;
+                freeChunks = released;
+            }
+            occupied -= cell.size == 0;
+
+            const uint32_t sibling = link.sibling;
+            link.sibling = freeLinks;
+            freeLinks = l;
+            l = sibling;
+        }
+    }
+
+public:
+    explicit SpatialGrid(float size = 64.0f) : cellSize(size), used(0), occupied(0), freeChunks(None), freeLinks(None) {}
+
+    // adds shape 'id' or moves it to 'box'
+    void Update(uint32_t id, const Box& box)
+    {
+        const Span s = SpanOf(box);
+        if (id >= spans.size())
+        {
+            spans.resize(id + 1, Span{ 0, 0, -1, -1, false, None });
+        }
+
+        const Span old = spans[id];
+        if (old.x0 == s.x0 && old.y0 == s.y0 && old.x1 == s.x1 && old.y1 == s.y1 && old.oversized == s.oversized)
+        {
+            return; // still in the same cells
+        }
+        if (old.x1 >= old.x0)
+        {
+            Unlink(old);
+        }
+        spans[id] = s;
+        Insert(id, s);
+    }
+
+    void Remove(uint32_t id)
+    {
+        if (id < spans.size() && spans[id].x1 >= spans[id].x0)
+        {
+            Unlink(spans[id]);
+            spans[id] = Span{ 0, 0, -1, -1, false, None };
+        }
+    }
+
+    void Clear()
+    {
+        std::fill(table.begin(), table.end(), Bucket{ EmptyKey, None, 0 });
+        used = 0;
+        occupied = 0;
+        chunks.clear();
+        links.clear();
+        freeChunks = None;
+        freeLinks = None;
+        spans.clear();
+        oversized.clear();
+    }
+
+    // number of occupied cells
+    size_t CellCount() const { return occupied; }
+
+    // number of slots in the cell table, occupied or not
+    size_t TableSize() const { return table.size(); }
+
+    // number of cells 'box' covers
+    int64_t CellsIn(const Box& box) const
+    {
+        return static_cast<int64_t>(Cell(box.right) - Cell(box.left) + 1) * (Cell(box.bottom) - Cell(box.top) + 1);
+    }
+
+    // calls 'visit(id)' once for every shape whose bounding box may overlap 'box'
+    template <class Visit>
+    void QueryBox(const Box& box, Visit&& visit) const
+    {
+        const int x0 = Cell(box.left), y0 = Cell(box.top), x1 = Cell(box.right), y1 = Cell(box.bottom);
+
+        auto visitCell = [&](int x, int y, const Bucket& cell)
+        {
+            ForEach(cell, [&](uint32_t id)
+            {
+                const Span& s = spans[id];
+                if (x == std::max(s.x0, x0) && y == std::max(s.y0, y0))
+                {
+                    visit(id);
+                }
+            });
+        };
+
+        if (CellsIn(box) <= static_cast<int64_t>(occupied))
+        {
+            for (int y = y0; y <= y1; y++)
+            {
+                for (int x = x0; x <= x1; x++)
+                {
+                    const uint32_t c = Find(Key(x, y));
+                    if (c != None)
+                    {
+                        visitCell(x, y, table[c]);
+                    }
+                }
+            }
+        }
+        else
+        {
+            for (const Bucket& cell : table)
+            {
+                const int x = static_cast<int32_t>(cell.key >> 32), y = static_cast<int32_t>(cell.key);
+                if (cell.key != EmptyKey && x >= x0 && x <= x1 && y >= y0 && y <= y1)
+                {
+                    visitCell(x, y, cell);
+                }
+            }
+        }
+        for (uint32_t id : oversized)
+        {
+            visit(id);
+        }
+    }
+
+    // calls 'visit(id)' for every shape whose bounding box may contain (x, y)
+    template <class Visit>
+    void Query(float x, float y, Visit&& visit) const
+    {
+        const uint32_t c = Find(Key(Cell(x), Cell(y)));
+        if (c != None)
+        {
+            ForEach(table[c], visit);
+        }
+        for (uint32_t id : oversized)
+        {
+            visit(id);
+        }
+    }
+};
@@ -0,0 +1,95 @@
+#include <windows.h>
+
+#include <chrono>
+#include <mutex>
+#include <stdio.h>
+#include <vector>
+
+#include "startup.h"
+
+namespace
+{
+    struct Phase
+    {
+        const wchar_t* name;
+        double ms;
+        bool uiThread;
+    };
+
+    std::mutex lock;
+    std::chrono::steady_clock::time_point begin;
+    double loaderMs = 0;
+    DWORD uiThread = 0;
+    std::vector<Phase> phases;
+    bool finished = false;
+    double firstFrameMs = 0;
+
+    double Elapsed()
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    }
+
+    ULONGLONG Ticks(const FILETIME& t)
+    {
+        return (static_cast<ULONGLONG>(t.dwHighDateTime) << 32) | t.dwLowDateTime; // 100 ns units
+    }
+}
+
+
+void StartupTimeline::Begin()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    begin = std::chrono::steady_clock::now();
+    uiThread = GetCurrentThreadId();
+    phases.reserve(32);
+
+    FILETIME created, exited, kernel, user, now;
+    if (GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user))
+    {
+        GetSystemTimePreciseAsFileTime(&now);
+        loaderMs = (Ticks(now) - Ticks(created)) / 10000.0;
+    }
+}
+
+void StartupTimeline::Mark(const wchar_t* phase)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (!finished)
+    {
+        phases.push_back(Phase{ phase, Elapsed(), GetCurrentThreadId() == uiThread });
+    }
+}
+
+void StartupTimeline::Finish(const wchar_t* phase)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (finished)
+    {
+        return;
+    }
+    phases.push_back(Phase{ phase, Elapsed(), true });
+    finished = true;
+
+    wchar_t msg[160];
+    swprintf_s(msg, L"startup: process start to wWinMain %.1f ms\n", loaderMs);
+    OutputDebugString(msg);
+
+    // each phase lasted from the previous phase of the same thread; the warm-up thread's overlap the UI thread's
+    double previousUi = 0, previousWarmup = 0;
+    for (const Phase& p : phases)
+    {
+        double& previous = p.uiThread ? previousUi : previousWarmup;
+        swprintf_s(msg, L"startup: %8.1f ms  %s%s (%.1f ms)\n", p.ms, p.uiThread ? L"" : L"[warm-up] ", p.name, p.ms - previous);
+        OutputDebugString(msg);
+        previous = p.ms;
+    }
+    firstFrameMs = loaderMs + phases.back().ms;
+    swprintf_s(msg, L"startup: time to first frame %.1f ms\n", firstFrameMs);
+    OutputDebugString(msg);
+}
+
+double StartupTimeline::FirstFrameMs()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return firstFrameMs;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+/*
+ - timeline of the startup phases, to see what stands between launching the program and its first frame
+ - times are measured from the start of 'wWinMain'; the time the loader took before that comes from the process
+   creation time
+ - phases are marked from any thread (factories are created on a warm-up thread, see 'GraphicsWarmup'),
+   and the whole timeline is logged once, when the first frame is presented
+*/
+
+class StartupTimeline
+{
+public:
+    static void Begin(); // first thing in 'wWinMain'
+    static void Mark(const wchar_t* phase);
+
+    // marks the last phase and logs the timeline; only the first call does anything
+    static void Finish(const wchar_t* phase);
+
+    // process creation to 'Finish', in ms; 0 before it
+    static double FirstFrameMs();
+};
@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <cstring>
+
+#include "textbuffer.h"
+
+
+void TextBuffer::Reserve(size_t extra)
+{
+    if (GapSize() >= extra)
+    {
+        return;
+    }
+
+    // grow geometrically, then slide the text after the gap to the new end of the buffer
+    const size_t length = Length();
+    const size_t capacity = std::max(std::max<size_t>(buffer.size() * 2, 64), length + extra);
+    const size_t tail = buffer.size() - gapEnd;
+
+    buffer.resize(capacity);
+    std::memmove(buffer.data() + capacity - tail, buffer.data() + gapEnd, tail * sizeof(wchar_t));
+    gapEnd = capacity - tail;
+}
+
+void TextBuffer::MoveGap(size_t pos)
+{
+    if (pos < gapStart)
+    {
+        // the text between 'pos' and the gap moves to just before the end of the gap
+        const size_t count = gapStart - pos;
+        std::memmove(buffer.data() + gapEnd - count, buffer.data() + pos, count * sizeof(wchar_t));
+        gapStart = pos;
+        gapEnd -= count;
+    }
+    else if (pos > gapStart)
+    {
+        const size_t count = pos - gapStart;
+        std::memmove(buffer.data() + gapStart, buffer.data() + gapEnd, count * sizeof(wchar_t));
+        gapStart += count;
+        gapEnd += count;
+    }
+}
+
+void TextBuffer::Erase(size_t first, size_t last)
+{
+    MoveGap(first);
+    gapEnd += last - first;
+    caret = anchor = first;
+}
+
+size_t TextBuffer::SnapToCodePoint(size_t pos) const
+{
+    if (pos > 0 && pos < Length() && IsLowSurrogate(At(pos)) && IsHighSurrogate(At(pos - 1)))
+    {
+        return pos + 1;
+    }
+    return pos;
+}
+
+void TextBuffer::Insert(const wchar_t* text, size_t count)
+{
+    if (HasSelection())
+    {
+        Erase(SelectionStart(), SelectionEnd());
+    }
+
+    Reserve(count);
+    MoveGap(caret);
+    std::memcpy(buffer.data() + gapStart, text, count * sizeof(wchar_t));
+    gapStart += count;
+    caret = anchor = gapStart;
+}
+
+void TextBuffer::Backspace()
+{
+    if (HasSelection())
+    {
+        Erase(SelectionStart(), SelectionEnd());
+    }
+    else if (caret > 0)
+    {
+        size_t first = caret - 1;
+        if (first > 0 && IsLowSurrogate(At(first)) && IsHighSurrogate(At(first - 1)))
+        {
+            first--;
+        }
+        Erase(first, caret);
+    }
+}
+
+void TextBuffer::Delete()
+{
+    if (HasSelection())
+    {
+        Erase(SelectionStart(), SelectionEnd());
+    }
+    else if (caret < Length())
+    {
+        Erase(caret, SnapToCodePoint(caret + 1));
+    }
+}
+
+void TextBuffer::MoveLeft(bool extend)
+{
+    if (!extend && HasSelection())
+    {
+        caret = anchor = SelectionStart();
+        return;
+    }
+    if (caret > 0)
+    {
+        caret--;
+        if (caret > 0 && IsLowSurrogate(At(caret)) && IsHighSurrogate(At(caret - 1)))
+        {
+            caret--;
+        }
+    }
+    if (!extend)
+    {
+        anchor = caret;
+    }
+}
+
+void TextBuffer::MoveRight(bool extend)
+{
+    if (!extend && HasSelection())
+    {
+        caret = anchor = SelectionEnd();
+        return;
+    }
+    if (caret < Length())
+    {
+        caret = SnapToCodePoint(caret + 1);
+    }
+    if (!extend)
+    {
+        anchor = caret;
+    }
+}
+
+void TextBuffer::MoveLineStart(bool extend)
+{
+    while (caret > 0 && At(caret - 1) != L'\n')
+    {
+        caret--;
+    }
+    if (!extend)
+    {
+        anchor = caret;
+    }
+}
+
+void TextBuffer::MoveLineEnd(bool extend)
+{
+    const size_t length = Length();
+    while (caret < length && At(caret) != L'\n')
+    {
+        caret++;
+    }
+    if (!extend)
+    {
+        anchor = caret;
+    }
+}
+
+void TextBuffer::SelectAll()
+{
+    anchor = 0;
+    caret = Length();
+}
+
+void TextBuffer::CopyRange(size_t first, size_t last, std::wstring& out) const
+{
+    CopyRangeTo(first, last, out);
+}
+
+void TextBuffer::CopyRange(size_t first, size_t last, std::pmr::wstring& out) const
+{
+    CopyRangeTo(first, last, out);
+}
+
+template <typename String>
+void TextBuffer::CopyRangeTo(size_t first, size_t last, String& out) const
+{
+    out.clear();
+    out.reserve(last - first);
+
+    // at most two contiguous pieces: before the gap and after it
+    if (first < gapStart)
+    {
+        const size_t end = std::min(last, gapStart);
+        out.append(buffer.data() + first, end - first);
+        first = end;
+    }
+    if (first < last)
+    {
+        out.append(buffer.data() + first + GapSize(), last - first);
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+/*
+ - editable UTF-16 text stored in a gap buffer: one array holding the text before the caret, an unused gap,
+   then the text after the caret
+    - typing at the caret writes into the gap, which is O(1)
+    - moving the caret moves the gap, which costs the distance moved, not the document size
+    - the gap doubles when it runs out, so inserting stays O(1) amortized even for multi-megabyte documents
+ - positions are UTF-16 code units; the caret and the selection never stop between the two halves of a surrogate pair
+ - the selection is the range between 'anchor' and the caret; it is empty when they are equal
+*/
+
+class TextBuffer
+{
+    std::vector<wchar_t> buffer;
+    size_t gapStart; // first unused slot
+    size_t gapEnd;   // first slot after the gap
+    size_t caret;
+    size_t anchor;
+
+    size_t GapSize() const { return gapEnd - gapStart; }
+    void MoveGap(size_t pos);
+    void Reserve(size_t extra);
+    void Erase(size_t first, size_t last);
+
+    static bool IsHighSurrogate(wchar_t c) { return c >= 0xD800 && c <= 0xDBFF; }
+    static bool IsLowSurrogate(wchar_t c) { return c >= 0xDC00 && c <= 0xDFFF; }
+
+public:
+    TextBuffer() : gapStart(0), gapEnd(0), caret(0), anchor(0) {}
+
+    size_t Length() const { return buffer.size() - GapSize(); }
+    wchar_t At(size_t i) const { return i < gapStart ? buffer[i] : buffer[i + GapSize()]; }
+
+    size_t Caret() const { return caret; }
+    size_t SelectionStart() const { return caret < anchor ? caret : anchor; }
+    size_t SelectionEnd() const { return caret < anchor ? anchor : caret; }
+    bool HasSelection() const { return caret != anchor; }
+
+    // 'pos' moved forward if it would split a surrogate pair
+    size_t SnapToCodePoint(size_t pos) const;
+
+    // replaces the selection (if any) with 'text' and puts the caret after it
+    void Insert(const wchar_t* text, size_t count);
+    void Insert(wchar_t c) { Insert(&c, 1); }
+
+    // delete the selection, or the code point before / after the caret
+    void Backspace();
+    void Delete();
+
+    // caret movement; with 'extend' the anchor stays put and the selection grows
+    void MoveLeft(bool extend);
+    void MoveRight(bool extend);
+    void MoveLineStart(bool extend);
+    void MoveLineEnd(bool extend);
+    void SelectAll();
+
+    // copies [first, last) into 'out'; the std::pmr version lets the copy live in a frame arena
+    void CopyRange(size_t first, size_t last, std::wstring& out) const;
+    void CopyRange(size_t first, size_t last, std::pmr::wstring& out) const;
+
+private:
+    template <typename String>
+    void CopyRangeTo(size_t first, size_t last, String& out) const;
+};
@@ -0,0 +1,137 @@
+#include "threadpool.h"
+
+
+WorkStealingPool::WorkStealingPool(unsigned threads) :
+    generation(0), stopping(false), taskFn(NULL), taskContext(NULL), remaining(0)
+{
+    if (threads == 0)
+    {
+        threads = std::thread::hardware_concurrency();
+    }
+    if (threads == 0)
+    {
+        threads = 1;
+    }
+
+    for (unsigned i = 0; i < threads; i++)
+    {
+        queues.push_back(std::make_unique<Queue>());
+    }
+
+    // queue 0 is served by the thread that calls 'ParallelFor'
+    for (unsigned i = 1; i < threads; i++)
+    {
+        workers.emplace_back(&WorkStealingPool::WorkerMain, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (std::thread& t : workers)
+    {
+        t.join();
+    }
+}
+
+// runs one item, from the thread's own queue if possible, otherwise stolen from another one; false if every queue is empty
+bool WorkStealingPool::RunOne(size_t self)
+{
+    size_t item = 0;
+    bool found = false;
+
+    {
+        Queue& own = *queues[self];
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (own.front != own.back)
+        {
+            item = --own.back;
+            found = true;
+        }
+    }
+
+    for (size_t i = 1; !found && i < queues.size(); i++)
+    {
+        Queue& victim = *queues[(self + i) % queues.size()];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (victim.front != victim.back)
+        {
+            item = victim.front++;
+            found = true;
+        }
+    }
+
+    if (!found)
+    {
+        return false;
+    }
+
+    taskFn(taskContext, item);
+
+    if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        finished.notify_all();
+    }
+    return true;
+}
+
+void WorkStealingPool::WorkerMain(size_t self)
+{
+    uint64_t seen = 0;
+
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            wake.wait(guard, [&] { return stopping || generation != seen; });
+            if (stopping)
+            {
+                return;
+            }
+            seen = generation;
+        }
+
+        while (RunOne(self))
+        {
+        }
+    }
+}
+
+void WorkStealingPool::Run(size_t count, TaskFn fn, void* context)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        taskFn = fn;
+        taskContext = context;
+        remaining.store(count, std::memory_order_relaxed);
+
+        // deal the items out in contiguous runs, so neighbouring items start on the same thread
+        const size_t threads = queues.size();
+        for (size_t t = 0; t < threads; t++)
+        {
+            std::lock_guard<std::mutex> queueGuard(queues[t]->lock);
+            queues[t]->front = count * t / threads;
+            queues[t]->back = count * (t + 1) / threads;
+        }
+        generation++;
+    }
+    wake.notify_all();
+
+    while (RunOne(0))
+    {
+    }
+
+    std::unique_lock<std::mutex> guard(lock);
+    finished.wait(guard, [&] { return remaining.load(std::memory_order_acquire) == 0; });
+}
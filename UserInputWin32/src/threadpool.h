@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/*
+ - fixed set of worker threads that run the items of one parallel loop at a time
+ - every thread (the workers and the caller) has its own queue of item indices
+    - a thread takes items from the back of its own queue
+    - when its queue is empty, it steals from the front of another thread's queue
+   so threads that finish cheap items early take over work from threads stuck on expensive ones
+ - a loop deals each queue one contiguous run of items and nothing is ever pushed while it runs, so a queue is just
+   the part of its run not yet taken: two indices, fixed size, so a loop allocates nothing (a 'std::deque' of the
+   indices allocated its blocks as they were pushed, on every frame of the software renderer)
+ - 'ParallelFor' blocks until every item has run; the calling thread works too instead of just waiting
+*/
+
+class WorkStealingPool
+{
+    struct Queue
+    {
+        std::mutex lock;
+        size_t front, back; // items [front, back) are still queued; the owner takes 'back - 1', thieves 'front'
+
+        Queue() : front(0), back(0) {}
+    };
+
+    typedef void (*TaskFn)(void* context, size_t item);
+
+    std::vector<std::unique_ptr<Queue>> queues; // queues[0] belongs to the calling thread
+    std::vector<std::thread> workers;
+
+    std::mutex lock;
+    std::condition_variable wake;     // a new loop was published, or the pool is stopping
+    std::condition_variable finished; // the last item of the loop completed
+    uint64_t generation;
+    bool stopping;
+
+    TaskFn taskFn;
+    void* taskContext;
+    std::atomic<size_t> remaining;
+
+    void WorkerMain(size_t self);
+    bool RunOne(size_t self);
+    void Run(size_t count, TaskFn fn, void* context);
+
+public:
+    // 'threads' counts the calling thread; 0 uses every hardware thread
+    explicit WorkStealingPool(unsigned threads = 0);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    unsigned Threads() const { return static_cast<unsigned>(queues.size()); }
+
+    // calls 'task(i)' for every i in [0, count) and returns when all calls have finished
+    template <class Task>
+    void ParallelFor(size_t count, Task&& task)
+    {
+        typedef std::remove_reference_t<Task> Fn;
+        Run(count, [](void* context, size_t item) { (*static_cast<Fn*>(context))(item); },
+            const_cast<void*>(static_cast<const void*>(&task)));
+    }
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+/*
+ - the part of the (unbounded) drawing shown in the client area
+ - shapes live in world coordinates (DIPs at zoom 1); the window shows the world point 'origin' at its upper left corner,
+   magnified by 'zoom'
+    - screen = (world - origin) * zoom, which is the transform Direct2D draws the scene with
+    - mouse input arrives in screen DIPs and is mapped back to world coordinates before it touches the scene
+ - panning moves the origin, zooming keeps the world point under the cursor in place
+*/
+
+class Viewport
+{
+    D2D1_POINT_2F origin;
+    float zoom;
+
+public:
+    static constexpr float MinZoom = 1.0f / 256;
+    static constexpr float MaxZoom = 64.0f;
+
+    Viewport() : origin(D2D1::Point2F(0, 0)), zoom(1.0f) {}
+
+    float Zoom() const { return zoom; }
+    D2D1_POINT_2F Origin() const { return origin; }
+
+    D2D1::Matrix3x2F Transform() const
+    {
+        return D2D1::Matrix3x2F::Translation(-origin.x, -origin.y) * D2D1::Matrix3x2F::Scale(zoom, zoom);
+    }
+
+    D2D1_POINT_2F ScreenToWorld(D2D1_POINT_2F pt) const
+    {
+        return D2D1::Point2F(pt.x / zoom + origin.x, pt.y / zoom + origin.y);
+    }
+
+    // the world rectangle covered by a client area of 'size' DIPs
+    D2D1_RECT_F VisibleRect(D2D1_SIZE_F size) const
+    {
+        return D2D1::RectF(origin.x, origin.y, origin.x + size.width / zoom, origin.y + size.height / zoom);
+    }
+
+    // moves the drawing by (dx, dy) screen DIPs, as if dragging it
+    void Pan(float dx, float dy)
+    {
+        origin.x -= dx / zoom;
+        origin.y -= dy / zoom;
+    }
+
+    // multiplies the zoom by 'factor', keeping the world point under 'screen' where it is
+    void ZoomAt(D2D1_POINT_2F screen, float factor)
+    {
+        const D2D1_POINT_2F anchor = ScreenToWorld(screen);
+        zoom = zoom * factor < MinZoom ? MinZoom : (zoom * factor > MaxZoom ? MaxZoom : zoom * factor);
+        origin = D2D1::Point2F(anchor.x - screen.x / zoom, anchor.y - screen.y / zoom);
+    }
+};
@@ -0,0 +1,104 @@
+#include <windows.h>
+#include <d2d1.h>
+#include <dwrite.h>
+
+#include <chrono>
+#include <stdio.h>
+
+#include "warmup.h"
+#include "startup.h"
+
+namespace
+{
+    template <class T> void Release(T** ppT)
+    {
+        if (*ppT)
+        {
+            (*ppT)->Release();
+            *ppT = NULL;
+        }
+    }
+}
+
+
+GraphicsWarmup::~GraphicsWarmup()
+{
+    if (worker.joinable())
+    {
+        worker.join();
+    }
+    Release(&pTextFormat);
+    Release(&pWriteFactory);
+    Release(&pFactory);
+}
+
+void GraphicsWarmup::Start()
+{
+    worker = std::thread(&GraphicsWarmup::Create, this);
+}
+
+void GraphicsWarmup::Create()
+{
+    hr = D2D1CreateFactory(D2D1_FACTORY_TYPE_SINGLE_THREADED, &pFactory); // create Direct2D factory object
+    /*
+     - first param is the flag that specifies creation objects
+        - 'D2D1_FACTORY_TYPE_SINGLE_THREADED' flag means that you will not call Direct2D from multiple threads
+        - to support calls from multiple threads, specify 'D2D1_FACTORY_TYPE_MULTI_THREADED'
+     - second param, receives a pointer to the 'ID2D1Factory' interface
+    */
+    StartupTimeline::Mark(L"Direct2D factory created");
+
+    if (SUCCEEDED(hr))
+    {
+        hr = DWriteCreateFactory(DWRITE_FACTORY_TYPE_SHARED, __uuidof(IDWriteFactory), reinterpret_cast<IUnknown**>(&pWriteFactory));
+    }
+    if (SUCCEEDED(hr))
+    {
+        hr = pWriteFactory->CreateTextFormat(L"Segoe UI", NULL, DWRITE_FONT_WEIGHT_NORMAL, DWRITE_FONT_STYLE_NORMAL,
+            DWRITE_FONT_STRETCH_NORMAL, 16.0f, L"", &pTextFormat);
+        StartupTimeline::Mark(L"text format created");
+    }
+    if (SUCCEEDED(hr))
+    {
+        // laying out a line of text opens the font file and shapes it; the result itself is thrown away
+        IDWriteTextLayout* pLayout = NULL;
+        DWRITE_TEXT_METRICS metrics;
+        if (SUCCEEDED(pWriteFactory->CreateTextLayout(L"Warm-up 0123456789", 18, pTextFormat, 1000.0f, 100.0f, &pLayout)))
+        {
+            pLayout->GetMetrics(&metrics);
+            pLayout->Release();
+        }
+        StartupTimeline::Mark(L"text layout warmed up");
+    }
+    created = true;
+}
+
+HRESULT GraphicsWarmup::Take(ID2D1Factory** ppFactory, IDWriteFactory** ppWriteFactory, IDWriteTextFormat** ppTextFormat)
+{
+    if (worker.joinable())
+    {
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        worker.join();
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        wchar_t msg[96];
+        swprintf_s(msg, L"startup: waited %.1f ms for the graphics warm-up\n", ms);
+        OutputDebugString(msg);
+    }
+    else if (!created)
+    {
+        Create();
+    }
+
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+    *ppFactory = pFactory;
+    *ppWriteFactory = pWriteFactory;
+    *ppTextFormat = pTextFormat;
+    pFactory = NULL;
+    pWriteFactory = NULL;
+    pTextFormat = NULL;
+    return S_OK;
+}
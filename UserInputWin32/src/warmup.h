@@ -0,0 +1,43 @@
+#pragma once
+
+#include <thread>
+
+struct ID2D1Factory;
+struct IDWriteFactory;
+struct IDWriteTextFormat;
+
+/*
+ - creates the device-independent graphics objects (the Direct2D factory, the DirectWrite factory and the editor's
+   text format) on a thread of its own, while the UI thread registers the class and creates and shows the window
+ - DirectWrite loads the system font collection when the first text format is created, and shapes text the first time
+   it is laid out; both happen here, so the first frame's text does not pay for them
+ - the UI thread collects the objects with 'Take' when it first needs them, at the first paint, and only waits if
+   the warm-up is not finished by then
+ - the Direct2D factory is single-threaded: it is created here but only ever used by the UI thread after 'Take'
+ - without 'Start', or when started in the foreground, 'Take' creates everything on the calling thread
+   ('/syncstartup', to compare startup times)
+*/
+
+class GraphicsWarmup
+{
+    std::thread worker;
+    ID2D1Factory* pFactory;
+    IDWriteFactory* pWriteFactory;
+    IDWriteTextFormat* pTextFormat;
+    HRESULT hr;
+    bool created;
+
+    void Create();
+
+public:
+    GraphicsWarmup() : pFactory(NULL), pWriteFactory(NULL), pTextFormat(NULL), hr(S_OK), created(false) {}
+    ~GraphicsWarmup(); // waits for the warm-up, then releases whatever was not taken
+
+    GraphicsWarmup(const GraphicsWarmup&) = delete;
+    GraphicsWarmup& operator=(const GraphicsWarmup&) = delete;
+
+    void Start();
+
+    // hands over the objects (the caller releases them); waits for the warm-up thread if it is still running
+    HRESULT Take(ID2D1Factory** ppFactory, IDWriteFactory** ppWriteFactory, IDWriteTextFormat** ppTextFormat);
+};
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ - 'BaseWindow::WindowProc' needs the C++ object behind every message's window; asking the window for it
+   ('GetWindowLongPtr') is a call into user32 on every message
+ - 'WindowInstanceCache' maps hwnd -> instance per thread: a window belongs to the thread that created it and its
+   messages are only ever dispatched on that thread, so each thread's cache sees all of its windows and needs no lock
+ - the last few windows looked up are kept first in a tiny array (a burst of messages nearly always goes to one or
+   two windows); behind it, an open-addressing table holds every window of the thread
+ - an entry is added on WM_NCCREATE, when the instance is attached, and removed after WM_NCDESTROY, the last message
+   a window gets, so a handle Windows later reuses for a new window never finds the old instance
+ - a miss asks the window, as before, and caches the answer; messages sent before WM_NCCREATE (WM_GETMINMAXINFO)
+   have no instance yet and are never cached
+ - only 'BaseWindow' may set GWLP_USERDATA: anything else changing it would leave the cache pointing at the old instance
+*/
+
+class WindowInstanceCache
+{
+public:
+    static const size_t RecentSize = 4;
+
+private:
+    struct Entry
+    {
+        HWND hwnd;
+        void* instance;
+    };
+
+    Entry recent[RecentSize]; // most recently used first; unused slots have a NULL hwnd
+    std::vector<Entry> table; // size a power of two, linear probing; a NULL hwnd is an empty slot
+    size_t count;
+    bool enabled;
+
+    // handles are small, mostly consecutive numbers; Fibonacci hashing spreads them over the table
+    size_t Slot(HWND hwnd) const
+    {
+        const uint64_t h = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(hwnd)) * 0x9E3779B97F4A7C15ull;
+        return static_cast<size_t>(h >> 32) & (table.size() - 1);
+    }
+
+    // moves 'hwnd' to the front of 'recent', dropping the least recently used entry if it was not there
+    void Remember(HWND hwnd, void* instance)
+    {
+        size_t i = 0;
+        while (i < RecentSize - 1 && recent[i].hwnd != hwnd)
+        {
+            i++;
+        }
+        for (; i > 0; i--)
+        {
+            recent[i] = recent[i - 1];
+        }
+        recent[0] = Entry{ hwnd, instance };
+    }
+
+    void Grow()
+    {
+        std::vector<Entry> old(table.size() < 16 ? 16 : table.size() * 2, Entry{ NULL, NULL });
+        old.swap(table);
+        for (const Entry& e : old)
+        {
+            if (e.hwnd != NULL)
+            {
+                size_t i = Slot(e.hwnd);
+                while (table[i].hwnd != NULL)
+                {
+                    i = (i + 1) & (table.size() - 1);
+                }
+                table[i] = e;
+            }
+        }
+    }
+
+public:
+    WindowInstanceCache() : recent(), count(0), enabled(true) {}
+
+    // the cache of the calling thread
+    static WindowInstanceCache& ForThread()
+    {
+        static thread_local WindowInstanceCache cache;
+        return cache;
+    }
+
+    // the instance of 'hwnd', or NULL when it is not cached
+    void* Find(HWND hwnd)
+    {
+        if (recent[0].hwnd == hwnd && hwnd != NULL)
+        {
+            return recent[0].instance;
+        }
+        for (size_t i = 1; i < RecentSize; i++)
+        {
+            if (recent[i].hwnd == hwnd && hwnd != NULL)
+            {
+                void* instance = recent[i].instance;
+                Remember(hwnd, instance);
+                return instance;
+            }
+        }
+        if (count == 0)
+        {
+            return NULL;
+        }
+        for (size_t i = Slot(hwnd); table[i].hwnd != NULL; i = (i + 1) & (table.size() - 1))
+        {
+            if (table[i].hwnd == hwnd)
+            {
+                Remember(hwnd, table[i].instance);
+                return table[i].instance;
+            }
+        }
+        return NULL;
+    }
+
+    void Insert(HWND hwnd, void* instance)
+    {
+        if (!enabled || hwnd == NULL)
+        {
+            return;
+        }
+        if ((count + 1) * 4 > table.size() * 3) // at most three quarters full
+        {
+            Grow();
+        }
+        size_t i = Slot(hwnd);
+        while (table[i].hwnd != NULL && table[i].hwnd != hwnd)
+        {
+            i = (i + 1) & (table.size() - 1);
+        }
+        if (table[i].hwnd == NULL)
+        {
+            count++;
+        }
+        table[i] = Entry{ hwnd, instance };
+        Remember(hwnd, instance);
+    }
+
+    void Erase(HWND hwnd)
+    {
+        for (size_t i = 0; i < RecentSize; i++)
+        {
+            if (recent[i].hwnd == hwnd)
+            {
+                for (; i < RecentSize - 1; i++)
+                {
+                    recent[i] = recent[i + 1];
+                }
+                recent[RecentSize - 1] = Entry{ NULL, NULL };
+                break;
+            }
+        }
+        if (count == 0)
+        {
+            return;
+        }
+
+        const size_t mask = table.size() - 1;
+        size_t i = Slot(hwnd);
+        while (table[i].hwnd != hwnd)
+        {
+            if (table[i].hwnd == NULL)
+            {
+                return;
+            }
+            i = (i + 1) & mask;
+        }
+
+        // backward-shift deletion: entries after the hole that would no longer be reachable move into it,
+        // so lookups never need tombstones
+        for (size_t j = (i + 1) & mask; table[j].hwnd != NULL; j = (j + 1) & mask)
+        {
+            const size_t home = Slot(table[j].hwnd);
+            const bool reachable = i <= j ? (home > i && home <= j) : (home > i || home <= j);
+            if (!reachable)
+            {
+                table[i] = table[j];
+                i = j;
+            }
+        }
+        table[i] = Entry{ NULL, NULL };
+        count--;
+    }
+
+    // switching the cache off empties it; lookups then always ask the window (for measuring what the cache saves)
+    void SetEnabled(bool on)
+    {
+        enabled = on;
+        if (!on)
+        {
+            table.clear();
+            count = 0;
+            for (Entry& e : recent)
+            {
+                e = Entry{ NULL, NULL };
+            }
+        }
+    }
+
+    size_t Size() const { return count; }
+};
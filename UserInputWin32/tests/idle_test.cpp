@@ -0,0 +1,84 @@
+/*
+ - the idle accounting (src/idle.h) fed scripted message and frame times, the way 'MainWindow::OnWakeup' and
+   'OnPaint' feed it, checking which counter each one lands in
+ - covers what a desktop run of '/idle' would hit only by chance: a message stamped before the input that reset the
+   count (queued earlier, or the tick read after the message arrived), 'GetTickCount' wrapping after 49.7 days
+   in the middle of an idle period, and the report an input makes when it ends a long idle period
+ - no Windows dependency:
+       g++ -std=c++20 -O2 -I../src idle_test.cpp -o idle_test
+*/
+
+#include <cstdio>
+
+#include "idle.h"
+
+namespace
+{
+    const uint32_t Settle = 6000;
+    int failures = 0;
+
+    void Expect(bool ok, const char* what)
+    {
+        if (!ok)
+        {
+            fprintf(stderr, "FAILED: %s\n", what);
+            failures++;
+        }
+    }
+
+    void Counting(uint32_t start)
+    {
+        IdleMonitor idle(Settle);
+        idle.Reset(start);
+        idle.OnWakeup(start + 10);          // the repaint after the input
+        idle.OnWakeup(start - 5);           // posted before the input, handled after it
+        idle.OnFrame(start + 20);           // frames while settling are not counted
+        idle.OnWakeup(start + Settle - 1);
+        idle.OnWakeup(start + Settle);      // from here on, anything is a wakeup of an idle window
+        idle.OnFrame(start + Settle + 500);
+        idle.OnWakeup(start + 3600000);
+
+        const IdleReport r = idle.Report(start + 3600000);
+        Expect(r.settleWakeups == 3, "wakeups while settling");
+        Expect(r.wakeups == 2, "wakeups after settling");
+        Expect(r.frames == 1, "frames after settling");
+        Expect(r.idleMs == 3600000, "idle time");
+        Expect(r.PerMinute(r.wakeups) > 0.033 && r.PerMinute(r.wakeups) < 0.034, "wakeups per minute");
+
+        // a report read at a tick before the input: nothing has been idle yet
+        Expect(idle.Report(start - 1).idleMs == 0, "report before the input");
+    }
+
+    void Reporting()
+    {
+        IdleMonitor idle(Settle);
+        IdleReport ended;
+        idle.Reset(1000);
+        Expect(!idle.OnInput(1000 + IdleMonitor::ReportedIdle - 1, ended), "a short idle period is not reported");
+        Expect(ended.idleMs == IdleMonitor::ReportedIdle - 1, "the short period's length");
+
+        const uint32_t start = 1000 + IdleMonitor::ReportedIdle - 1;
+        idle.OnWakeup(start + Settle + 1);
+        Expect(idle.OnInput(start + IdleMonitor::ReportedIdle, ended), "a long idle period is reported");
+        Expect(ended.wakeups == 1 && ended.settleWakeups == 0, "the long period's counts");
+        Expect(idle.Report(start + IdleMonitor::ReportedIdle).wakeups == 0, "the input starts a new period");
+    }
+}
+
+
+int main()
+{
+    Counting(1000);
+    Counting(0xFFFFFFFFu - 2000); // 'GetTickCount' wraps during settling
+    Counting(0xFFFFFFFFu - 100000); // and after it
+    Counting(3);                  // the message stamped before the input is on the other side of the wrap
+    Reporting();
+
+    if (failures != 0)
+    {
+        printf("FAILED\n");
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,255 @@
+/*
+ - the input ring (src/inputring.h) over POSIX shared memory: one writer, three readers of different speeds
+ - every event carries its sequence number in all of its fields, so a torn copy (words of two different events)
+   is caught, as is an event that arrives out of order or twice
+ - each reader must account for every event: received + dropped == published, with the slow one dropping plenty
+ - run twice: with threads sharing one mapping (what ThreadSanitizer can see), then with forked processes that
+   each map the segment themselves (the way the window and a tap share it); the second writer takes over the ring
+   the first left behind, with the readers already attached, and must carry on its sequence numbers
+ - ThreadSanitizer does not model the seqlock's fences ('-Wno-tsan' silences it saying so); the slot words are atomics,
+   so it still sees every access, and a torn copy is caught by the content check instead
+ - the ring has no Windows dependency, so this builds on Linux:
+       g++ -std=c++20 -O2 -pthread -I../src inputring_test.cpp -o inputring_test -lrt
+       g++ -std=c++20 -O1 -g -fsanitize=thread -Wno-tsan -pthread -I../src inputring_test.cpp -o inputring_test_tsan -lrt
+*/
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "inputring.h"
+
+namespace
+{
+    const char* const SegmentName = "/UserInputWin32.InputRingTest";
+    const uint32_t Capacity = 1024;
+    const uint64_t Events = 1000000;
+    const uint64_t Burst = 512; // the writer pauses after this many events, as input comes in bursts too
+    const int Readers = 3;
+
+    // the mapped segment: the ring, then a count of attached readers so the writer starts only once all are in
+    struct Segment
+    {
+        void* ring;
+        std::atomic<int>* ready;
+    };
+
+    size_t SegmentBytes()
+    {
+        return InputRingBytes(Capacity) + sizeof(std::atomic<int>) * 16;
+    }
+
+    bool Map(int fd, Segment& s)
+    {
+        void* p = mmap(nullptr, SegmentBytes(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED)
+        {
+            return false;
+        }
+        s.ring = p;
+        s.ready = reinterpret_cast<std::atomic<int>*>(static_cast<char*>(p) + InputRingBytes(Capacity));
+        return true;
+    }
+
+    InputEvent Make(uint64_t seq)
+    {
+        return InputEvent{ static_cast<uint32_t>(seq), static_cast<uint32_t>(seq >> 32), seq, ~static_cast<int64_t>(seq) };
+    }
+
+    // events 'first' .. 'first + Events - 1'
+    void Write(const Segment& s, InputRingWriter& writer, uint64_t first)
+    {
+        while (s.ready->load(std::memory_order_acquire) < Readers)
+        {
+            std::this_thread::yield();
+        }
+        for (uint64_t seq = first; seq < first + Events; seq++)
+        {
+            writer.Publish(Make(seq));
+            if (seq % Burst == Burst - 1)
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        }
+    }
+
+    // 0 when every event was either received intact and in order, or counted as dropped
+    int Read(const Segment& s, int index, uint64_t first)
+    {
+        InputRingReader reader;
+        if (!reader.Attach(s.ring, Capacity))
+        {
+            fprintf(stderr, "reader %d: no ring\n", index);
+            return 1;
+        }
+        s.ready->fetch_add(1, std::memory_order_acq_rel);
+
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(60);
+        uint64_t received = 0, expected = first;
+        volatile uint64_t work = 0;
+        InputEvent e;
+        while (received + reader.Dropped() < Events)
+        {
+            if (!reader.Next(e))
+            {
+                if (std::chrono::steady_clock::now() > deadline)
+                {
+                    fprintf(stderr, "reader %d: stuck at %llu\n", index, static_cast<unsigned long long>(received + reader.Dropped()));
+                    return 1;
+                }
+                std::this_thread::yield(); // caught up
+                continue;
+            }
+            const uint64_t seq = e.wParam;
+            const InputEvent want = Make(seq);
+            if (e.message != want.message || e.time != want.time || e.lParam != want.lParam)
+            {
+                fprintf(stderr, "reader %d: torn event %llu\n", index, static_cast<unsigned long long>(seq));
+                return 1;
+            }
+            if (seq < expected || seq >= first + Events)
+            {
+                fprintf(stderr, "reader %d: event %llu after %llu\n", index, static_cast<unsigned long long>(seq),
+                    static_cast<unsigned long long>(expected));
+                return 1;
+            }
+            expected = seq + 1;
+            received++;
+
+            // reader 0 keeps up, reader 1 stalls now and then, reader 2 is slow throughout
+            if (index == 1 && received % 4096 == 0)
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+            else if (index == 2)
+            {
+                for (int k = 0; k < 200; k++)
+                {
+                    work = work + k;
+                }
+            }
+        }
+        if (received + reader.Dropped() != Events || expected > first + Events)
+        {
+            fprintf(stderr, "reader %d: %llu received + %llu dropped != %llu\n", index, static_cast<unsigned long long>(received),
+                static_cast<unsigned long long>(reader.Dropped()), static_cast<unsigned long long>(Events));
+            return 1;
+        }
+        printf("reader %d: %llu received, %llu dropped\n", index, static_cast<unsigned long long>(received),
+            static_cast<unsigned long long>(reader.Dropped()));
+        fflush(stdout); // a child leaves with '_exit'
+        return 0;
+    }
+
+    // the ring, as the window's constructor leaves it, for the readers to attach to before the writer starts
+    void Start(const Segment& s, InputRingWriter& writer)
+    {
+        writer.Attach(s.ring, Capacity);
+        s.ready->store(0, std::memory_order_release);
+    }
+
+    int RunThreads(const Segment& s)
+    {
+        InputRingWriter writer;
+        Start(s, writer);
+        std::atomic<int> failures(0);
+        std::vector<std::thread> threads;
+        for (int i = 0; i < Readers; i++)
+        {
+            threads.emplace_back([&, i] { failures += Read(s, i, 0); });
+        }
+        threads.emplace_back([&] { Write(s, writer, 0); });
+        for (std::thread& t : threads)
+        {
+            t.join();
+        }
+        return failures.load();
+    }
+
+    // runs after 'RunThreads' left 'Events' events in the ring: the writer here is a new process taking it over,
+    // as a restarted window takes over a ring that taps kept open, so the sequence must carry on from 'Events'
+    int RunProcesses(int fd, const Segment& s)
+    {
+        s.ready->store(0, std::memory_order_release);
+        fflush(stdout); // or the children print it again
+        std::vector<pid_t> children;
+        for (int i = 0; i <= Readers; i++)
+        {
+            const pid_t pid = fork();
+            if (pid == 0)
+            {
+                // a mapping of its own, at whatever address, as another process would have
+                Segment own;
+                if (!Map(fd, own))
+                {
+                    _exit(1);
+                }
+                if (i == Readers)
+                {
+                    InputRingWriter writer;
+                    writer.Attach(own.ring, Capacity);
+                    Write(own, writer, Events);
+                    _exit(0);
+                }
+                _exit(Read(own, i, Events));
+            }
+            if (pid < 0)
+            {
+                perror("fork");
+                return 1;
+            }
+            children.push_back(pid);
+        }
+
+        int failures = 0;
+        for (pid_t pid : children)
+        {
+            int status = 0;
+            waitpid(pid, &status, 0);
+            failures += !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+        }
+        return failures;
+    }
+}
+
+
+int main()
+{
+    shm_unlink(SegmentName);
+    const int fd = shm_open(SegmentName, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0 || ftruncate(fd, static_cast<off_t>(SegmentBytes())) != 0)
+    {
+        perror("shm_open");
+        return 1;
+    }
+    shm_unlink(SegmentName); // the descriptor keeps it alive for the children
+
+    Segment s;
+    if (!Map(fd, s))
+    {
+        perror("mmap");
+        return 1;
+    }
+
+    printf("threads, one mapping:\n");
+    const int threadFailures = RunThreads(s);
+    printf("processes, a mapping each:\n");
+    const int processFailures = RunProcesses(fd, s);
+
+    munmap(s.ring, SegmentBytes());
+    close(fd);
+    if (threadFailures + processFailures != 0)
+    {
+        printf("FAILED\n");
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}